@@ -17,6 +17,12 @@ typedef struct {
     int quick;
     int noAntiAlias;
     int speech;
+    int parallel;
+    int jobs;
+    int outRate;
+    int internalRate;
+    float startTime;
+    float endTime;
 } RunParameters;
 
 void InitRunParameters(RunParameters *parameters, const int nParams, const char *const paramStr[]);
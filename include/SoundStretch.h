@@ -12,5 +12,10 @@
 void openFiles(WavInFile **inFile, WavOutFile **outFile, const RunParameters *params);
 void setup(void *pSoundTouch, const WavInFile *inFile, const RunParameters *params);
 void process(void *pSoundTouch, WavInFile *inFile, WavOutFile *outFile);
+// Processes only input sample frames 'startSample' .. 'endSample'. The input is
+// read from the region start less the initial latency of the processing, and the
+// output of that pre-roll is discarded, so the cost follows the region length.
+void processRegion(void *pSoundTouch, WavInFile *inFile, WavOutFile *outFile, uint startSample, uint endSample);
+void processOffline(const RunParameters *params, WavInFile *inFile, WavOutFile *outFile);
 
 #endif  // SOUNDSTRETCH_H
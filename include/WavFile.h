@@ -52,6 +52,12 @@
 typedef unsigned int uint;
 #endif
 
+// WAV sample format codes of the 'fixed' field of the format header. The
+// reader resolves WAV_FORMAT_EXTENSIBLE to the format code of its subformat.
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_IEEE_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
 // WAV audio file 'riff' section header
 typedef struct {
     char riff_char[4];
@@ -102,13 +108,19 @@ WavFileBase *WavFileBase_create();
 void WavFileBase_destroy(WavFileBase *wavFileBase);
 void *WavFileBase_getConvBuffer(WavFileBase *wavFileBase, int sizeBytes);
 
-// Class for reading WAV audio files.
+// Class for reading WAV audio files, also RF64 and BW64 files of over 4 GB. The
+// sample data of regular files is read through a memory mapping of the file,
+// that of other streams with stdio.
 typedef struct {
     FILE *fptr;
     WavFileBase *base;
-    long position;     // Position within the audio stream
-    long dataRead;     // Counter of how many bytes of sample data have been read from the file
-    WavHeader header;  // WAV header information
+    long position;         // Position within the audio stream
+    long long dataRead;    // Counter of how many bytes of sample data have been read from the file
+    WavHeader header;      // WAV header information
+    unsigned char *map;    // Memory mapping of the file, or NULL if reading through 'fptr'
+    size_t mapSize;        // Mapped bytes, up to the end of the sample data or of the file
+    long long dataOffset;  // File offset of the sample data, or -1 if the stream can't tell
+    long long dataLen;     // Size of the sample data, from the 'data' chunk or the RF64 'ds64' chunk
 } WavInFile;
 
 WavInFile *WavInFile_create(const char *fileName);
@@ -119,10 +131,15 @@ int WavInFile_checkCharTags(const WavInFile *wavFile);
 int WavInFile_read(WavInFile *inFile, unsigned char *buffer, int maxElems);
 int WavInFile_readInt(WavInFile *inFile, short *buffer, int maxElems);
 int WavInFile_readFloat(WavInFile *wavFile, float *buffer, int maxElems);
+// Reads as WavInFile_readFloat into 'buffer' and points '*samples' to the samples
+// read. Float samples of a mapped file are not copied but '*samples' points to
+// them in the mapping, valid until the file is destroyed.
+int WavInFile_readFloatInPlace(WavInFile *wavFile, float *buffer, int maxElems, const float **samples);
 int WavInFile_eof(const WavInFile *wavInFile);
 int WavInFile_readRIFFBlock(WavInFile *wavInFile);
 int WavInFile_readHeaderBlock(FILE *fptr, WavHeader *header);
 int WavInFile_readWavHeaders(WavInFile *wavInFile);
+uint WavInFile_getFormat(const WavInFile *wavInFile);
 uint WavInFile_getNumChannels(const WavInFile *wavInFile);
 uint WavInFile_getNumBits(const WavInFile *wavInFile);
 uint WavInFile_getBytesPerSample(const WavInFile *wavInFile);
@@ -130,13 +147,19 @@ uint WavInFile_getSampleRate(const WavInFile *wavInFile);
 uint WavInFile_getDataSizeInBytes(const WavInFile *wavInFile);
 uint WavInFile_getNumSamples(const WavInFile *wavInFile);
 uint WavInFile_getLengthMS(const WavInFile *wavInFile);
+// Moves the read position to sample frame 'sample'. Streams that can't seek,
+// e.g. pipes, can only move forward. Returns 0 on success, or -1 if the sample
+// is beyond the end of the data or the stream can't get there.
+int WavInFile_seekToSample(WavInFile *wavInFile, uint sample);
 
 // Class for writing WAV audio files.
 typedef struct {
     FILE *fptr;
     WavFileBase *base;
-    int bytesWritten;  // Counter of how many bytes have been written to the file so far
-    WavHeader header;  // WAV file header data
+    int bytesWritten;    // Counter of how many bytes have been written to the file so far
+    WavHeader header;    // WAV file header data
+    unsigned char *map;  // Memory mapping of the file after WavOutFile_reserve, otherwise NULL
+    size_t mapSize;      // Size of the mapping, which is also the current file size
 } WavOutFile;
 
 WavOutFile *WavOutFile_create(const char *fileName, int sampleRate, int bits, int channels);
@@ -148,5 +171,15 @@ void WavOutFile_writeHeader(WavOutFile *wavOutFile);
 void WavOutFile_write(WavOutFile *outFile, const unsigned char *buffer, int numElems);
 void WavOutFile_writeInt(WavOutFile *outFile, const short *buffer, int numElems);
 void WavOutFile_writeFloat(WavOutFile *wavOutFile, const float *buffer, int numElems);
+// Switches the file to WAV_FORMAT_PCM or WAV_FORMAT_IEEE_FLOAT samples, which
+// need 32 bits. Returns 0 on success, or -1 if samples were already written or
+// the format doesn't suit the sample size.
+int WavOutFile_setFormat(WavOutFile *wavOutFile, uint format);
+// Reserves room for 'numElems' more sample values in the file and writes the
+// samples through a memory mapping of the file from then on. The file grows if
+// more is written, and is cut to the written length when closed. Returns 0 on
+// success, or -1 if the file can't be mapped, e.g. a pipe, in which case writing
+// continues through stdio.
+int WavOutFile_reserve(WavOutFile *wavOutFile, uint numElems);
 
 #endif
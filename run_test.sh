@@ -12,8 +12,13 @@ cmake -DCMAKE_BUILD_TYPE=Debug -DENABLE_TESTING=1 ../test/
 make -j8
 
 # Man
-./test ../input.wav ../wav/output_man.wav -pitch=-4.0 -speech
+time ./test ../input.wav ../wav/output_man.wav -pitch=-4.0 -speech
 # Woman
 ./test ../input.wav ../wav/output_woman.wav -pitch=5.0 -speech
 # Cartoon
-./test ../input.wav ../wav/output_cartoon.wav -pitch=6.5 -speech
\ No newline at end of file
+./test ../input.wav ../wav/output_cartoon.wav -pitch=6.5 -speech
+
+# Man again with the processing stages on two threads: reports the time for
+# comparison with the first run, and the output must not change
+time ./test ../input.wav ../wav/output_man_parallel.wav -pitch=-4.0 -speech -parallel
+cmp ../wav/output_man.wav ../wav/output_man_parallel.wav
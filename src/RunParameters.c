@@ -17,9 +17,15 @@ static const char usage[] =
     "  -tempo=n : Change sound tempo by n percents  (n=-95..+5000 %)\n"
     "  -pitch=n : Change sound pitch by n semitones (n=-60..+60 semitones)\n"
     "  -rate=n  : Change sound rate by n percents   (n=-95..+5000 %)\n"
+    "  -outrate=n : Write the output at sample rate n Hz (n=8000..192000)\n"
+    "  -internal=n: Time-stretch at sample rate n Hz, for speech (e.g. 16000)\n"
     "  -quick   : Use quicker tempo change algorithm (gain speed, lose quality)\n"
     "  -naa     : Don't use anti-alias filtering (gain speed, lose quality)\n"
     "  -speech  : Tune algorithm for speech processing (default is for music)\n"
+    "  -parallel: Run the processing stages on two threads (same output, faster)\n"
+    "  -jobs=n  : Process the file in n chunks in parallel (n=1..64)\n"
+    "  -start=n : Output only the part from n seconds of the input on\n"
+    "  -end=n   : Output only the part up to n seconds of the input\n"
     "  -license : Display the program license text (LGPL)\n";
 
 // Converts a char into lower case
@@ -49,6 +55,25 @@ static void checkLimits(RunParameters *parameters) {
     } else if (parameters->rateDelta > 5000.0f) {
         parameters->rateDelta = 5000.0f;
     }
+
+    if (parameters->outRate != 0) {
+        if (parameters->outRate < 8000) {
+            parameters->outRate = 8000;
+        } else if (parameters->outRate > 192000) {
+            parameters->outRate = 192000;
+        }
+    }
+
+    if (parameters->internalRate < 0) parameters->internalRate = 0;
+
+    if (parameters->startTime < 0) parameters->startTime = 0;
+    if (parameters->endTime < 0) parameters->endTime = 0;
+
+    if (parameters->jobs < 1) {
+        parameters->jobs = 1;
+    } else if (parameters->jobs > 64) {
+        parameters->jobs = 64;
+    }
 }
 
 // Unknown switch parameter -- throws an exception with an error message
@@ -97,8 +122,13 @@ static void parseSwitchParam(RunParameters *parameters, const char *str) {
             break;
 
         case 'p':
-            // switch '-pitch=xx'
-            parameters->pitchDelta = parseSwitchValue(str);
+            if (_toLowerCase(str[2]) == 'a') {
+                // switch '-parallel'
+                parameters->parallel = 1;
+            } else {
+                // switch '-pitch=xx'
+                parameters->pitchDelta = parseSwitchValue(str);
+            }
             break;
 
         case 'r':
@@ -106,6 +136,21 @@ static void parseSwitchParam(RunParameters *parameters, const char *str) {
             parameters->rateDelta = parseSwitchValue(str);
             break;
 
+        case 'i':
+            // switch '-internal=xx'
+            parameters->internalRate = (int)parseSwitchValue(str);
+            break;
+
+        case 'o':
+            // switch '-outrate=xx'
+            parameters->outRate = (int)parseSwitchValue(str);
+            break;
+
+        case 'j':
+            // switch '-jobs=xx'
+            parameters->jobs = (int)parseSwitchValue(str);
+            break;
+
         case 'q':
             // switch '-quick'
             parameters->quick = 1;
@@ -117,8 +162,18 @@ static void parseSwitchParam(RunParameters *parameters, const char *str) {
             break;
 
         case 's':
-            // switch '-speech'
-            parameters->speech = 1;
+            if (_toLowerCase(str[2]) == 't') {
+                // switch '-start=xx'
+                parameters->startTime = parseSwitchValue(str);
+            } else {
+                // switch '-speech'
+                parameters->speech = 1;
+            }
+            break;
+
+        case 'e':
+            // switch '-end=xx'
+            parameters->endTime = parseSwitchValue(str);
             break;
 
         default:
@@ -148,6 +203,12 @@ void InitRunParameters(RunParameters *parameters, const int nParams, const char
     parameters->quick = 0;
     parameters->noAntiAlias = 0;
     parameters->speech = 0;
+    parameters->parallel = 0;
+    parameters->jobs = 1;
+    parameters->outRate = 0;
+    parameters->internalRate = 0;
+    parameters->startTime = 0;
+    parameters->endTime = 0;
 
     // Get input & output file names
     parameters->inFileName = (char *)paramStr[1];
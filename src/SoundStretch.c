@@ -58,9 +58,10 @@ void openFiles(WavInFile **inFile, WavOutFile **outFile, const RunParameters *pa
         *inFile = WavInFile_create(params->inFileName);
     }
 
-    // ... open output file with same sound parameters
+    // ... open output file with same sound parameters, except for the sample rate
+    // if converted
     bits = (int)WavInFile_getNumBits(*inFile);
-    samplerate = (int)WavInFile_getSampleRate(*inFile);
+    samplerate = (params->outRate > 0) ? params->outRate : (int)WavInFile_getSampleRate(*inFile);
     channels = (int)WavInFile_getNumChannels(*inFile);
 
     if (params->outFileName) {
@@ -70,6 +71,10 @@ void openFiles(WavInFile **inFile, WavOutFile **outFile, const RunParameters *pa
         } else {
             *outFile = WavOutFile_create(params->outFileName, samplerate, bits, channels);
         }
+        // float input gives float output, without conversions on the way
+        if (WavInFile_getFormat(*inFile) == WAV_FORMAT_IEEE_FLOAT) {
+            WavOutFile_setFormat(*outFile, WAV_FORMAT_IEEE_FLOAT);
+        }
     } else {
         *outFile = NULL;
     }
@@ -84,9 +89,12 @@ void setup(void *pSoundTouch, const WavInFile *inFile, const RunParameters *para
     sampleRate = (int)WavInFile_getSampleRate(inFile);
     channels = (int)WavInFile_getNumChannels(inFile);
     SoundTouch_setSampleRate(pSoundTouch, sampleRate);
+    SoundTouch_setOutputSampleRate(pSoundTouch, params->outRate);
     SoundTouch_setChannels(pSoundTouch, channels);
+    SoundTouch_setProcessingRate(pSoundTouch, params->internalRate);
 
     SoundTouch_setPitchSemiTones(pSoundTouch, params->pitchDelta);
+    SoundTouch_setParallelStages(pSoundTouch, params->parallel);
 
     // print processing information
     if (params->outFileName) {
@@ -102,6 +110,12 @@ void setup(void *pSoundTouch, const WavInFile *inFile, const RunParameters *para
         fprintf(stderr, "Tempo change = %+g %%\n", params->tempoDelta);
         fprintf(stderr, "Pitch change = %+g semitones\n", params->pitchDelta);
         fprintf(stderr, "Rate change  = %+g %%\n", params->rateDelta);
+        if (params->outRate > 0) {
+            fprintf(stderr, "Output rate  = %d Hz\n", params->outRate);
+        }
+        if (params->internalRate > 0) {
+            fprintf(stderr, "Internal rate = %d Hz\n", params->internalRate);
+        }
     } else {
         // outFileName not given
         fprintf(stderr, "Warning: output file name missing, won't output anything.\n");
@@ -114,14 +128,26 @@ void setup(void *pSoundTouch, const WavInFile *inFile, const RunParameters *para
 void process(void *pSoundTouch, WavInFile *inFile, WavOutFile *outFile) {
     int nSamples;
     int nChannels;
-    int buffSizeSamples;
+    unsigned int maxOutput;
+    unsigned int nOutput;
+    double expected;
+    int complete;
     SAMPLETYPE sampleBuffer[BUFF_SIZE];
+    const SAMPLETYPE *samples = sampleBuffer;
+    SAMPLETYPE *outBuffer;
 
     if ((inFile == NULL) || (outFile == NULL)) return;  // nothing to do.
 
     nChannels = (int)WavInFile_getNumChannels(inFile);
     assert(nChannels > 0);
-    buffSizeSamples = BUFF_SIZE / nChannels;
+    // room for everything a full input block can produce, so that one
+    // 'SoundTouch_process' call per block returns all the ready samples
+    maxOutput = SoundTouch_getMaxOutput(pSoundTouch, BUFF_SIZE / nChannels);
+    outBuffer = (SAMPLETYPE *)malloc(maxOutput * nChannels * sizeof(SAMPLETYPE));
+
+    // write through a mapping of the output file, sized for the expected output
+    expected = WavInFile_getNumSamples(inFile) * SoundTouch_getInputOutputSampleRatio(pSoundTouch) * nChannels;
+    if (expected < INT_MAX) WavOutFile_reserve(outFile, (uint)expected);
 
     // Process samples read from the input file
     while (WavInFile_eof(inFile) == 0) {
@@ -131,42 +157,179 @@ void process(void *pSoundTouch, WavInFile *inFile, WavOutFile *outFile) {
 #ifdef SOUNDTOUCH_INTEGER_SAMPLES
         num = WavInFile_readInt(inFile, sampleBuffer, BUFF_SIZE);
 #else
-        num = WavInFile_readFloat(inFile, sampleBuffer, BUFF_SIZE);
+        // float samples come straight from the file mapping
+        num = WavInFile_readFloatInPlace(inFile, sampleBuffer, BUFF_SIZE, &samples);
 #endif
 
         nSamples = num / (int)WavInFile_getNumChannels(inFile);
 
-        // Feed the samples into SoundTouch processor
-        SoundTouch_putSamples(pSoundTouch, sampleBuffer, nSamples);
-
-        // Read ready samples from SoundTouch processor & write them output file.
-        // NOTES:
-        // - 'receiveSamples' doesn't necessarily return any samples at all
-        //   during some rounds!
-        // - On the other hand, during some round 'receiveSamples' may have more
-        //   ready samples than would fit into 'sampleBuffer', and for this reason
-        //   the 'receiveSamples' call is iterated for as many times as it
-        //   outputs samples.
+        // Feed the samples into SoundTouch processor and write the ready samples
+        // to the output file. The call doesn't necessarily return any samples at
+        // all during some rounds; if it couldn't return all of them, keep
+        // draining with empty input.
         do {
-            nSamples = SoundTouch_receiveSamples(pSoundTouch, sampleBuffer, buffSizeSamples);
+            complete = SoundTouch_process(pSoundTouch, samples, (unsigned int)nSamples, outBuffer, maxOutput, &nOutput);
 #ifdef SOUNDTOUCH_INTEGER_SAMPLES
-            WavOutFile_writeInt(outFile, sampleBuffer, nSamples * nChannels);
+            WavOutFile_writeInt(outFile, outBuffer, (int)nOutput * nChannels);
 #else
-            WavOutFile_writeFloat(outFile, sampleBuffer, nSamples * nChannels);
+            WavOutFile_writeFloat(outFile, outBuffer, (int)nOutput * nChannels);
 #endif
-
-        } while (nSamples != 0);
+            nSamples = 0;
+        } while (!complete);
     }
 
     // Now the input file is processed, yet 'flush' few last samples that are
     // hiding in the SoundTouch's internal processing pipeline.
     SoundTouch_flush(pSoundTouch);
     do {
-        nSamples = SoundTouch_receiveSamples(pSoundTouch, sampleBuffer, buffSizeSamples);
+        SoundTouch_process(pSoundTouch, NULL, 0, outBuffer, maxOutput, &nOutput);
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+        WavOutFile_writeInt(outFile, outBuffer, (int)nOutput * nChannels);
+#else
+        WavOutFile_writeFloat(outFile, outBuffer, (int)nOutput * nChannels);
+#endif
+    } while (nOutput != 0);
+
+    free(outBuffer);
+}
+
+// Writes the part of 'nSamples' output sample frames that falls into the region:
+// the first '*skip' frames are dropped and at most '*remaining' frames written.
+static void writeRegion(WavOutFile *outFile, const SAMPLETYPE *samples, uint nSamples, int nChannels, uint *skip,
+                        uint *remaining) {
+    uint num = (nSamples < *skip) ? nSamples : *skip;
+
+    samples += num * nChannels;
+    nSamples -= num;
+    *skip -= num;
+    if (nSamples > *remaining) nSamples = *remaining;
+    *remaining -= nSamples;
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    WavOutFile_writeInt(outFile, samples, (int)(nSamples * nChannels));
+#else
+    WavOutFile_writeFloat(outFile, samples, (int)(nSamples * nChannels));
+#endif
+}
+
+// Processes a region of the sound
+void processRegion(void *pSoundTouch, WavInFile *inFile, WavOutFile *outFile, uint startSample, uint endSample) {
+    int nSamples;
+    int nChannels;
+    unsigned int maxOutput;
+    unsigned int nOutput;
+    uint preroll, seekSample, skip, remaining;
+    double ratio;
+    int complete;
+    SAMPLETYPE sampleBuffer[BUFF_SIZE];
+    const SAMPLETYPE *samples = sampleBuffer;
+    SAMPLETYPE *outBuffer;
+
+    if ((inFile == NULL) || (outFile == NULL)) return;  // nothing to do.
+
+    if (endSample > WavInFile_getNumSamples(inFile)) endSample = WavInFile_getNumSamples(inFile);
+    if (startSample >= endSample) return;  // empty region
+
+    // Start reading the initial latency before the region, which is what the
+    // processing needs to produce output for the region start. The output for
+    // the pre-roll is dropped, as is the output after the region; the input is
+    // read only as long as the region output isn't complete.
+    preroll = (uint)SoundTouch_getSetting(pSoundTouch, SOUNDTOUCH_SETTING_INITIAL_LATENCY);
+    seekSample = (startSample > preroll) ? startSample - preroll : 0;
+    if (WavInFile_seekToSample(inFile, seekSample) != 0) {
+        ST_THROW_RT_ERROR("Can't seek to the start of the region in the input file");
+    }
+    ratio = SoundTouch_getInputOutputSampleRatio(pSoundTouch);
+    skip = (uint)((startSample - seekSample) * ratio + 0.5);
+    remaining = (uint)(endSample * ratio + 0.5) - (uint)(startSample * ratio + 0.5);
+
+    nChannels = (int)WavInFile_getNumChannels(inFile);
+    assert(nChannels > 0);
+    maxOutput = SoundTouch_getMaxOutput(pSoundTouch, BUFF_SIZE / nChannels);
+    outBuffer = (SAMPLETYPE *)malloc(maxOutput * nChannels * sizeof(SAMPLETYPE));
+    WavOutFile_reserve(outFile, remaining * nChannels);
+
+    while ((remaining > 0) && (WavInFile_eof(inFile) == 0)) {
+        int num;
+
 #ifdef SOUNDTOUCH_INTEGER_SAMPLES
-        WavOutFile_writeInt(outFile, sampleBuffer, nSamples * nChannels);
+        num = WavInFile_readInt(inFile, sampleBuffer, BUFF_SIZE);
 #else
-        WavOutFile_writeFloat(outFile, sampleBuffer, nSamples * nChannels);
+        num = WavInFile_readFloatInPlace(inFile, sampleBuffer, BUFF_SIZE, &samples);
 #endif
-    } while (nSamples != 0);
-}
\ No newline at end of file
+        nSamples = num / nChannels;
+        do {
+            complete = SoundTouch_process(pSoundTouch, samples, (unsigned int)nSamples, outBuffer, maxOutput, &nOutput);
+            writeRegion(outFile, outBuffer, nOutput, nChannels, &skip, &remaining);
+            nSamples = 0;
+        } while (!complete);
+    }
+
+    // the region reaches the end of the input: flush the rest out
+    if (remaining > 0) {
+        SoundTouch_flush(pSoundTouch);
+        do {
+            SoundTouch_process(pSoundTouch, NULL, 0, outBuffer, maxOutput, &nOutput);
+            writeRegion(outFile, outBuffer, nOutput, nChannels, &skip, &remaining);
+        } while ((nOutput != 0) && (remaining > 0));
+    }
+
+    free(outBuffer);
+}
+
+// Processes the whole sound at once in 'params->jobs' parallel chunks
+void processOffline(const RunParameters *params, WavInFile *inFile, WavOutFile *outFile) {
+    int nChannels;
+    uint capacity, nElems, nSamples, outSamples, pos;
+    SAMPLETYPE *input;
+    SAMPLETYPE *output;
+    void *offline;
+
+    if ((inFile == NULL) || (outFile == NULL)) return;  // nothing to do.
+
+    nChannels = (int)WavInFile_getNumChannels(inFile);
+    assert(nChannels > 0);
+
+    // Read the whole input file into memory. The length isn't known in advance
+    // when reading from 'stdin', so grow the buffer as needed.
+    capacity = BUFF_SIZE;
+    nElems = 0;
+    input = (SAMPLETYPE *)malloc(capacity * sizeof(SAMPLETYPE));
+    while (WavInFile_eof(inFile) == 0) {
+        if (capacity - nElems < BUFF_SIZE) {
+            capacity *= 2;
+            input = (SAMPLETYPE *)realloc(input, capacity * sizeof(SAMPLETYPE));
+        }
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+        nElems += (uint)WavInFile_readInt(inFile, input + nElems, BUFF_SIZE);
+#else
+        nElems += (uint)WavInFile_readFloat(inFile, input + nElems, BUFF_SIZE);
+#endif
+    }
+    nSamples = nElems / (uint)nChannels;
+
+    offline = SoundTouch_initOffline(WavInFile_getSampleRate(inFile), (uint)nChannels);
+    SoundTouch_setPitchSemiTonesOffline(offline, params->pitchDelta);
+    SoundTouch_setOutputSampleRateOffline(offline, (uint)params->outRate);
+    SoundTouch_setProcessingRateOffline(offline, (uint)params->internalRate);
+
+    outSamples = SoundTouch_getOfflineOutputLength(offline, nSamples);
+    output = (SAMPLETYPE *)malloc(outSamples * nChannels * sizeof(SAMPLETYPE));
+    outSamples = SoundTouch_processOffline(offline, input, nSamples, output, (uint)params->jobs);
+    WavOutFile_reserve(outFile, outSamples * nChannels);
+
+    // Write the output in chunks of the same size as 'process' does
+    for (pos = 0; pos < outSamples * nChannels; pos += BUFF_SIZE) {
+        int num = (int)(outSamples * nChannels - pos);
+
+        if (num > BUFF_SIZE) num = BUFF_SIZE;
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+        WavOutFile_writeInt(outFile, output + pos, num);
+#else
+        WavOutFile_writeFloat(outFile, output + pos, num);
+#endif
+    }
+
+    SoundTouch_freeOffline(offline);
+    free(output);
+    free(input);
+}
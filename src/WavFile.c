@@ -1,7 +1,25 @@
 
 #include "WavFile.h"
 
+#ifndef _WIN32
+// regular files are read and written through memory mappings
+#define WAV_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef SOUNDTOUCH_ALLOW_SSE
+#include <emmintrin.h>
+
+#include "cpu_detect.h"
+#endif
+
 static const char riffStr[] = "RIFF";
+static const char rf64Str[] = "RF64";
+static const char bw64Str[] = "BW64";
+static const char ds64Str[] = "ds64";
 static const char waveStr[] = "WAVE";
 static const char fmtStr[] = "fmt ";
 static const char factStr[] = "fact";
@@ -49,6 +67,15 @@ static void _swap16Buffer(short *pData, int numWords) {
     }
 }
 
+// helper-function to swap byte-order of buffer of 32bit integers
+static void _swap32Buffer(int *pData, int numWords) {
+    int i;
+
+    for (i = 0; i < numWords; i++) {
+        pData[i] = _swap32(&pData[i]);
+    }
+}
+
 #else  // BIG_ENDIAN
 // little-endian CPU, WAV file is ok as such
 
@@ -67,10 +94,163 @@ static short _swap16(short *wData) {
 // dummy helper-function
 static void _swap16Buffer(short *pData, int numBytes) {
     // do nothing
+    (void)pData;
+    (void)numBytes;
+}
+
+// dummy helper-function
+static void _swap32Buffer(int *pData, int numWords) {
+    // do nothing
+    (void)pData;
+    (void)numWords;
 }
 
 #endif  // BIG_ENDIAN
 
+static int saturate(float fvalue, float minval, float maxval) {
+    if (fvalue > maxval) {
+        fvalue = maxval;
+    } else if (fvalue < minval) {
+        fvalue = minval;
+    }
+    return (int)fvalue;
+}
+
+#ifdef SOUNDTOUCH_ALLOW_SSE
+//////////////////////////////////////////////////////////////////////////////
+//
+// SSE2 versions of the sample conversions of WavInFile_readFloat and
+// WavOutFile_writeFloat. They convert as many values as fit full vectors and
+// return their count, leaving the rest to the plain C loops, whose results
+// they reproduce exactly. SSE2 implies a little-endian CPU.
+
+// Converts four 32bit integers in 'v' to float and stores them scaled by 'scale'
+static inline void storeScaled4(float *dest, __m128i v, float scale) {
+    _mm_storeu_ps(dest, _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(scale)));
+}
+
+// Sign-extends the low and high four 16bit values of 'v' to 32 bits
+static inline __m128i widenLo16(__m128i v) { return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); }
+static inline __m128i widenHi16(__m128i v) { return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+
+// Scales four floats by 'scale', clips them to 'low'..'high' and truncates them
+// to integers, as 'saturate' does
+static inline __m128i saturate4(const float *src, float scale, float low, float high) {
+    __m128 value = _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(scale));
+
+    value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(low)), _mm_set1_ps(high));
+    return _mm_cvttps_epi32(value);
+}
+
+static int readFloatSSE2(float *dest, const unsigned char *src, int bytesPerSample, int numElems) {
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    switch (bytesPerSample) {
+        case 1:
+            // widen to 16 bits and remove the offset of the unsigned format
+            for (; i + 16 <= numElems; i += 16) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+                __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+                __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+
+                storeScaled4(dest + i, widenLo16(lo), 1.0f / 128.0f);
+                storeScaled4(dest + i + 4, widenHi16(lo), 1.0f / 128.0f);
+                storeScaled4(dest + i + 8, widenLo16(hi), 1.0f / 128.0f);
+                storeScaled4(dest + i + 12, widenHi16(hi), 1.0f / 128.0f);
+            }
+            break;
+
+        case 2:
+            for (; i + 8 <= numElems; i += 8) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+
+                storeScaled4(dest + i, widenLo16(v), 1.0f / 32768.0f);
+                storeScaled4(dest + i + 4, widenHi16(v), 1.0f / 32768.0f);
+            }
+            break;
+
+        case 3:
+            // gather the four 3-byte samples of 12 bytes into the top of 32bit words,
+            // which also sign-extends them. The 16-byte load reads 4 bytes beyond the
+            // samples, so stop while they are still within the data.
+            for (; 3 * i + 16 <= 3 * numElems; i += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+                __m128i v01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+                __m128i v23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+
+                storeScaled4(dest + i, _mm_slli_epi32(_mm_unpacklo_epi64(v01, v23), 8), 1.0f / 2147483648.0f);
+            }
+            break;
+
+        case 4:
+            for (; i + 4 <= numElems; i += 4) {
+                storeScaled4(dest + i, _mm_loadu_si128((const __m128i *)(src + 4 * i)), 1.0f / 2147483648.0f);
+            }
+            break;
+    }
+    return i;
+}
+
+static int writeFloatSSE2(unsigned char *dest, const float *src, int bytesPerSample, int numElems) {
+    int i = 0;
+
+    switch (bytesPerSample) {
+        case 1:
+            // both packs saturate, yet the values are already clipped to 0..255
+            for (; i + 8 <= numElems; i += 8) {
+                __m128 offset = _mm_set1_ps(128.0f);
+                __m128 lo = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), offset), offset);
+                __m128 hi = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), offset), offset);
+                __m128i v;
+
+                lo = _mm_min_ps(_mm_max_ps(lo, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+                hi = _mm_min_ps(_mm_max_ps(hi, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+                v = _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+                _mm_storel_epi64((__m128i *)(dest + i), _mm_packus_epi16(v, v));
+            }
+            break;
+
+        case 2:
+            for (; i + 8 <= numElems; i += 8) {
+                __m128i lo = saturate4(src + i, 32768.0f, -32768.0f, 32767.0f);
+                __m128i hi = saturate4(src + i + 4, 32768.0f, -32768.0f, 32767.0f);
+
+                _mm_storeu_si128((__m128i *)(dest + 2 * i), _mm_packs_epi32(lo, hi));
+            }
+            break;
+
+        case 3: {
+            // pack the low 3 bytes of the four words into 12 bytes: join the words
+            // pairwise to 6 bytes in 64bit lanes, then join the lanes. The 16-byte
+            // store writes 4 bytes beyond the samples, as the plain C loop does.
+            const __m128i mask24 = _mm_set1_epi32(0x00ffffff);
+            const __m128i maskLo = _mm_set_epi32(0, -1, 0, -1);
+
+            for (; i + 4 <= numElems; i += 4) {
+                __m128i v = _mm_and_si128(saturate4(src + i, 8388608.0f, -8388608.0f, 8388607.0f), mask24);
+                __m128i pairs = _mm_or_si128(_mm_and_si128(v, maskLo), _mm_slli_epi64(_mm_srli_epi64(v, 32), 24));
+
+                v = _mm_or_si128(_mm_move_epi64(pairs), _mm_slli_si128(_mm_srli_si128(pairs, 8), 6));
+                _mm_storeu_si128((__m128i *)(dest + 3 * i), v);
+            }
+            break;
+        }
+
+        case 4:
+            // 2147483520 is the largest float below 2^31
+            for (; i + 4 <= numElems; i += 4) {
+                __m128i v = saturate4(src + i, 2147483648.0f, -2147483648.0f, 2147483520.0f);
+
+                _mm_storeu_si128((__m128i *)(dest + 4 * i), v);
+            }
+            break;
+    }
+    return i;
+}
+#endif  // SOUNDTOUCH_ALLOW_SSE
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Class WavFileBase
@@ -106,6 +286,27 @@ void *WavFileBase_getConvBuffer(WavFileBase *fileBase, int sizeBytes) {
 // Class WavInFile
 //
 
+// Maps the file up to the end of the sample data if it is a regular file. If that
+// fails, the samples are read through 'fptr'.
+static void mapInput(WavInFile *inFile) {
+#ifdef WAV_MMAP
+    struct stat st;
+    size_t size;
+    void *map;
+
+    if ((inFile->dataOffset < 0) || (fstat(fileno(inFile->fptr), &st) != 0) || !S_ISREG(st.st_mode)) return;
+    size = (size_t)(inFile->dataOffset + inFile->dataLen);
+    if (size > (size_t)st.st_size) size = (size_t)st.st_size;
+    if (size <= (size_t)inFile->dataOffset) return;
+
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(inFile->fptr), 0);
+    if (map == MAP_FAILED) return;
+    madvise(map, size, MADV_SEQUENTIAL);
+    inFile->map = (unsigned char *)map;
+    inFile->mapSize = size;
+#endif
+}
+
 static void init(WavInFile *inFile) {
     int hdrsOk;
 
@@ -127,8 +328,13 @@ static void init(WavInFile *inFile) {
         // Something didn't match in the wav file headers
         ST_THROW_RT_ERROR("Error: Illegal wav file header format parameters.");
     }
+    if ((inFile->header.format.fixed != WAV_FORMAT_PCM) &&
+        ((inFile->header.format.fixed != WAV_FORMAT_IEEE_FLOAT) || (inFile->header.format.bits_per_sample != 32))) {
+        ST_THROW_RT_ERROR("Error: Only integer PCM and 32bit float WAV files supported.");
+    }
 
     inFile->dataRead = 0;
+    mapInput(inFile);
 }
 
 WavInFile *WavInFile_create(const char *fileName) {
@@ -146,6 +352,8 @@ WavInFile *WavInFile_create(const char *fileName) {
         ST_THROW_RT_ERROR(msg);
     }
     inFile->base = WavFileBase_create();
+    inFile->map = NULL;
+    inFile->mapSize = 0;
 
     init(inFile);
 
@@ -165,6 +373,8 @@ WavInFile *WavInFile_createWithFile(FILE *file) {
         ST_THROW_RT_ERROR("Error : Unable to access input stream for reading");
     }
     inFile->base = WavFileBase_create();
+    inFile->map = NULL;
+    inFile->mapSize = 0;
 
     init(inFile);
 
@@ -173,6 +383,9 @@ WavInFile *WavInFile_createWithFile(FILE *file) {
 
 void WavInFile_destroy(WavInFile *inFile) {
     if (inFile) {
+#ifdef WAV_MMAP
+        if (inFile->map) munmap(inFile->map, inFile->mapSize);
+#endif
         if (inFile->fptr) {
             fclose(inFile->fptr);
             inFile->fptr = NULL;
@@ -200,9 +413,50 @@ int WavInFile_checkCharTags(const WavInFile *inFile) {
     return 0;
 }
 
+// Returns 'numBytes' limited to the sample data left in the file
+static int clipDataBytes(const WavInFile *inFile, int numBytes) {
+    if (inFile->dataRead + numBytes > inFile->dataLen) {
+        // Don't read more samples than are marked available in header
+        numBytes = (int)(inFile->dataLen - inFile->dataRead);
+        assert(numBytes >= 0);
+    }
+    if (inFile->map) {
+        // nor more than the file holds
+        long long left = (long long)inFile->mapSize - inFile->dataOffset - inFile->dataRead;
+        if (numBytes > left) numBytes = (int)left;
+    }
+    return numBytes;
+}
+
+// Reads 'numBytes' bytes of sample data into 'buffer', returns the bytes read
+static int readBytes(WavInFile *inFile, void *buffer, int numBytes) {
+    if (inFile->map) {
+        memcpy(buffer, inFile->map + inFile->dataOffset + inFile->dataRead, numBytes);
+    } else {
+        numBytes = (int)fread(buffer, 1, numBytes, inFile->fptr);
+    }
+    inFile->dataRead += numBytes;
+    return numBytes;
+}
+
+// Reads '*numBytes' bytes of sample data and returns where they are, in the file
+// mapping or in the conversion buffer. Stores the bytes read into '*numBytes'.
+static const unsigned char *readBytesInPlace(WavInFile *inFile, int *numBytes) {
+    unsigned char *temp;
+
+    // sample data at an unaligned file offset is copied to the aligned conversion buffer
+    if (inFile->map && ((inFile->dataOffset & 3) == 0)) {
+        const unsigned char *data = inFile->map + inFile->dataOffset + inFile->dataRead;
+        inFile->dataRead += *numBytes;
+        return data;
+    }
+    temp = (unsigned char *)WavFileBase_getConvBuffer(inFile->base, *numBytes);
+    *numBytes = readBytes(inFile, temp, *numBytes);
+    return temp;
+}
+
 int WavInFile_read(WavInFile *inFile, unsigned char *buffer, int maxElems) {
     int numBytes;
-    uint afterDataRead;
 
     // ensure it's 8 bit format
     if (inFile->header.format.bits_per_sample != 8) {
@@ -210,27 +464,29 @@ int WavInFile_read(WavInFile *inFile, unsigned char *buffer, int maxElems) {
     }
     assert(sizeof(char) == 1);
 
-    numBytes = maxElems;
-    afterDataRead = inFile->dataRead + numBytes;
-    if (afterDataRead > inFile->header.data.data_len) {
-        // Don't read more samples than are marked available in header
-        numBytes = (int)inFile->header.data.data_len - (int)inFile->dataRead;
-        assert(numBytes >= 0);
-    }
+    numBytes = clipDataBytes(inFile, maxElems);
 
     assert(buffer);
-    numBytes = (int)fread(buffer, 1, numBytes, inFile->fptr);
-    inFile->dataRead += numBytes;
-
-    return numBytes;
+    return readBytes(inFile, buffer, numBytes);
 }
 
 int WavInFile_readInt(WavInFile *inFile, short *buffer, int maxElems) {
-    unsigned int afterDataRead;
     int numBytes;
     int numElems;
 
     assert(buffer);
+    if (inFile->header.format.fixed == WAV_FORMAT_IEEE_FLOAT) {
+        // float format, convert to 16bit
+        float *temp = (float *)WavFileBase_getConvBuffer(inFile->base, maxElems * sizeof(float));
+        int i;
+
+        numElems = WavInFile_readFloat(inFile, temp, maxElems);
+        for (i = 0; i < numElems; i++) {
+            buffer[i] = (short)saturate(temp[i] * 32768.0f, -32768.0f, 32767.0f);
+        }
+        return numElems;
+    }
+
     switch (inFile->header.format.bits_per_sample) {
         case 8: {
             // 8 bit format
@@ -250,16 +506,8 @@ int WavInFile_readInt(WavInFile *inFile, short *buffer, int maxElems) {
 
             assert(sizeof(short) == 2);
 
-            numBytes = maxElems * 2;
-            afterDataRead = inFile->dataRead + numBytes;
-            if (afterDataRead > inFile->header.data.data_len) {
-                // Don't read more samples than are marked available in header
-                numBytes = (int)inFile->header.data.data_len - (int)inFile->dataRead;
-                assert(numBytes >= 0);
-            }
-
-            numBytes = (int)fread(buffer, 1, numBytes, inFile->fptr);
-            inFile->dataRead += numBytes;
+            numBytes = clipDataBytes(inFile, maxElems * 2);
+            numBytes = readBytes(inFile, buffer, numBytes);
             numElems = numBytes / 2;
 
             // 16bit samples, swap byte order if necessary
@@ -281,10 +529,11 @@ int WavInFile_readInt(WavInFile *inFile, short *buffer, int maxElems) {
 }
 
 int WavInFile_readFloat(WavInFile *inFile, float *buffer, int maxElems) {
-    unsigned int afterDataRead;
+    const unsigned char *temp;
     int numBytes;
     int numElems;
     int bytesPerSample;
+    int done = 0;
 
     assert(buffer);
 
@@ -297,62 +546,62 @@ int WavInFile_readFloat(WavInFile *inFile, float *buffer, int maxElems) {
         ST_THROW_RT_ERROR(errorMsg);
     }
 
-    numBytes = maxElems * bytesPerSample;
-    afterDataRead = inFile->dataRead + numBytes;
-    if (afterDataRead > inFile->header.data.data_len) {
-        // Don't read more samples than are marked available in header
-        numBytes = (int)inFile->header.data.data_len - (int)inFile->dataRead;
-        assert(numBytes >= 0);
+    if (inFile->header.format.fixed == WAV_FORMAT_IEEE_FLOAT) {
+        // float samples are read as such
+        numBytes = clipDataBytes(inFile, maxElems * (int)sizeof(float));
+        numElems = readBytes(inFile, buffer, numBytes) / (int)sizeof(float);
+        _swap32Buffer((int *)buffer, numElems);
+        return numElems;
     }
 
-    // read raw data into temporary buffer
-    char *temp = (char *)WavFileBase_getConvBuffer(inFile->base, numBytes);
-    numBytes = (int)fread(temp, 1, numBytes, inFile->fptr);
-    inFile->dataRead += numBytes;
+    // get the raw data from the file mapping or read it into a temporary buffer
+    numBytes = clipDataBytes(inFile, maxElems * bytesPerSample);
+    temp = readBytesInPlace(inFile, &numBytes);
 
     numElems = numBytes / bytesPerSample;
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if (detectCPUextensions() & SUPPORT_SSE2) {
+        done = readFloatSSE2(buffer, temp, bytesPerSample, numElems);
+    }
+#endif
 
-    // swap byte ordert & convert to float, depending on sample format
+    // swap byte ordert & convert to float, depending on sample format. The scales
+    // are powers of two, so float multiplies give the exact result.
     switch (bytesPerSample) {
         case 1: {
-            unsigned char *temp2 = (unsigned char *)temp;
-            double conv = 1.0 / 128.0;
-            for (int i = 0; i < numElems; i++) {
-                buffer[i] = (float)(temp2[i] * conv - 1.0);
+            const unsigned char *temp2 = temp;
+            for (int i = done; i < numElems; i++) {
+                buffer[i] = (temp2[i] - 128) * (1.0f / 128.0f);
             }
             break;
         }
 
         case 2: {
-            short *temp2 = (short *)temp;
-            double conv = 1.0 / 32768.0;
-            for (int i = 0; i < numElems; i++) {
+            const short *temp2 = (const short *)temp;
+            for (int i = done; i < numElems; i++) {
                 short value = temp2[i];
-                buffer[i] = (float)(_swap16(&value) * conv);
+                buffer[i] = _swap16(&value) * (1.0f / 32768.0f);
             }
             break;
         }
 
         case 3: {
-            char *temp2 = (char *)temp;
-            double conv = 1.0 / 8388608.0;
-            for (int i = 0; i < numElems; i++) {
-                int value = *((int *)temp2);
-                value = _swap32(&value) & 0x00ffffff;            // take 24 bits
-                value |= (value & 0x00800000) ? 0xff000000 : 0;  // extend minus sign bits
-                buffer[i] = (float)(value * conv);
+            const unsigned char *temp2 = temp + 3 * done;
+            for (int i = done; i < numElems; i++) {
+                // assemble the 24 bits bytewise, not to read past the end of the file mapping
+                int value = temp2[0] | (temp2[1] << 8) | ((int)(signed char)temp2[2] * 65536);
+                buffer[i] = value * (1.0f / 8388608.0f);
                 temp2 += 3;
             }
             break;
         }
 
         case 4: {
-            int *temp2 = (int *)temp;
-            double conv = 1.0 / 2147483648.0;
+            const int *temp2 = (const int *)temp;
             assert(sizeof(int) == 4);
-            for (int i = 0; i < numElems; i++) {
+            for (int i = done; i < numElems; i++) {
                 int value = temp2[i];
-                buffer[i] = (float)(_swap32(&value) * conv);
+                buffer[i] = (float)_swap32(&value) * (1.0f / 2147483648.0f);
             }
             break;
         }
@@ -361,9 +610,26 @@ int WavInFile_readFloat(WavInFile *inFile, float *buffer, int maxElems) {
     return numElems;
 }
 
+int WavInFile_readFloatInPlace(WavInFile *inFile, float *buffer, int maxElems, const float **samples) {
+#ifndef _BIG_ENDIAN_
+    if (inFile->map && ((inFile->dataOffset & 3) == 0) && (inFile->header.format.fixed == WAV_FORMAT_IEEE_FLOAT)) {
+        int numBytes = clipDataBytes(inFile, maxElems * (int)sizeof(float));
+
+        *samples = (const float *)readBytesInPlace(inFile, &numBytes);
+        return numBytes / (int)sizeof(float);
+    }
+#endif
+    *samples = buffer;
+    return WavInFile_readFloat(inFile, buffer, maxElems);
+}
+
 int WavInFile_eof(const WavInFile *wavInFile) {
     // return true if all data has been read or file eof has reached
-    return (wavInFile->dataRead == wavInFile->header.data.data_len || feof(wavInFile->fptr));
+    if (wavInFile->map) {
+        return (wavInFile->dataRead == wavInFile->dataLen ||
+                wavInFile->dataOffset + wavInFile->dataRead >= (long long)wavInFile->mapSize);
+    }
+    return (wavInFile->dataRead == wavInFile->dataLen || feof(wavInFile->fptr));
 }
 
 // test if character code is between a white space ' ' and little 'z'
@@ -388,14 +654,62 @@ int WavInFile_readRIFFBlock(WavInFile *wavInFile) {
     // swap 32bit data byte order if necessary
     _swap32((int *)&(wavInFile->header.riff.package_len));
 
-    // header.riff.riff_char should equal to 'RIFF');
-    if (memcmp(riffStr, wavInFile->header.riff.riff_char, 4) != 0) return -1;
+    // header.riff.riff_char should equal to 'RIFF', or 'RF64' or 'BW64' for files
+    // with 64bit sizes
+    if ((memcmp(riffStr, wavInFile->header.riff.riff_char, 4) != 0) &&
+        (memcmp(rf64Str, wavInFile->header.riff.riff_char, 4) != 0) &&
+        (memcmp(bw64Str, wavInFile->header.riff.riff_char, 4) != 0)) {
+        return -1;
+    }
     // header.riff.wave should equal to 'WAVE'
     if (memcmp(waveStr, wavInFile->header.riff.wave, 4) != 0) return -1;
 
     return 0;
 }
 
+// Skips 'numBytes' bytes of 'fptr', with a seek if the stream allows that and
+// otherwise by reading through them. Only seekable streams can skip backwards.
+static int skipBytes(FILE *fptr, long long numBytes) {
+    char temp[256];
+
+    if ((numBytes <= LONG_MAX) && (fseek(fptr, (long)numBytes, SEEK_CUR) == 0)) return 0;
+    if (numBytes < 0) return -1;
+    while (numBytes > 0) {
+        size_t num = (numBytes < (long long)sizeof(temp)) ? (size_t)numBytes : sizeof(temp);
+
+        if (fread(temp, 1, num, fptr) != num) return -1;
+        numBytes -= (long long)num;
+    }
+    return 0;
+}
+
+// Returns the 64bit little-endian value at 'bytes'
+static long long getInt64(const unsigned char *bytes) {
+    unsigned long long value = 0;
+    int i;
+
+    for (i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return (long long)value;
+}
+
+// Reads the 'ds64' chunk that starts RF64 and BW64 files and returns the 64bit
+// size of the sample data in it, or -1 if the chunk isn't valid
+static long long readDs64Block(FILE *fptr) {
+    unsigned char ds64[24];  // label, length, 64bit RIFF size and data size
+    uint len;
+
+    if (fread(ds64, sizeof(ds64), 1, fptr) != 1) return -1;
+    if (memcmp(ds64Str, ds64, 4) != 0) return -1;
+    len = ds64[4] | (ds64[5] << 8) | (ds64[6] << 16) | ((uint)ds64[7] << 24);
+    if (len < 16) return -1;
+
+    // skip the sample count and the table of other chunk sizes
+    if (skipBytes(fptr, (long long)len - 16 + (len & 1)) != 0) return -1;
+    return getInt64(ds64 + 16);
+}
+
 int WavInFile_readHeaderBlock(FILE *fptr, WavHeader *header) {
     char label[5];
     char fmtStr[5] = "fmt ";
@@ -444,9 +758,19 @@ int WavInFile_readHeaderBlock(FILE *fptr, WavHeader *header) {
         _swap16((short *)&(header->format.byte_per_sample));  // short int byte_per_sample;
         _swap16((short *)&(header->format.bits_per_sample));  // short int bits_per_sample;
 
+        // WAVE_FORMAT_EXTENSIBLE: the format code is in the first two bytes of the
+        // subformat GUID, after the extension size, valid bits and channel mask
+        if (header->format.fixed == WAV_FORMAT_EXTENSIBLE) {
+            unsigned char extension[24];
+
+            if ((nDump < (int)sizeof(extension)) || (fread(extension, sizeof(extension), 1, fptr) != 1)) return -1;
+            header->format.fixed = (unsigned short)(extension[8] | (extension[9] << 8));
+            nDump -= (int)sizeof(extension);
+        }
+
         // if format_len is larger than expected, skip the extra data
         if (nDump > 0) {
-            fseek(fptr, nDump, SEEK_CUR);
+            if (skipBytes(fptr, nDump) != 0) return -1;
         }
 
         return 0;
@@ -482,7 +806,7 @@ int WavInFile_readHeaderBlock(FILE *fptr, WavHeader *header) {
 
         // if fact_len is larger than expected, skip the extra data
         if (nDump > 0) {
-            fseek(fptr, nDump, SEEK_CUR);
+            if (skipBytes(fptr, nDump) != 0) return -1;
         }
 
         return 0;
@@ -496,38 +820,51 @@ int WavInFile_readHeaderBlock(FILE *fptr, WavHeader *header) {
 
         return 1;
     } else {
-        uint len, i;
-        uint temp;
+        uint len;
         // unknown block
 
         // read length
         if (fread(&len, sizeof(len), 1, fptr) != 1) return -1;
-        // scan through the block
-        for (i = 0; i < len; i++) {
-            if (fread(&temp, 1, 1, fptr) != 1) return -1;
-            if (feof(fptr)) return -1;  // unexpected eof
-        }
+        _swap32((int *)&len);
+        // skip the block, and the pad byte that follows a block of odd length
+        if (skipBytes(fptr, (long long)len + (len & 1)) != 0) return -1;
     }
     return 0;
 }
 
 int WavInFile_readWavHeaders(WavInFile *wavInFile) {
+    long long ds64DataLen = -1;
     int res;
 
     memset(&(wavInFile->header), 0, sizeof(wavInFile->header));
 
     res = WavInFile_readRIFFBlock(wavInFile);
     if (res) return 1;
-    // read header blocks until data block is found
+    if (memcmp(riffStr, wavInFile->header.riff.riff_char, 4) != 0) {
+        // RF64 or BW64, whose 'ds64' chunk gives the sizes that don't fit 32 bits
+        ds64DataLen = readDs64Block(wavInFile->fptr);
+        if (ds64DataLen < 0) return 1;
+    }
+    // read header blocks until data block is found, seeking over the others
     do {
         // read header blocks
         res = WavInFile_readHeaderBlock(wavInFile->fptr, &wavInFile->header);
         if (res < 0) return 1;  // error in file structure
     } while (res == 0);
+
+    // the sample data starts here. A 'data' size of 0xFFFFFFFF means that the
+    // size is in the 'ds64' chunk.
+    wavInFile->dataOffset = ftell(wavInFile->fptr);
+    wavInFile->dataLen = wavInFile->header.data.data_len;
+    if ((ds64DataLen >= 0) && (wavInFile->header.data.data_len == 0xFFFFFFFF)) {
+        wavInFile->dataLen = ds64DataLen;
+    }
     // check that all required tags are legal
     return WavInFile_checkCharTags(wavInFile);
 }
 
+uint WavInFile_getFormat(const WavInFile *wavInFile) { return wavInFile->header.format.fixed; }
+
 uint WavInFile_getNumChannels(const WavInFile *wavInFile) { return wavInFile->header.format.channel_number; }
 
 uint WavInFile_getNumBits(const WavInFile *wavInFile) { return wavInFile->header.format.bits_per_sample; }
@@ -538,12 +875,27 @@ uint WavInFile_getBytesPerSample(const WavInFile *wavInFile) {
 
 uint WavInFile_getSampleRate(const WavInFile *wavInFile) { return wavInFile->header.format.sample_rate; }
 
-uint WavInFile_getDataSizeInBytes(const WavInFile *wavInFile) { return wavInFile->header.data.data_len; }
+uint WavInFile_getDataSizeInBytes(const WavInFile *wavInFile) {
+    return (wavInFile->dataLen > UINT_MAX) ? UINT_MAX : (uint)wavInFile->dataLen;
+}
 
 uint WavInFile_getNumSamples(const WavInFile *wavInFile) {
     if (wavInFile->header.format.byte_per_sample == 0) return 0;
-    if (wavInFile->header.format.fixed > 1) return wavInFile->header.fact.fact_sample_len;
-    return wavInFile->header.data.data_len / (unsigned short)wavInFile->header.format.byte_per_sample;
+    if ((wavInFile->header.format.fixed != WAV_FORMAT_PCM) && (wavInFile->header.format.fixed != WAV_FORMAT_IEEE_FLOAT)) {
+        return wavInFile->header.fact.fact_sample_len;
+    }
+    return (uint)(wavInFile->dataLen / (unsigned short)wavInFile->header.format.byte_per_sample);
+}
+
+int WavInFile_seekToSample(WavInFile *wavInFile, uint sample) {
+    long long pos = (long long)sample * wavInFile->header.format.byte_per_sample;
+
+    if (pos > wavInFile->dataLen) return -1;
+    // the mapping needs no seek. Otherwise seek relative to the current position,
+    // which pipes can do forward by reading through the data.
+    if ((wavInFile->map == NULL) && (skipBytes(wavInFile->fptr, pos - wavInFile->dataRead) != 0)) return -1;
+    wavInFile->dataRead = pos;
+    return 0;
 }
 
 uint WavInFile_getLengthMS(const WavInFile *wavInFile) {
@@ -561,19 +913,109 @@ uint WavInFile_getLengthMS(const WavInFile *wavInFile) {
 // Class WavOutFile
 //
 
+#ifdef WAV_MMAP
+// Unmaps the file and cuts it to the data written, for writing on with stdio
+static void unmapOutput(WavOutFile *outFile) {
+    long end = (long)sizeof(WavHeader) + outFile->bytesWritten;
+
+    if (outFile->map == NULL) return;
+    munmap(outFile->map, outFile->mapSize);
+    outFile->map = NULL;
+    outFile->mapSize = 0;
+    if (ftruncate(fileno(outFile->fptr), end) != 0) {
+        ST_THROW_RT_ERROR("Error while writing to a wav file.");
+    }
+    fseek(outFile->fptr, end, SEEK_SET);
+}
+
+// Grows the file to 'size' bytes with disk space allocated for them, so that
+// stores into the mapping can't fail for a full disk. Returns nonzero if the
+// space isn't available.
+static int allocateOutput(int fd, off_t end, size_t size) {
+#ifdef __APPLE__
+    // no posix_fallocate, write with stdio instead
+    (void)fd;
+    (void)end;
+    (void)size;
+    return -1;
+#else
+    return posix_fallocate(fd, end, (off_t)size - end);
+#endif
+}
+
+// Grows the file to 'size' bytes and maps it. Returns -1 if that fails, leaving
+// the file unmapped for writing with stdio, which reports a full disk as an error.
+static int mapOutput(WavOutFile *outFile, size_t size) {
+    int fd = fileno(outFile->fptr);
+    off_t end = (off_t)(sizeof(WavHeader) + outFile->bytesWritten);
+    void *map;
+
+    unmapOutput(outFile);
+    if (allocateOutput(fd, end, size) != 0) {
+        map = MAP_FAILED;
+    } else {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        // drop a partial allocation
+        if (ftruncate(fd, end) != 0) {
+            ST_THROW_RT_ERROR("Error while writing to a wav file.");
+        }
+        return -1;
+    }
+    outFile->map = (unsigned char *)map;
+    outFile->mapSize = size;
+    return 0;
+}
+#endif
+
+// Returns where to put 'numBytes' bytes of sample data: in the file mapping, grown
+// by half when full, or in the conversion buffer. 'commitBytes' then adds them to
+// the file.
+static void *getWriteSpace(WavOutFile *outFile, int numBytes) {
+#ifdef WAV_MMAP
+    if (outFile->map) {
+        size_t end = sizeof(WavHeader) + outFile->bytesWritten;
+        // 4 bytes of slack for the 32bit stores of 24bit samples
+        size_t needed = end + numBytes + 4;
+
+        if (needed > outFile->mapSize) {
+            size_t size = outFile->mapSize + outFile->mapSize / 2;
+            mapOutput(outFile, (size > needed) ? size : needed);
+        }
+        if (outFile->map) return outFile->map + end;
+    }
+#endif
+    return WavFileBase_getConvBuffer(outFile->base, numBytes + 7);
+}
+
+// Adds 'numBytes' bytes put to 'data', as returned by 'getWriteSpace', to the file
+static void commitBytes(WavOutFile *outFile, const void *data, int numBytes) {
+    if (outFile->map == NULL) {
+        int res = (int)fwrite(data, 1, numBytes, outFile->fptr);
+        if (res != numBytes) {
+            ST_THROW_RT_ERROR("Error while writing to a wav file.");
+        }
+    }
+    outFile->bytesWritten += numBytes;
+}
+
 WavOutFile *WavOutFile_create(const char *fileName, int sampleRate, int bits, int channels) {
     WavOutFile *outFile = (WavOutFile *)malloc(sizeof(WavOutFile));
     if (outFile == NULL) {
         ST_THROW_RT_ERROR("Error: Unable to allocate memory for WavOutFile");
     }
     outFile->bytesWritten = 0;
-    outFile->fptr = fopen(fileName, "wb");
+    // opened for reading too, which a writable shared mapping of the file requires
+    outFile->fptr = fopen(fileName, "w+b");
     if (outFile->fptr == NULL) {
         char msg[256];
         snprintf(msg, sizeof(msg), "Error: Unable to open file \"%s\" for writing.", fileName);
         assert(0 && msg);
     }
     outFile->base = WavFileBase_create();
+    outFile->map = NULL;
+    outFile->mapSize = 0;
 
     WavOutFile_fillInHeader(outFile, sampleRate, bits, channels);
     WavOutFile_writeHeader(outFile);
@@ -593,6 +1035,8 @@ WavOutFile *WavOutFile_createWithFile(FILE *file, int sampleRate, int bits, int
         assert(0 && msg);
     }
     outFile->base = WavFileBase_create();
+    outFile->map = NULL;
+    outFile->mapSize = 0;
 
     WavOutFile_fillInHeader(outFile, sampleRate, bits, channels);
     WavOutFile_writeHeader(outFile);
@@ -640,11 +1084,18 @@ void WavOutFile_fillInHeader(WavOutFile *outFile, unsigned int sampleRate, unsig
 }
 
 void WavOutFile_finishHeader(WavOutFile *outFile) {
+#ifdef WAV_MMAP
+    unmapOutput(outFile);
+#endif
     outFile->header.riff.package_len = outFile->bytesWritten + sizeof(WavHeader) - sizeof(WavRiff) + 4;
     outFile->header.data.data_len = outFile->bytesWritten;
     outFile->header.fact.fact_sample_len = outFile->bytesWritten / outFile->header.format.byte_per_sample;
 
     WavOutFile_writeHeader(outFile);
+    // stdio reports a full disk only when its buffer goes out
+    if ((fflush(outFile->fptr) != 0) || ferror(outFile->fptr)) {
+        ST_THROW_RT_ERROR("Error while writing to a wav file.");
+    }
 }
 
 void WavOutFile_writeHeader(WavOutFile *outFile) {
@@ -674,37 +1125,49 @@ void WavOutFile_writeHeader(WavOutFile *outFile) {
 }
 
 void WavOutFile_write(WavOutFile *outFile, const unsigned char *buffer, int numElems) {
-    int res;
+    void *temp;
 
     if (outFile->header.format.bits_per_sample != 8) {
         ST_THROW_RT_ERROR("Error: WavOutFile::write(const char*, int) accepts only 8bit samples.");
     }
     assert(sizeof(char) == 1);
 
-    res = (int)fwrite(buffer, 1, numElems, outFile->fptr);
-    if (res != numElems) {
-        ST_THROW_RT_ERROR("Error while writing to a wav file.");
+    if (outFile->map) {
+        temp = getWriteSpace(outFile, numElems);
+        memcpy(temp, buffer, numElems);
+        commitBytes(outFile, temp, numElems);
+    } else {
+        commitBytes(outFile, buffer, numElems);
     }
-
-    outFile->bytesWritten += numElems;
 }
 
 void WavOutFile_writeInt(WavOutFile *outFile, const short *buffer, int numElems) {
-    int res;
-
     // 16 bit samples
     if (numElems < 1) return;  // nothing to do
 
+    if (outFile->header.format.fixed == WAV_FORMAT_IEEE_FLOAT) {
+        // float format
+        float *temp = (float *)getWriteSpace(outFile, numElems * sizeof(float));
+        int i;
+
+        for (i = 0; i < numElems; i++) {
+            temp[i] = buffer[i] * (1.0f / 32768.0f);
+        }
+        _swap32Buffer((int *)temp, numElems);
+        commitBytes(outFile, temp, numElems * sizeof(float));
+        return;
+    }
+
     switch (outFile->header.format.bits_per_sample) {
         case 8: {
             int i;
-            unsigned char *temp = (unsigned char *)WavFileBase_getConvBuffer(outFile->base, numElems);
+            unsigned char *temp = (unsigned char *)getWriteSpace(outFile, numElems);
             // convert from 16bit format to 8bit format
             for (i = 0; i < numElems; i++) {
                 temp[i] = (unsigned char)(buffer[i] / 256 + 128);
             }
             // write in 8bit format
-            WavOutFile_write(outFile, temp, numElems);
+            commitBytes(outFile, temp, numElems);
             break;
         }
 
@@ -712,16 +1175,11 @@ void WavOutFile_writeInt(WavOutFile *outFile, const short *buffer, int numElems)
             // 16bit format
 
             // use temp buffer to swap byte order if necessary
-            short *pTemp = (short *)WavFileBase_getConvBuffer(outFile->base, numElems * sizeof(short));
+            short *pTemp = (short *)getWriteSpace(outFile, numElems * sizeof(short));
             memcpy(pTemp, buffer, numElems * 2);
             _swap16Buffer(pTemp, numElems);
 
-            res = (int)fwrite(pTemp, 2, numElems, outFile->fptr);
-
-            if (res != numElems) {
-                ST_THROW_RT_ERROR("Error while writing to a wav file.");
-            }
-            outFile->bytesWritten += 2 * numElems;
+            commitBytes(outFile, pTemp, 2 * numElems);
             break;
         }
 
@@ -736,29 +1194,34 @@ void WavOutFile_writeInt(WavOutFile *outFile, const short *buffer, int numElems)
     }
 }
 
-static int saturate(float fvalue, float minval, float maxval) {
-    if (fvalue > maxval) {
-        fvalue = maxval;
-    } else if (fvalue < minval) {
-        fvalue = minval;
-    }
-    return (int)fvalue;
-}
-
 void WavOutFile_writeFloat(WavOutFile *outFile, const float *buffer, int numElems) {
     int numBytes;
     int bytesPerSample;
+    int done = 0;
 
     if (numElems == 0) return;
 
     bytesPerSample = outFile->header.format.bits_per_sample / 8;
     numBytes = numElems * bytesPerSample;
-    void *temp = WavFileBase_getConvBuffer(outFile->base, numBytes + 7);
+    void *temp = getWriteSpace(outFile, numBytes);
+
+    if (outFile->header.format.fixed == WAV_FORMAT_IEEE_FLOAT) {
+        // float samples are written as such
+        memcpy(temp, buffer, numBytes);
+        _swap32Buffer((int *)temp, numElems);
+        commitBytes(outFile, temp, numBytes);
+        return;
+    }
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if (detectCPUextensions() & SUPPORT_SSE2) {
+        done = writeFloatSSE2((unsigned char *)temp, buffer, bytesPerSample, numElems);
+    }
+#endif
 
     switch (bytesPerSample) {
         case 1: {
             unsigned char *temp2 = (unsigned char *)temp;
-            for (int i = 0; i < numElems; i++) {
+            for (int i = done; i < numElems; i++) {
                 temp2[i] = (unsigned char)saturate(buffer[i] * 128.0f + 128.0f, 0.0f, 255.0f);
             }
             break;
@@ -766,7 +1229,7 @@ void WavOutFile_writeFloat(WavOutFile *outFile, const float *buffer, int numElem
 
         case 2: {
             short *temp2 = (short *)temp;
-            for (int i = 0; i < numElems; i++) {
+            for (int i = done; i < numElems; i++) {
                 short value = (short)saturate(buffer[i] * 32768.0f, -32768.0f, 32767.0f);
                 temp2[i] = _swap16(&value);
             }
@@ -774,8 +1237,8 @@ void WavOutFile_writeFloat(WavOutFile *outFile, const float *buffer, int numElem
         }
 
         case 3: {
-            char *temp2 = (char *)temp;
-            for (int i = 0; i < numElems; i++) {
+            char *temp2 = (char *)temp + 3 * done;
+            for (int i = done; i < numElems; i++) {
                 int value = saturate(buffer[i] * 8388608.0f, -8388608.0f, 8388607.0f);
                 *((int *)temp2) = _swap32(&value);
                 temp2 += 3;
@@ -785,8 +1248,10 @@ void WavOutFile_writeFloat(WavOutFile *outFile, const float *buffer, int numElem
 
         case 4: {
             int *temp2 = (int *)temp;
-            for (int i = 0; i < numElems; i++) {
-                int value = saturate(buffer[i] * 2147483648.0f, -2147483648.0f, 2147483647.0f);
+            // 2147483520 is the largest float below 2^31; 2147483647 would round up to
+            // 2^31, which overflows the conversion to int
+            for (int i = done; i < numElems; i++) {
+                int value = saturate(buffer[i] * 2147483648.0f, -2147483648.0f, 2147483520.0f);
                 temp2[i] = _swap32(&value);
             }
             break;
@@ -796,10 +1261,32 @@ void WavOutFile_writeFloat(WavOutFile *outFile, const float *buffer, int numElem
             assert(0);
     }
 
-    int res = (int)fwrite(temp, 1, numBytes, outFile->fptr);
+    commitBytes(outFile, temp, numBytes);
+}
 
-    if (res != numBytes) {
-        ST_THROW_RT_ERROR("Error while writing to a wav file.");
+int WavOutFile_setFormat(WavOutFile *outFile, uint format) {
+    if ((outFile->bytesWritten != 0) || ((format != WAV_FORMAT_PCM) && (format != WAV_FORMAT_IEEE_FLOAT))) return -1;
+    if ((format == WAV_FORMAT_IEEE_FLOAT) && (outFile->header.format.bits_per_sample != 32)) return -1;
+
+    outFile->header.format.fixed = (unsigned short)format;
+    WavOutFile_writeHeader(outFile);
+    return 0;
+}
+
+int WavOutFile_reserve(WavOutFile *outFile, uint numElems) {
+#ifdef WAV_MMAP
+    struct stat st;
+    size_t size = sizeof(WavHeader) + outFile->bytesWritten +
+                  (size_t)numElems * (outFile->header.format.bits_per_sample / 8) + 4;
+
+    if (outFile->map) {
+        return (size > outFile->mapSize) ? mapOutput(outFile, size) : 0;
     }
-    outFile->bytesWritten += numBytes;
+    if ((fstat(fileno(outFile->fptr), &st) != 0) || !S_ISREG(st.st_mode)) return -1;
+    // the header is still in the stdio buffer
+    fflush(outFile->fptr);
+    return mapOutput(outFile, size);
+#else
+    return -1;
+#endif
 }
@@ -76,11 +76,23 @@ static void _DEBUG_SAVE_AAFIR_COEFFS(SAMPLETYPE *coeffs, int len) {
 
 AAFilter::AAFilter(uint len) {
     pFIR = FIRFilter::newInstance();
+    for (uint i = 0; i < AAFILTER_CACHE_SIZE; i++) {
+        cache[i].cutoffFreq = -1;
+        cache[i].length = 0;
+        cache[i].coeffs = NULL;
+    }
+    cacheNext = 0;
     cutoffFreq = 0.5;
+    length = 0;
     setLength(len);
 }
 
-AAFilter::~AAFilter() { delete pFIR; }
+AAFilter::~AAFilter() {
+    delete pFIR;
+    for (uint i = 0; i < AAFILTER_CACHE_SIZE; i++) {
+        delete[] cache[i].coeffs;
+    }
+}
 
 // Sets new anti-alias filter cut-off edge frequency, scaled to
 // sampling frequency (nyquist frequency = 0.5).
@@ -92,6 +104,8 @@ void AAFilter::setCutoffFreq(double newCutoffFreq) {
 
 // Sets number of FIR filter taps
 void AAFilter::setLength(uint newLength) {
+    // the coefficients only depend on the length and the cut-off frequency
+    if (newLength == length) return;
     length = newLength;
     calculateCoeffs();
 }
@@ -110,8 +124,25 @@ void AAFilter::calculateCoeffs() {
     assert(cutoffFreq >= 0);
     assert(cutoffFreq <= 0.5);
 
+    // use a cached design if available
+    for (i = 0; i < AAFILTER_CACHE_SIZE; i++) {
+        if ((cache[i].length == length) && (cache[i].cutoffFreq == cutoffFreq)) {
+            pFIR->setCoefficients(cache[i].coeffs, length, 14);
+            return;
+        }
+    }
+
+    // reuse the oldest cache slot for the new design
+    if (cache[cacheNext].length != length) {
+        delete[] cache[cacheNext].coeffs;
+        cache[cacheNext].coeffs = new SAMPLETYPE[length];
+    }
+    coeffs = cache[cacheNext].coeffs;
+    cache[cacheNext].cutoffFreq = cutoffFreq;
+    cache[cacheNext].length = length;
+    cacheNext = (cacheNext + 1) % AAFILTER_CACHE_SIZE;
+
     work = new double[length];
-    coeffs = new SAMPLETYPE[length];
 
     wc = 2.0 * PI * cutoffFreq;
     tempCoeff = TWOPI / (double)length;
@@ -162,7 +193,6 @@ void AAFilter::calculateCoeffs() {
     _DEBUG_SAVE_AAFIR_COEFFS(coeffs, length);
 
     delete[] work;
-    delete[] coeffs;
 }
 
 // Applies the filter to the given sequence of samples.
@@ -196,3 +226,12 @@ uint AAFilter::evaluate(FIFOSampleBuffer &dest, FIFOSampleBuffer &src) const {
 }
 
 uint AAFilter::getLength() const { return pFIR->getLength(); }
+
+uint AAFilter::getAllocatedBytes() const {
+    uint bytes = (uint)sizeof(*pFIR) + pFIR->getAllocatedBytes();
+
+    for (uint i = 0; i < AAFILTER_CACHE_SIZE; i++) {
+        if (cache[i].coeffs) bytes += cache[i].length * sizeof(SAMPLETYPE);
+    }
+    return bytes;
+}
@@ -42,6 +42,9 @@
 
 namespace soundtouch {
 
+/// Number of recently designed coefficient sets kept by AAFilter
+#define AAFILTER_CACHE_SIZE 4
+
 class AAFilter {
    protected:
     class FIRFilter *pFIR;
@@ -52,6 +55,18 @@ class AAFilter {
     /// num of filter taps
     uint length;
 
+    /// Recently designed filters, so that returning to a cutoff frequency used a
+    /// while ago, e.g. with pitch modulation, needn't redesign the filter
+    struct CachedDesign {
+        double cutoffFreq;
+        uint length;
+        SAMPLETYPE *coeffs;
+    };
+    CachedDesign cache[AAFILTER_CACHE_SIZE];
+
+    /// Cache slot to be replaced next
+    uint cacheNext;
+
     /// Calculate the FIR coefficients realizing the given cutoff-frequency
     void calculateCoeffs();
 
@@ -65,11 +80,17 @@ class AAFilter {
     /// frequencies than that.
     void setCutoffFreq(double newCutoffFreq);
 
+    /// Returns the current cut-off frequency, scaled to sampling frequency.
+    double getCutoffFreq() const { return cutoffFreq; }
+
     /// Sets number of FIR filter taps, i.e. ~filter complexity
     void setLength(uint newLength);
 
     uint getLength() const;
 
+    /// Returns the amount of heap memory allocated by the filter, in bytes.
+    uint getAllocatedBytes() const;
+
     /// Applies the filter to the given sequence of samples.
     /// Note : The amount of outputted samples is by value of 'filter length'
     /// smaller than the amount of input samples.
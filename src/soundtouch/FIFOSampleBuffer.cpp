@@ -43,8 +43,36 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "SampleConvert.h"
+#include "cpu_detect.h"
+
 using namespace soundtouch;
 
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+
+// Conversions between float samples and bfloat16. The 16-bit integer storage uses
+// the S16 conversions of 'SampleConvert' instead.
+
+// float to bfloat16, i.e. upper 16 bits of the float with round-to-nearest-even
+static void floatToBf16(short *dest, const float *src, uint count) {
+    for (uint i = 0; i < count; i++) {
+        uint bits;
+        memcpy(&bits, src + i, sizeof(bits));
+        bits += 0x7fff + ((bits >> 16) & 1);
+        dest[i] = (short)(bits >> 16);
+    }
+}
+
+// bfloat16 to float
+static void bf16ToFloat(float *dest, const short *src, uint count) {
+    for (uint i = 0; i < count; i++) {
+        uint bits = (uint)(unsigned short)src[i] << 16;
+        memcpy(dest + i, &bits, sizeof(bits));
+    }
+}
+
+#endif  // SOUNDTOUCH_FLOAT_SAMPLES
+
 // Constructor
 FIFOSampleBuffer::FIFOSampleBuffer(int numChannels) {
     assert(numChannels > 0);
@@ -53,6 +81,8 @@ FIFOSampleBuffer::FIFOSampleBuffer(int numChannels) {
     bufferUnaligned = NULL;
     samplesInBuffer = 0;
     bufferPos = 0;
+    parkedSamples = NULL;
+    parkedFormat = STORAGE_FLOAT;
     channels = (uint)numChannels;
     ensureCapacity(32);  // allocate initial capacity
 }
@@ -60,6 +90,7 @@ FIFOSampleBuffer::FIFOSampleBuffer(int numChannels) {
 // destructor
 FIFOSampleBuffer::~FIFOSampleBuffer() {
     delete[] bufferUnaligned;
+    delete[] parkedSamples;
     bufferUnaligned = NULL;
     buffer = NULL;
 }
@@ -69,6 +100,7 @@ void FIFOSampleBuffer::setChannels(int numChannels) {
     uint usedBytes;
 
     if (!verifyNumberOfChannels(numChannels)) return;
+    if (isParked()) unpark();
 
     usedBytes = channels * samplesInBuffer;
     channels = (uint)numChannels;
@@ -106,6 +138,28 @@ void FIFOSampleBuffer::putSamples(uint nSamples) {
     samplesInBuffer += nSamples;
 }
 
+// Adds 'numSamples' pcs of samples from the per-channel 'planes' buffers to
+// the sample buffer, interleaving them straight into the free buffer space.
+void FIFOSampleBuffer::putSamplesPlanar(const SAMPLETYPE *const *planes, uint nSamples) {
+    interleave(ptrEnd(nSamples), planes, 0, nSamples, channels);
+    samplesInBuffer += nSamples;
+}
+
+// Adds 'numSamples' pcs of samples in external 'format', converting them
+// straight into the free buffer space.
+void FIFOSampleBuffer::putSamplesFormat(const void *samples, const void *const *planes, int format, uint nSamples) {
+    SAMPLETYPE *dest = ptrEnd(nSamples);
+
+    if (samples) {
+        SampleConvert::toSamples(dest, samples, format, nSamples * channels);
+    } else if (format == SAMPLE_FORMAT_NATIVE) {
+        interleave(dest, (const SAMPLETYPE *const *)planes, 0, nSamples, channels);
+    } else {
+        SampleConvert::toSamplesPlanar(dest, planes, 0, format, nSamples, channels);
+    }
+    samplesInBuffer += nSamples;
+}
+
 // Returns a pointer to the end of the used part of the sample buffer (i.e.
 // where the new samples are to be inserted). This function may be used for
 // inserting new samples into the sample buffer directly. Please be careful!
@@ -123,54 +177,135 @@ SAMPLETYPE *FIFOSampleBuffer::ptrEnd(uint slackCapacity) {
     return buffer + samplesInBuffer * channels;
 }
 
-// Returns a pointer to the beginning of the currently non-outputted samples.
-// This function is provided for accessing the output samples directly.
-// Please be careful!
-//
-// When using this function to output samples, also remember to 'remove' the
-// outputted samples from the buffer by calling the
-// 'receiveSamples(numSamples)' function
-SAMPLETYPE *FIFOSampleBuffer::ptrBegin() {
-    assert(buffer);
-    return buffer + bufferPos * channels;
-}
-
 // Ensures that the buffer has enough capacity, i.e. space for _at least_
 // 'capacityRequirement' number of samples. The buffer is grown in steps of
 // 4 kilobytes to eliminate the need for frequently growing up the buffer,
 // as well as to round the buffer size up to the virtual memory page size.
 void FIFOSampleBuffer::ensureCapacity(uint capacityRequirement) {
-    SAMPLETYPE *tempUnaligned, *temp;
-
+    if (isParked()) unpark();
     if (capacityRequirement > getCapacity()) {
-        // enlarge the buffer in 4kbyte steps (round up to next 4k boundary)
-        sizeInBytes = (capacityRequirement * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
-        assert(sizeInBytes % 2 == 0);
-        tempUnaligned = new SAMPLETYPE[sizeInBytes / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE)];
-        if (tempUnaligned == NULL) {
-            ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
-        }
-        // Align the buffer to begin at 16byte cache line boundary for optimal performance
-        temp = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(tempUnaligned);
-        if (samplesInBuffer) {
-            memcpy(temp, ptrBegin(), samplesInBuffer * channels * sizeof(SAMPLETYPE));
-        }
-        delete[] bufferUnaligned;
-        buffer = temp;
-        bufferUnaligned = tempUnaligned;
-        bufferPos = 0;
+        reallocate(capacityRequirement);
     } else {
         // simply rewind the buffer (if necessary)
         rewind();
     }
 }
 
+// Reallocates the buffer for 'capacity' samples, rounded up to next 4 kilobyte
+// boundary, and copies the current contents to the beginning of the new buffer.
+void FIFOSampleBuffer::reallocate(uint capacity) {
+    SAMPLETYPE *tempUnaligned, *temp;
+
+    // size the buffer in 4kbyte steps (round up to next 4k boundary)
+    sizeInBytes = (capacity * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
+    assert(sizeInBytes % 2 == 0);
+    tempUnaligned = new SAMPLETYPE[(sizeInBytes + SOUNDTOUCH_ALIGNMENT) / sizeof(SAMPLETYPE)];
+    if (tempUnaligned == NULL) {
+        ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
+    }
+    // Align the buffer to begin at cache line boundary for optimal performance
+    temp = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER(tempUnaligned);
+    if (samplesInBuffer) {
+        memcpy(temp, ptrBegin(), samplesInBuffer * channels * sizeof(SAMPLETYPE));
+    }
+    delete[] bufferUnaligned;
+    buffer = temp;
+    bufferUnaligned = tempUnaligned;
+    bufferPos = 0;
+}
+
+// Releases excess buffer memory. The buffer keeps room for at least 'capacityLimit'
+// samples and for the current contents, and is reallocated only if that halves the
+// allocation at minimum, to avoid shrinking and re-growing the buffer in turns.
+void FIFOSampleBuffer::shrink(uint capacityLimit) {
+    uint capacity, newSize;
+
+    capacity = (capacityLimit > samplesInBuffer) ? capacityLimit : samplesInBuffer;
+    if (capacity < 32) capacity = 32;  // same as initial capacity
+    newSize = (capacity * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
+    if (2 * newSize <= sizeInBytes) {
+        reallocate(capacity);
+    }
+}
+
+// Returns the amount of heap memory allocated for the buffer, in bytes
+uint FIFOSampleBuffer::getAllocatedBytes() const {
+    uint bytes = bufferUnaligned ? sizeInBytes + SOUNDTOUCH_ALIGNMENT : 0;
+
+    if (parkedSamples) bytes += samplesInBuffer * channels * sizeof(short);
+    return bytes;
+}
+
+// Converts the buffer contents into compact 16-bit storage and releases the sample
+// buffer memory until the buffer is accessed again.
+bool FIFOSampleBuffer::park(int format) {
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    uint count;
+
+    if ((format != STORAGE_INT16) && (format != STORAGE_BF16)) return false;
+    if (isParked()) return true;
+
+    count = samplesInBuffer * channels;
+    if (count) {
+        parkedSamples = new short[count];
+        const float *src = ptrBegin();
+        uint done = 0;
+
+        if (format == STORAGE_INT16) {
+            SampleConvert::fromSamples(parkedSamples, src, SAMPLE_FORMAT_S16, count);
+        } else {
+#ifdef SOUNDTOUCH_ALLOW_SSE
+            if (detectCPUextensions() & SUPPORT_SSE2) done = floatToBf16SSE2(parkedSamples, src, count);
+#endif  // SOUNDTOUCH_ALLOW_SSE
+            floatToBf16(parkedSamples + done, src + done, count - done);
+        }
+    }
+    delete[] bufferUnaligned;
+    bufferUnaligned = NULL;
+    buffer = NULL;
+    sizeInBytes = 0;
+    bufferPos = 0;
+    parkedFormat = format;
+    return true;
+#else
+    (void)format;
+    return false;
+#endif
+}
+
+// Restores the parked contents into a newly allocated sample buffer
+void FIFOSampleBuffer::unpark() {
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    uint numParked = samplesInBuffer;
+    int format = parkedFormat;
+
+    assert(isParked());
+    // allocate an empty buffer so that 'reallocate' won't try copying old contents
+    parkedFormat = STORAGE_FLOAT;
+    samplesInBuffer = 0;
+    reallocate((numParked > 32) ? numParked : 32);
+    samplesInBuffer = numParked;
+    if (parkedSamples) {
+        uint count = numParked * channels;
+        uint done = 0;
+
+        if (format == STORAGE_INT16) {
+            SampleConvert::toSamples(buffer, parkedSamples, SAMPLE_FORMAT_S16, count);
+        } else {
+#ifdef SOUNDTOUCH_ALLOW_SSE
+            if (detectCPUextensions() & SUPPORT_SSE2) done = bf16ToFloatSSE2(buffer, parkedSamples, count);
+#endif  // SOUNDTOUCH_ALLOW_SSE
+            bf16ToFloat(buffer + done, parkedSamples + done, count - done);
+        }
+        delete[] parkedSamples;
+        parkedSamples = NULL;
+    }
+#endif
+}
+
 // Returns the current buffer capacity in terms of samples
 uint FIFOSampleBuffer::getCapacity() const { return sizeInBytes / (channels * sizeof(SAMPLETYPE)); }
 
-// Returns the number of samples currently in the buffer
-uint FIFOSampleBuffer::numSamples() const { return samplesInBuffer; }
-
 // Output samples from beginning of the sample buffer. Copies demanded number
 // of samples to output and removes them from the sample buffer. If there
 // are less than 'numsample' samples in the buffer, returns all available.
@@ -185,10 +320,92 @@ uint FIFOSampleBuffer::receiveSamples(SAMPLETYPE *output, uint maxSamples) {
     return receiveSamples(num);
 }
 
+// Output samples from beginning of the sample buffer into per-channel buffers.
+//
+// Returns number of samples copied.
+uint FIFOSampleBuffer::receiveSamplesPlanar(SAMPLETYPE *const *planes, uint maxSamples) {
+    uint num;
+
+    num = (maxSamples > samplesInBuffer) ? samplesInBuffer : maxSamples;
+
+    deinterleave(planes, 0, ptrBegin(), num, channels);
+    return receiveSamples(num);
+}
+
+// Output samples from beginning of the sample buffer in external 'format'.
+//
+// Returns number of samples copied.
+uint FIFOSampleBuffer::receiveSamplesFormat(void *samples, void *const *planes, int format, uint maxSamples) {
+    uint num;
+
+    num = (maxSamples > samplesInBuffer) ? samplesInBuffer : maxSamples;
+
+    if (samples) {
+        SampleConvert::fromSamples(samples, ptrBegin(), format, num * channels);
+    } else {
+        SampleConvert::fromSamplesPlanar(planes, 0, ptrBegin(), format, num, channels);
+    }
+    return receiveSamples(num);
+}
+
+// Interleaves samples of separate channel buffers into a single buffer. Mono and
+// stereo have dedicated loops as those are by far the most common cases.
+void FIFOSampleBuffer::interleave(SAMPLETYPE *dest, const SAMPLETYPE *const *planes, uint offset, uint numSamples,
+                                  uint numChannels) {
+    uint i, c;
+
+    if (numChannels == 1) {
+        memcpy(dest, planes[0] + offset, sizeof(SAMPLETYPE) * numSamples);
+    } else if (numChannels == 2) {
+        const SAMPLETYPE *left = planes[0] + offset;
+        const SAMPLETYPE *right = planes[1] + offset;
+        for (i = 0; i < numSamples; i++) {
+            dest[2 * i] = left[i];
+            dest[2 * i + 1] = right[i];
+        }
+    } else {
+        for (c = 0; c < numChannels; c++) {
+            const SAMPLETYPE *src = planes[c] + offset;
+            SAMPLETYPE *pdest = dest + c;
+            for (i = 0; i < numSamples; i++) {
+                *pdest = src[i];
+                pdest += numChannels;
+            }
+        }
+    }
+}
+
+// De-interleaves samples of a single buffer into separate channel buffers.
+void FIFOSampleBuffer::deinterleave(SAMPLETYPE *const *planes, uint offset, const SAMPLETYPE *src, uint numSamples,
+                                    uint numChannels) {
+    uint i, c;
+
+    if (numChannels == 1) {
+        memcpy(planes[0] + offset, src, sizeof(SAMPLETYPE) * numSamples);
+    } else if (numChannels == 2) {
+        SAMPLETYPE *left = planes[0] + offset;
+        SAMPLETYPE *right = planes[1] + offset;
+        for (i = 0; i < numSamples; i++) {
+            left[i] = src[2 * i];
+            right[i] = src[2 * i + 1];
+        }
+    } else {
+        for (c = 0; c < numChannels; c++) {
+            SAMPLETYPE *pdest = planes[c] + offset;
+            const SAMPLETYPE *psrc = src + c;
+            for (i = 0; i < numSamples; i++) {
+                pdest[i] = *psrc;
+                psrc += numChannels;
+            }
+        }
+    }
+}
+
 // Removes samples from the beginning of the sample buffer without copying them
 // anywhere. Used to reduce the number of samples in the buffer, when accessing
 // the sample buffer with the 'ptrBegin' function.
 uint FIFOSampleBuffer::receiveSamples(uint maxSamples) {
+    if (isParked()) unpark();
     if (maxSamples >= samplesInBuffer) {
         uint temp;
 
@@ -203,13 +420,13 @@ uint FIFOSampleBuffer::receiveSamples(uint maxSamples) {
     return maxSamples;
 }
 
-// Returns nonzero if the sample buffer is empty
-int FIFOSampleBuffer::isEmpty() const { return (samplesInBuffer == 0) ? 1 : 0; }
-
 // Clears the sample buffer
 void FIFOSampleBuffer::clear() {
     samplesInBuffer = 0;
     bufferPos = 0;
+    // a parked buffer stays parked, just without contents
+    delete[] parkedSamples;
+    parkedSamples = NULL;
 }
 
 /// allow trimming (downwards) amount of samples in pipeline.
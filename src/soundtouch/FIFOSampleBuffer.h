@@ -48,13 +48,16 @@ namespace soundtouch {
 ///
 /// Notice that in case of stereo audio, one sample is considered to consist of
 /// both channel data.
-class FIFOSampleBuffer : public FIFOSamplePipe {
+///
+/// The class is final so that calls through a 'FIFOSampleBuffer' pointer bind
+/// statically, and the accessors defined here inline into the callers.
+class FIFOSampleBuffer final : public FIFOSamplePipe {
    private:
     /// Sample buffer.
     SAMPLETYPE *buffer;
 
     // Raw unaligned buffer memory. 'buffer' is made aligned by pointing it to first
-    // 16-byte aligned location of this buffer
+    // SOUNDTOUCH_ALIGNMENT aligned location of this buffer
     SAMPLETYPE *bufferUnaligned;
 
     /// Sample buffer size in bytes
@@ -78,10 +81,38 @@ class FIFOSampleBuffer : public FIFOSamplePipe {
     /// Ensures that the buffer has capacity for at least this many samples.
     void ensureCapacity(uint capacityRequirement);
 
+    /// Reallocates the buffer for 'capacity' samples and moves the current contents
+    /// to the beginning of the new buffer.
+    void reallocate(uint capacity);
+
+    /// Buffer contents in compact 16-bit format while the buffer is parked, see 'park'.
+    short *parkedSamples;
+
+    /// Format of 'parkedSamples', STORAGE_FLOAT if the buffer isn't parked.
+    int parkedFormat;
+
+    /// Restores parked buffer contents back to the sample buffer.
+    void unpark();
+
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    // SSE2 versions of the bfloat16 conversions. Convert as many values as fit full
+    // vectors and return their count, leaving the rest to the plain C++ loops.
+    static uint floatToBf16SSE2(short *dest, const float *src, uint count);
+    static uint bf16ToFloatSSE2(float *dest, const short *src, uint count);
+#endif  // SOUNDTOUCH_ALLOW_SSE
+
     /// Returns current capacity.
     uint getCapacity() const;
 
    public:
+    /// Storage formats for parked buffer contents, see 'park'.
+    enum StorageFormat {
+        STORAGE_FLOAT = 0,  ///< Native sample type, i.e. parking disabled
+        STORAGE_INT16 = 1,  ///< 16-bit integer scaled to +-32768, ~96 dB dynamic range.
+                            ///< Samples beyond +-1.0 are clipped.
+        STORAGE_BF16 = 2    ///< bfloat16, i.e. float with 8-bit mantissa, full float range
+    };
+
     /// Constructor
     FIFOSampleBuffer(int numChannels = 2  ///< Number of channels, 1=mono, 2=stereo.
                                           ///< Default is stereo.
@@ -97,7 +128,11 @@ class FIFOSampleBuffer : public FIFOSamplePipe {
     /// When using this function to output samples, also remember to 'remove' the
     /// output samples from the buffer by calling the
     /// 'receiveSamples(numSamples)' function
-    virtual SAMPLETYPE *ptrBegin();
+    virtual SAMPLETYPE *ptrBegin() {
+        if (isParked()) unpark();
+        assert(buffer);
+        return buffer + bufferPos * channels;
+    }
 
     /// Returns a pointer to the end of the used part of the sample buffer (i.e.
     /// where the new samples are to be inserted). This function may be used for
@@ -128,6 +163,21 @@ class FIFOSampleBuffer : public FIFOSamplePipe {
     virtual void putSamples(uint numSamples  ///< Number of samples been inserted.
     );
 
+    /// Adds 'numSamples' pcs of samples from separate per-channel buffers to the
+    /// sample buffer. The channel data is interleaved directly into the buffer.
+    void putSamplesPlanar(const SAMPLETYPE *const *planes,  ///< One sample buffer per channel.
+                          uint numSamples                   ///< Number of samples to insert.
+    );
+
+    /// Adds 'numSamples' pcs of samples in an external sample format, converting
+    /// them directly into the buffer. The samples are taken from the interleaved
+    /// 'samples' buffer or, if that is NULL, from per-channel 'planes'.
+    void putSamplesFormat(const void *samples,        ///< Interleaved samples, or NULL.
+                          const void *const *planes,  ///< One sample buffer per channel if 'samples' is NULL.
+                          int format,                 ///< Sample format, see SampleConvert.h
+                          uint numSamples             ///< Number of samples to insert.
+    );
+
     /// Output samples from beginning of the sample buffer. Copies requested samples to
     /// output buffer and removes them from the sample buffer. If there are less than
     /// 'numsample' samples in the buffer, returns all that available.
@@ -145,8 +195,37 @@ class FIFOSampleBuffer : public FIFOSamplePipe {
     virtual uint receiveSamples(uint maxSamples  ///< Remove this many samples from the beginning of pipe.
     );
 
+    /// Output samples from beginning of the sample buffer into separate per-channel
+    /// buffers. Otherwise works like 'receiveSamples(output, maxSamples)'.
+    ///
+    /// \return Number of samples returned.
+    uint receiveSamplesPlanar(SAMPLETYPE *const *planes,  ///< One output buffer per channel.
+                              uint maxSamples             ///< How many samples to receive at max.
+    );
+
+    /// Output samples from beginning of the sample buffer in an external sample format,
+    /// into the interleaved 'samples' buffer or, if that is NULL, into per-channel
+    /// 'planes'. Integer formats are clipped. Otherwise works like 'receiveSamples'.
+    ///
+    /// \return Number of samples returned.
+    uint receiveSamplesFormat(void *samples,        ///< Interleaved output buffer, or NULL.
+                              void *const *planes,  ///< One output buffer per channel if 'samples' is NULL.
+                              int format,           ///< Sample format, see SampleConvert.h
+                              uint maxSamples       ///< How many samples to receive at max.
+    );
+
+    /// Interleaves 'numSamples' samples from per-channel buffers 'planes', starting
+    /// at sample offset 'offset', into 'dest'.
+    static void interleave(SAMPLETYPE *dest, const SAMPLETYPE *const *planes, uint offset, uint numSamples,
+                           uint numChannels);
+
+    /// De-interleaves 'numSamples' samples from 'src' into per-channel buffers 'planes',
+    /// starting at sample offset 'offset'.
+    static void deinterleave(SAMPLETYPE *const *planes, uint offset, const SAMPLETYPE *src, uint numSamples,
+                             uint numChannels);
+
     /// Returns number of samples currently available.
-    virtual uint numSamples() const;
+    virtual uint numSamples() const { return samplesInBuffer; }
 
     /// Sets number of channels, 1 = mono, 2 = stereo.
     void setChannels(int numChannels);
@@ -155,7 +234,7 @@ class FIFOSampleBuffer : public FIFOSamplePipe {
     int getChannels() { return channels; }
 
     /// Returns nonzero if there aren't any samples available for outputting.
-    virtual int isEmpty() const;
+    virtual int isEmpty() const { return (samplesInBuffer == 0) ? 1 : 0; }
 
     /// Clears all the samples.
     virtual void clear();
@@ -166,6 +245,29 @@ class FIFOSampleBuffer : public FIFOSamplePipe {
 
     /// Add silence to end of buffer
     void addSilent(uint nSamples);
+
+    /// Releases buffer memory beyond what's needed for 'capacityLimit' samples or for
+    /// the samples currently in the buffer, whichever is larger. The buffer is
+    /// reallocated only if that frees at least half of the current allocation, so
+    /// calling this regularly doesn't cause repeated reallocations.
+    void shrink(uint capacityLimit);
+
+    /// Returns the amount of heap memory allocated for the buffer, in bytes.
+    uint getAllocatedBytes() const;
+
+    /// Converts the buffer contents into the compact 16-bit format 'format' (see
+    /// 'StorageFormat') and releases the sample buffer memory. Meant for buffers of
+    /// streams that go idle. The buffer is restored transparently on next access,
+    /// with the contents rounded to the precision of the storage format. STORAGE_INT16
+    /// also clips samples beyond full scale, so streams with headroom above +-1.0 need
+    /// STORAGE_BF16.
+    ///
+    /// Returns 'true' if the buffer was parked. Parking is available with floating
+    /// point samples only.
+    bool park(int format);
+
+    /// Returns nonzero if the buffer contents are currently parked.
+    bool isParked() const { return parkedFormat != STORAGE_FLOAT; }
 };
 
 }  // namespace soundtouch
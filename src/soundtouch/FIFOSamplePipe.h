@@ -116,6 +116,14 @@ class FIFOSamplePipe {
     /// allow trimming (downwards) amount of samples in pipeline.
     /// Returns adjusted amount of samples
     virtual uint adjustAmountOfSamples(uint numSamples) = 0;
+
+    /// Returns the amount of heap memory used by the processing stage, in bytes.
+    /// Zero unless the stage implements it.
+    virtual uint getBufferMemoryUsage() const { return 0; }
+
+    /// Releases sample buffer memory exceeding 'capacityLimit' samples per buffer,
+    /// if the stage implements it.
+    virtual void shrinkBuffers(uint capacityLimit) { (void)capacityLimit; }
 };
 
 /// Base-class for sound processing routines working in FIFO principle. With this base
@@ -45,10 +45,14 @@
 #include <memory.h>
 #include <stdlib.h>
 
+#include "FIFOSampleBuffer.h"
 #include "cpu_detect.h"
 
 using namespace soundtouch;
 
+// Number of output samples per block of the planar multichannel routine
+#define PLANAR_BLOCK_SAMPLES 256
+
 /*****************************************************************************
  *
  * Implementation of the class 'FIRFilter'
@@ -62,11 +66,18 @@ FIRFilter::FIRFilter() {
     lengthDiv8 = 0;
     filterCoeffs = NULL;
     filterCoeffsStereo = NULL;
+    filterCoeffsUnaligned = NULL;
+    filterCoeffsStereoUnaligned = NULL;
+    bUseStereoCoeffs = true;
+    planarRows = NULL;
+    planarRowsUnaligned = NULL;
+    planarRowsSize = 0;
 }
 
 FIRFilter::~FIRFilter() {
-    delete[] filterCoeffs;
-    delete[] filterCoeffsStereo;
+    delete[] filterCoeffsUnaligned;
+    delete[] filterCoeffsStereoUnaligned;
+    delete[] planarRowsUnaligned;
 }
 
 // Usual C-version of the filter routine for stereo sound
@@ -146,55 +157,49 @@ uint FIRFilter::evaluateFilterMono(SAMPLETYPE *dest, const SAMPLETYPE *src, uint
     return end;
 }
 
+// Filter routine for other channel counts: de-interleaves blocks of the input into
+// contiguous per-channel rows, so that each channel is filtered as one stream by
+// the (SIMD) mono routine, and interleaves the results back.
 uint FIRFilter::evaluateFilterMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples, uint numChannels) {
-    int j, end;
-
-#ifdef SOUNDTOUCH_FLOAT_SAMPLES
-    // when using floating point samples, use a scaler instead of a divider
-    // because division is much slower operation than multiplying.
-    double dScaler = 1.0 / (double)resultDivider;
-#endif
+    SAMPLETYPE *inRows[SOUNDTOUCH_MAX_CHANNELS];
+    SAMPLETYPE *outRows[SOUNDTOUCH_MAX_CHANNELS];
+    // keep the rows aligned
+    uint stride = (PLANAR_BLOCK_SAMPLES + length + 15) & ~15u;
+    uint done = 0;
+    uint c;
 
     assert(length != 0);
     assert(src != NULL);
     assert(dest != NULL);
     assert(filterCoeffs != NULL);
-    assert(numChannels < 16);
-
-    // hint compiler autovectorization that loop length is divisible by 8
-    int ilength = length & -8;
+    assert(numChannels <= SOUNDTOUCH_MAX_CHANNELS);
 
-    end = numChannels * (numSamples - ilength);
-
-#pragma omp parallel for
-    for (j = 0; j < end; j += numChannels) {
-        const SAMPLETYPE *ptr;
-        LONG_SAMPLETYPE sums[16];
-        uint c;
-        int i;
-
-        for (c = 0; c < numChannels; c++) {
-            sums[c] = 0;
-        }
-
-        ptr = src + j;
+    if (planarRowsSize < 2 * numChannels * stride) {
+        delete[] planarRowsUnaligned;
+        planarRowsSize = 2 * numChannels * stride;
+        planarRowsUnaligned = new SAMPLETYPE[planarRowsSize + SOUNDTOUCH_ALIGNMENT / sizeof(SAMPLETYPE)];
+        planarRows = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER(planarRowsUnaligned);
+    }
+    for (c = 0; c < numChannels; c++) {
+        inRows[c] = planarRows + c * stride;
+        outRows[c] = planarRows + (numChannels + c) * stride;
+    }
 
-        for (i = 0; i < ilength; i++) {
-            SAMPLETYPE coef = filterCoeffs[i];
-            for (c = 0; c < numChannels; c++) {
-                sums[c] += ptr[0] * coef;
-                ptr++;
-            }
-        }
+    while (done + length < numSamples) {
+        uint block = numSamples - length - done;
+        uint count = 0;
 
+        if (block > PLANAR_BLOCK_SAMPLES) block = PLANAR_BLOCK_SAMPLES;
+        FIFOSampleBuffer::deinterleave(inRows, 0, src + done * numChannels, block + length, numChannels);
         for (c = 0; c < numChannels; c++) {
-#ifdef SOUNDTOUCH_INTEGER_SAMPLES
-            sums[c] >>= resultDivFactor;
-#endif  // SOUNDTOUCH_INTEGER_SAMPLES
-            dest[j + c] = (SAMPLETYPE)sums[c];
+            count = evaluateFilterMono(outRows[c], inRows[c], block + length);
         }
+        FIFOSampleBuffer::interleave(dest + done * numChannels, outRows, 0, count, numChannels);
+        done += count;
+        // the SIMD mono routine leaves the remainder of the last block for next call
+        if (count < block) break;
     }
-    return numSamples - ilength;
+    return done;
 }
 
 // Set filter coeffiecients and length.
@@ -204,6 +209,29 @@ void FIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint u
     assert(newLength > 0);
     if (newLength % 8) ST_THROW_RT_ERROR("FIR filter length not divisible by 8");
 
+    if ((newLength != length) || (filterCoeffsUnaligned == NULL)) {
+        lengthDiv8 = newLength / 8;
+        length = lengthDiv8 * 8;
+        assert(length == newLength);
+
+        // Align the coefficient arrays to cache line boundary so that the vectorized
+        // filter loops can use aligned loads. Reallocate only when the length changes,
+        // as the coefficients may get updated frequently.
+        delete[] filterCoeffsUnaligned;
+        filterCoeffsUnaligned = new SAMPLETYPE[length + SOUNDTOUCH_ALIGNMENT / sizeof(SAMPLETYPE)];
+        filterCoeffs = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER(filterCoeffsUnaligned);
+        delete[] filterCoeffsStereoUnaligned;
+        filterCoeffsStereoUnaligned = NULL;
+        filterCoeffsStereo = NULL;
+        if (bUseStereoCoeffs) {
+            filterCoeffsStereoUnaligned = new SAMPLETYPE[length * 2 + SOUNDTOUCH_ALIGNMENT / sizeof(SAMPLETYPE)];
+            filterCoeffsStereo = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER(filterCoeffsStereoUnaligned);
+        }
+    }
+
+    resultDivFactor = uResultDivFactor;
+    resultDivider = (SAMPLETYPE)::pow(2.0, (int)resultDivFactor);
+
 #ifdef SOUNDTOUCH_FLOAT_SAMPLES
     // scale coefficients already here if using floating samples
     double scale = 1.0 / resultDivider;
@@ -211,28 +239,31 @@ void FIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint u
     short scale = 1;
 #endif
 
-    lengthDiv8 = newLength / 8;
-    length = lengthDiv8 * 8;
-    assert(length == newLength);
-
-    resultDivFactor = uResultDivFactor;
-    resultDivider = (SAMPLETYPE)::pow(2.0, (int)resultDivFactor);
-
-    delete[] filterCoeffs;
-    filterCoeffs = new SAMPLETYPE[length];
-    delete[] filterCoeffsStereo;
-    filterCoeffsStereo = new SAMPLETYPE[length * 2];
     for (uint i = 0; i < length; i++) {
         filterCoeffs[i] = (SAMPLETYPE)(coeffs[i] * scale);
+    }
+    if (filterCoeffsStereo) {
         // create also stereo set of filter coefficients: this allows compiler
         // to autovectorize filter evaluation much more efficiently
-        filterCoeffsStereo[2 * i] = (SAMPLETYPE)(coeffs[i] * scale);
-        filterCoeffsStereo[2 * i + 1] = (SAMPLETYPE)(coeffs[i] * scale);
+        for (uint i = 0; i < length; i++) {
+            filterCoeffsStereo[2 * i] = (SAMPLETYPE)(coeffs[i] * scale);
+            filterCoeffsStereo[2 * i + 1] = (SAMPLETYPE)(coeffs[i] * scale);
+        }
     }
 }
 
 uint FIRFilter::getLength() const { return length; }
 
+// Returns the amount of heap memory allocated for the filter coefficients
+uint FIRFilter::getAllocatedBytes() const {
+    uint bytes = 0;
+
+    if (filterCoeffsUnaligned) bytes += length * sizeof(SAMPLETYPE) + SOUNDTOUCH_ALIGNMENT;
+    if (filterCoeffsStereoUnaligned) bytes += 2 * length * sizeof(SAMPLETYPE) + SOUNDTOUCH_ALIGNMENT;
+    if (planarRowsUnaligned) bytes += planarRowsSize * sizeof(SAMPLETYPE) + SOUNDTOUCH_ALIGNMENT;
+    return bytes;
+}
+
 // Applies the filter to the given sequence of samples.
 //
 // Note : The amount of outputted samples is by value of 'filter_length'
@@ -54,10 +54,24 @@ class FIRFilter {
     // Result divider value.
     SAMPLETYPE resultDivider;
 
-    // Memory for filter coefficients
+    // Memory for filter coefficients, aligned to SOUNDTOUCH_ALIGNMENT boundary
     SAMPLETYPE *filterCoeffs;
     SAMPLETYPE *filterCoeffsStereo;
 
+    // Raw unaligned memory behind 'filterCoeffs' and 'filterCoeffsStereo'
+    SAMPLETYPE *filterCoeffsUnaligned;
+    SAMPLETYPE *filterCoeffsStereoUnaligned;
+
+    // Flag: does 'evaluateFilterStereo' use 'filterCoeffsStereo'? SIMD subclasses
+    // with own stereo coefficient layout clear this to save the memory.
+    bool bUseStereoCoeffs;
+
+    // Per-channel rows of the planar multichannel routine, see 'evaluateFilterMulti',
+    // aligned to SOUNDTOUCH_ALIGNMENT boundary
+    SAMPLETYPE *planarRows;
+    SAMPLETYPE *planarRowsUnaligned;
+    uint planarRowsSize;
+
     virtual uint evaluateFilterStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples) const;
     virtual uint evaluateFilterMono(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples) const;
     virtual uint evaluateFilterMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples, uint numChannels);
@@ -82,6 +96,9 @@ class FIRFilter {
     uint getLength() const;
 
     virtual void setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint uResultDivFactor);
+
+    /// Returns the amount of heap memory allocated for the filter coefficients, in bytes.
+    virtual uint getAllocatedBytes() const;
 };
 
 // Optional subclasses that implement CPU-specific optimizations:
@@ -101,6 +118,8 @@ class FIRFilterMMX : public FIRFilter {
     ~FIRFilterMMX();
 
     virtual void setCoefficients(const short *coeffs, uint newLength, uint uResultDivFactor);
+
+    virtual uint getAllocatedBytes() const;
 };
 
 #endif  // SOUNDTOUCH_ALLOW_MMX
@@ -112,13 +131,17 @@ class FIRFilterSSE : public FIRFilter {
     float *filterCoeffsUnalign;
     float *filterCoeffsAlign;
 
+    virtual uint evaluateFilterMono(float *dest, const float *src, uint numSamples) const;
     virtual uint evaluateFilterStereo(float *dest, const float *src, uint numSamples) const;
+    virtual uint evaluateFilterMulti(float *dest, const float *src, uint numSamples, uint numChannels);
 
    public:
     FIRFilterSSE();
     ~FIRFilterSSE();
 
     virtual void setCoefficients(const float *coeffs, uint newLength, uint uResultDivFactor);
+
+    virtual uint getAllocatedBytes() const;
 };
 
 #endif  // SOUNDTOUCH_ALLOW_SSE
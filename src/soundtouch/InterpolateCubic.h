@@ -42,6 +42,7 @@ class InterpolateCubic : public TransposerBase {
     virtual int transposeMono(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     virtual int transposeStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     virtual int transposeMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+    virtual int getInputMargin() const { return 4; }
 
     double fract;
 
@@ -46,6 +46,7 @@ class InterpolateLinearInteger : public TransposerBase {
     virtual int transposeMono(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     virtual int transposeStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     virtual int transposeMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+    virtual int getInputMargin() const { return 1; }
 
    public:
     InterpolateLinearInteger();
@@ -67,6 +68,7 @@ class InterpolateLinearFloat : public TransposerBase {
     virtual int transposeMono(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     virtual int transposeStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     virtual int transposeMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+    virtual int getInputMargin() const { return 1; }
 
    public:
     InterpolateLinearFloat();
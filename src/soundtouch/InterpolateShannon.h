@@ -47,6 +47,7 @@ class InterpolateShannon : public TransposerBase {
     int transposeMono(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     int transposeStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
     int transposeMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+    int getInputMargin() const { return 8; }
 
     double fract;
 
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'ParameterMailbox' : Hands processing parameters over from control threads
+/// to the thread that runs the processing, without locks on the processing side.
+///
+/// Control threads 'post' new parameter values and the processing thread
+/// 'fetch'es the latest complete snapshot of them at a block boundary. The
+/// snapshots are kept in three slots that are passed around with an atomic
+/// index exchange, so the processing thread never waits for a writer and never
+/// sees a half-written snapshot.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ParameterMailbox_H
+#define ParameterMailbox_H
+
+#include <atomic>
+
+#include "STTypes.h"
+
+namespace soundtouch {
+
+class ParameterMailbox {
+   public:
+    /// Parameters that can be posted
+    enum Parameter { PARAM_RATE = 0, PARAM_TEMPO, PARAM_PITCH, NUM_PARAMS };
+
+    /// Snapshot of the posted parameters. Only parameters whose bit (1 << Parameter)
+    /// is set in 'posted' have ever been posted; the rest of 'values' is undefined.
+    struct Snapshot {
+        double values[NUM_PARAMS];
+        uint posted;
+    };
+
+   private:
+    /// Slot index mask, and flag in 'middle' telling that the middle slot holds a
+    /// snapshot not yet fetched
+    enum { SLOT_MASK = 3, SLOT_FRESH = 4 };
+
+    Snapshot slots[3];
+
+    /// Slot handed over between writer and reader, plus the SLOT_FRESH flag
+    std::atomic<uint> middle;
+
+    /// Slot owned by the writer
+    uint back;
+
+    /// Slot owned by the reader
+    uint front;
+
+    /// Parameter values posted so far, owned by the writer
+    Snapshot pending;
+
+    /// Serializes concurrent writers. Held for a few stores only, and never
+    /// touched by the reader.
+    std::atomic_flag writerBusy;
+
+   public:
+    ParameterMailbox() : middle(1), back(0), front(2) {
+        pending.posted = 0;
+        writerBusy.clear();
+    }
+
+    /// Posts a new value for 'param'. Callable from any thread.
+    void post(Parameter param, double value) {
+        while (writerBusy.test_and_set(std::memory_order_acquire)) {
+        }
+        pending.values[param] = value;
+        pending.posted |= 1u << param;
+        slots[back] = pending;
+        back = middle.exchange(back | SLOT_FRESH, std::memory_order_acq_rel) & SLOT_MASK;
+        writerBusy.clear(std::memory_order_release);
+    }
+
+    /// Fetches the latest snapshot into 'snapshot' if anything has been posted since
+    /// the previous fetch. Call from the processing thread only.
+    ///
+    /// \return 'true' if a new snapshot was fetched.
+    bool fetch(Snapshot &snapshot) {
+        if ((middle.load(std::memory_order_relaxed) & SLOT_FRESH) == 0) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & SLOT_MASK;
+        snapshot = slots[front];
+        return true;
+    }
+};
+
+}  // namespace soundtouch
+#endif
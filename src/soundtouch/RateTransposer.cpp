@@ -34,6 +34,7 @@
 #include "RateTransposer.h"
 
 #include <assert.h>
+#include <math.h>
 #include <memory.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -60,7 +61,9 @@ RateTransposer::RateTransposer() : FIFOProcessor(&outputBuffer) {
 
     // Instantiates the anti-alias filter
     pAAFilter = new AAFilter(64);
-    pTransposer = TransposerBase::newInstance();
+    bRampFilter = false;
+    algorithm = TransposerBase::getAlgorithm();
+    pTransposer = TransposerBase::newInstance(algorithm);
     clear();
 }
 
@@ -69,6 +72,19 @@ RateTransposer::~RateTransposer() {
     delete pTransposer;
 }
 
+// Changes the interpolation algorithm, keeping the rate and channel count
+void RateTransposer::setAlgorithm(TransposerBase::ALGORITHM a) {
+    if (a == algorithm) return;
+
+    TransposerBase *newTransposer = TransposerBase::newInstance(a);
+    newTransposer->setChannels(pTransposer->numChannels);
+    newTransposer->setRate(pTransposer->rate);
+    delete pTransposer;
+    pTransposer = newTransposer;
+    algorithm = a;
+    clear();
+}
+
 /// Enables/disables the anti-alias filter. Zero to disable, nonzero to enable
 void RateTransposer::enableAAFilter(bool newMode) {
 #ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
@@ -86,39 +102,90 @@ AAFilter *RateTransposer::getAAFilter() { return pAAFilter; }
 // Sets new target iRate. Normal iRate = 1.0, smaller values represent slower
 // iRate, larger faster iRates.
 void RateTransposer::setRate(double newRate) {
-    double fCutoff;
+    // also cancels a possible rate ramp in progress
+    pTransposer->setRateRamp(newRate, 0);
+    bRampFilter = false;
+    updateAAFilter(getCutoff(newRate), false);
+}
 
-    pTransposer->setRate(newRate);
+// Glides the rate gradually to 'newRate' over 'rampLength' input samples. The rate
+// passes through all values between the current and the target rate, so the filter
+// must suit both ends of the ramp.
+void RateTransposer::setRateRamp(double newRate, int rampLength) {
+    double fCutoff = getCutoff(newRate);
+    double fCurrent = getCutoff(pTransposer->rate);
 
-    // design a new anti-alias filter
-    if (newRate > 1.0) {
-        fCutoff = 0.5 / newRate;
-    } else {
-        fCutoff = 0.5 * newRate;
+    pTransposer->setRateRamp(newRate, rampLength);
+    bRampFilter = pTransposer->isRamping();
+    updateAAFilter(bRampFilter && (fCurrent < fCutoff) ? fCurrent : fCutoff, true);
+}
+
+// Returns the anti-alias cut-off for the given rate
+double RateTransposer::getCutoff(double rate) { return (rate > 1.0) ? 0.5 / rate : 0.5 * rate; }
+
+// Sets the anti-alias filter cut-off. A current design slightly below the requested
+// cut-off is kept to avoid redesigning the filter when the rate is modulated, but
+// never one above it, which would let aliasing through.
+void RateTransposer::updateAAFilter(double fCutoff, bool quantize) {
+    double fDesigned = pAAFilter->getCutoffFreq();
+
+    if ((fDesigned <= fCutoff) && (fCutoff - fDesigned < AA_CUTOFF_TOLERANCE * 0.5 * fCutoff)) return;
+    if (quantize) {
+        // round down to a point of a logarithmic grid
+        double step = log(1.0 + AA_CUTOFF_TOLERANCE);
+        fCutoff = exp(floor(log(fCutoff) / step) * step);
+        if (fCutoff > 0.5) fCutoff = 0.5;
     }
+
+    // design a new anti-alias filter, or get a recently used one from cache
     pAAFilter->setCutoffFreq(fCutoff);
 }
 
 // Adds 'nSamples' pcs of samples from the 'samples' memory position into
 // the input of the object.
-void RateTransposer::putSamples(const SAMPLETYPE *samples, uint nSamples) { processSamples(samples, nSamples); }
+void RateTransposer::putSamples(const SAMPLETYPE *samples, uint nSamples) {
+    if (nSamples == 0) return;
 
-// Transposes sample rate by applying anti-alias filter to prevent folding.
-// Returns amount of samples returned in the "dest" buffer.
-// The maximum amount of samples that can be returned at a time is set by
-// the 'set_returnBuffer_size' function.
-void RateTransposer::processSamples(const SAMPLETYPE *src, uint nSamples) {
-    uint count;
+    // Store samples to input buffer
+    inputBuffer.putSamples(samples, nSamples);
+    processSamples();
+}
 
+// Adds 'nSamples' pcs of samples from the per-channel 'planes' buffers into
+// the input of the object.
+void RateTransposer::putSamplesPlanar(const SAMPLETYPE *const *planes, uint nSamples) {
     if (nSamples == 0) return;
 
     // Store samples to input buffer
-    inputBuffer.putSamples(src, nSamples);
+    inputBuffer.putSamplesPlanar(planes, nSamples);
+    processSamples();
+}
+
+// Adds 'nSamples' pcs of samples in external 'format' into the input of the object.
+void RateTransposer::putSamplesFormat(const void *samples, const void *const *planes, int format, uint nSamples) {
+    if (nSamples == 0) return;
+
+    // Convert samples into input buffer
+    inputBuffer.putSamplesFormat(samples, planes, format, nSamples);
+    processSamples();
+}
+
+// Adds 'nSamples' pcs of silent samples into the input of the object.
+void RateTransposer::addSilent(uint nSamples) {
+    if (nSamples == 0) return;
 
+    inputBuffer.addSilent(nSamples);
+    processSamples();
+}
+
+// Transposes sample rate by applying anti-alias filter to prevent folding.
+// Processes the samples collected into 'inputBuffer' and stores the result
+// into 'outputBuffer'.
+void RateTransposer::processSamples() {
     // If anti-alias filter is turned off, simply transpose without applying
     // the filter
     if (bUseAAFilter == false) {
-        count = pTransposer->transpose(outputBuffer, inputBuffer);
+        pTransposer->transpose(outputBuffer, inputBuffer);
         return;
     }
 
@@ -145,6 +212,12 @@ void RateTransposer::processSamples(const SAMPLETYPE *src, uint nSamples) {
         // Transpose the AA-filtered samples in "midBuffer"
         pTransposer->transpose(outputBuffer, midBuffer);
     }
+
+    if (bRampFilter && !pTransposer->isRamping()) {
+        // the rate glide is over, follow the target rate from the next batch on
+        bRampFilter = false;
+        updateAAFilter(getCutoff(pTransposer->rate), true);
+    }
 }
 
 // Sets the number of channels, 1 = mono, 2 = stereo
@@ -183,6 +256,26 @@ int RateTransposer::getLatency() const {
     return pTransposer->getLatency() + ((bUseAAFilter) ? (pAAFilter->getLength() / 2) : 0);
 }
 
+/// Return heap memory used by the sample buffers and the anti-alias filter
+uint RateTransposer::getBufferMemoryUsage() const {
+    return inputBuffer.getAllocatedBytes() + midBuffer.getAllocatedBytes() + outputBuffer.getAllocatedBytes() +
+           pAAFilter->getAllocatedBytes();
+}
+
+/// Release excess sample buffer memory
+void RateTransposer::shrinkBuffers(uint capacityLimit) {
+    inputBuffer.shrink(capacityLimit);
+    midBuffer.shrink(capacityLimit);
+    outputBuffer.shrink(capacityLimit);
+}
+
+/// Park sample buffers into compact storage
+void RateTransposer::parkBuffers(int format) {
+    inputBuffer.park(format);
+    midBuffer.park(format);
+    outputBuffer.park(format);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // TransposerBase - Base class for interpolation
@@ -191,34 +284,65 @@ int RateTransposer::getLatency() const {
 // static function to set interpolation algorithm
 void TransposerBase::setAlgorithm(TransposerBase::ALGORITHM a) { TransposerBase::algorithm = a; }
 
+TransposerBase::ALGORITHM TransposerBase::getAlgorithm() { return TransposerBase::algorithm; }
+
 // Transposes the sample rate of the given samples using linear interpolation.
 // Returns the number of samples returned in the "dest" buffer
 int TransposerBase::transpose(FIFOSampleBuffer &dest, FIFOSampleBuffer &src) {
     int numSrcSamples = src.numSamples();
-    int sizeDemand = (int)((double)numSrcSamples / rate) + 8;
-    int numOutput;
+    double minRate = ((rampRemaining > 0) && (rampTarget < rate)) ? rampTarget : rate;
+    int sizeDemand = (int)((double)numSrcSamples / minRate) + 8;
+    int numOutput = 0;
+    int numConsumed = 0;
+    int margin = getInputMargin();
     SAMPLETYPE *psrc = src.ptrBegin();
     SAMPLETYPE *pdest = dest.ptrEnd(sizeDemand);
 
+    // During a rate ramp, transpose one input sample at a time and update the
+    // rate in between
+    while ((rampRemaining > 0) && (numSrcSamples - numConsumed > margin)) {
+        int count = 1 + margin;
+
+        numOutput += transposeBlock(pdest + numOutput * numChannels, psrc + numConsumed * numChannels, count);
+        numConsumed += count;
+        rampRemaining -= count;
+        if (rampRemaining > 0) {
+            setRate(rate + rampStep * count);
+        } else {
+            rampRemaining = 0;
+            setRate(rampTarget);
+        }
+    }
+
+    int count = numSrcSamples - numConsumed;
+    numOutput += transposeBlock(pdest + numOutput * numChannels, psrc + numConsumed * numChannels, count);
+    numConsumed += count;
+
+    dest.putSamples(numOutput);
+    src.receiveSamples(numConsumed);
+    return numOutput;
+}
+
+// Transposes 'srcSamples' samples with the routine for the current channel count.
+// Sets 'srcSamples' to the number of input samples consumed.
+int TransposerBase::transposeBlock(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples) {
 #ifndef USE_MULTICH_ALWAYS
     if (numChannels == 1) {
-        numOutput = transposeMono(pdest, psrc, numSrcSamples);
+        return transposeMono(dest, src, srcSamples);
     } else if (numChannels == 2) {
-        numOutput = transposeStereo(pdest, psrc, numSrcSamples);
-    } else
-#endif  // USE_MULTICH_ALWAYS
-    {
-        assert(numChannels > 0);
-        numOutput = transposeMulti(pdest, psrc, numSrcSamples);
+        return transposeStereo(dest, src, srcSamples);
     }
-    dest.putSamples(numOutput);
-    src.receiveSamples(numSrcSamples);
-    return numOutput;
+#endif  // USE_MULTICH_ALWAYS
+    assert(numChannels > 0);
+    return transposeMulti(dest, src, srcSamples);
 }
 
 TransposerBase::TransposerBase() {
     numChannels = 0;
     rate = 1.0f;
+    rampTarget = 1.0;
+    rampStep = 0;
+    rampRemaining = 0;
 }
 
 TransposerBase::~TransposerBase() {}
@@ -230,13 +354,29 @@ void TransposerBase::setChannels(int channels) {
 
 void TransposerBase::setRate(double newRate) { rate = newRate; }
 
+// Starts a linear rate ramp from the current rate to 'newRate'
+void TransposerBase::setRateRamp(double newRate, int rampLength) {
+    if (rampLength <= 0) {
+        rampRemaining = 0;
+        setRate(newRate);
+        return;
+    }
+    rampTarget = newRate;
+    rampStep = (newRate - rate) / rampLength;
+    rampRemaining = rampLength;
+}
+
 // static factory function
-TransposerBase *TransposerBase::newInstance() {
+TransposerBase *TransposerBase::newInstance() { return newInstance(algorithm); }
+
+// Creates a transposer for the given interpolation algorithm
+TransposerBase *TransposerBase::newInstance(ALGORITHM a) {
 #ifdef SOUNDTOUCH_INTEGER_SAMPLES
     // Notice: For integer arithmetic support only linear algorithm (due to simplest calculus)
+    (void)a;
     return ::new InterpolateLinearInteger;
 #else
-    switch (algorithm) {
+    switch (a) {
         case LINEAR:
             return new InterpolateLinearFloat;
 
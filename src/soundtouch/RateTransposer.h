@@ -47,6 +47,10 @@
 
 namespace soundtouch {
 
+/// Relative anti-alias filter cut-off frequency change below which the filter isn't
+/// redesigned when the rate changes. 1% corresponds to about 1/6 semitone.
+#define AA_CUTOFF_TOLERANCE 0.01
+
 /// Abstract base class for transposer implementations (linear, advanced vs integer, float etc)
 class TransposerBase {
    public:
@@ -57,8 +61,20 @@ class TransposerBase {
     virtual int transposeStereo(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples) = 0;
     virtual int transposeMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples) = 0;
 
+    /// Number of samples the transpose routines need beyond the last consumed sample
+    virtual int getInputMargin() const = 0;
+
+    /// Calls the transpose routine suitable for the number of channels
+    int transposeBlock(SAMPLETYPE *dest, const SAMPLETYPE *src, int &srcSamples);
+
     static ALGORITHM algorithm;
 
+    /// Rate ramp: target rate, rate change per input sample, and number of input
+    /// samples until reaching the target. No ramp in progress if 'rampRemaining' is 0.
+    double rampTarget;
+    double rampStep;
+    int rampRemaining;
+
    public:
     double rate;
     int numChannels;
@@ -71,18 +87,31 @@ class TransposerBase {
     virtual void setChannels(int channels);
     virtual int getLatency() const = 0;
 
+    /// Changes the rate linearly from the current value to 'newRate' over the next
+    /// 'rampLength' input samples. The rate is updated after every input sample.
+    void setRateRamp(double newRate, int rampLength);
+
+    /// Returns true while a rate ramp is in progress
+    bool isRamping() const { return rampRemaining > 0; }
+
     virtual void resetRegisters() = 0;
 
     // static factory function
     static TransposerBase *newInstance();
 
+    /// Creates a transposer using interpolation algorithm 'a'
+    static TransposerBase *newInstance(ALGORITHM a);
+
     // static function to set interpolation algorithm
     static void setAlgorithm(ALGORITHM a);
+
+    /// Returns the interpolation algorithm used by 'newInstance()'
+    static ALGORITHM getAlgorithm();
 };
 
 /// A common linear samplerate transposer class.
 ///
-class RateTransposer : public FIFOProcessor {
+class RateTransposer final : public FIFOProcessor {
    protected:
     /// Anti-alias filter object
     AAFilter *pAAFilter;
@@ -100,18 +129,31 @@ class RateTransposer : public FIFOProcessor {
 
     bool bUseAAFilter;
 
-    /// Transposes sample rate by applying anti-alias filter to prevent folding.
-    /// Returns amount of samples returned in the "dest" buffer.
-    /// The maximum amount of samples that can be returned at a time is set by
-    /// the 'set_returnBuffer_size' function.
-    void processSamples(const SAMPLETYPE *src, uint numSamples);
+    /// Interpolation algorithm of 'pTransposer'
+    TransposerBase::ALGORITHM algorithm;
+
+    /// Set while the anti-alias filter is designed for a rate ramp that hasn't
+    /// reached its target yet
+    bool bRampFilter;
+
+    /// Returns the anti-alias filter cut-off frequency that 'rate' needs
+    static double getCutoff(double rate);
+
+    /// Updates the anti-alias filter cut-off to 'fCutoff'. If 'quantize' is set, the
+    /// cut-off snaps down to a grid of AA_CUTOFF_TOLERANCE steps so that cached filter
+    /// designs get reused when the rate keeps changing.
+    void updateAAFilter(double fCutoff, bool quantize);
+
+    /// Transposes sample rate of the samples in 'inputBuffer' by applying anti-alias
+    /// filter to prevent folding, and stores the result into 'outputBuffer'.
+    void processSamples();
 
    public:
     RateTransposer();
     virtual ~RateTransposer();
 
     /// Returns the output buffer object
-    FIFOSamplePipe *getOutput() { return &outputBuffer; };
+    FIFOSampleBuffer *getOutput() { return &outputBuffer; };
 
     /// Return anti-alias filter object
     AAFilter *getAAFilter();
@@ -122,10 +164,23 @@ class RateTransposer : public FIFOProcessor {
     /// Returns nonzero if anti-alias filter is enabled.
     bool isAAFilterEnabled() const;
 
+    /// Changes the interpolation algorithm of this instance. Clears the buffered
+    /// samples if the algorithm changes, as the algorithms have different latency.
+    void setAlgorithm(TransposerBase::ALGORITHM a);
+
+    /// Returns the interpolation algorithm of this instance.
+    TransposerBase::ALGORITHM getAlgorithm() const { return algorithm; }
+
     /// Sets new target rate. Normal rate = 1.0, smaller values represent slower
     /// rate, larger faster rates.
     virtual void setRate(double newRate);
 
+    /// Glides the rate to 'newRate' over the next 'rampLength' input samples. During
+    /// the glide the anti-alias filter is designed for the end of the ramp that
+    /// needs the lower cut-off, and for the target rate once the glide is over, in
+    /// steps of AA_CUTOFF_TOLERANCE.
+    void setRateRamp(double newRate, int rampLength);
+
     /// Sets the number of channels, 1 = mono, 2 = stereo
     void setChannels(int channels);
 
@@ -133,6 +188,17 @@ class RateTransposer : public FIFOProcessor {
     /// the input of the object.
     void putSamples(const SAMPLETYPE *samples, uint numSamples);
 
+    /// Adds 'numSamples' pcs of samples from separate per-channel buffers into
+    /// the input of the object.
+    void putSamplesPlanar(const SAMPLETYPE *const *planes, uint numSamples);
+
+    /// Adds 'numSamples' pcs of samples in an external sample format into the input
+    /// of the object, see 'FIFOSampleBuffer::putSamplesFormat'.
+    void putSamplesFormat(const void *samples, const void *const *planes, int format, uint numSamples);
+
+    /// Adds 'numSamples' pcs of silent samples into the input of the object.
+    void addSilent(uint numSamples);
+
     /// Clears all the samples in the object
     void clear();
 
@@ -141,6 +207,21 @@ class RateTransposer : public FIFOProcessor {
 
     /// Return approximate initial input-output latency
     int getLatency() const;
+
+    /// Returns the amount of heap memory used by the sample buffers and the
+    /// anti-alias filter, in bytes.
+    virtual uint getBufferMemoryUsage() const;
+
+    /// Releases sample buffer memory exceeding 'capacityLimit' samples per buffer,
+    /// see 'FIFOSampleBuffer::shrink'.
+    virtual void shrinkBuffers(uint capacityLimit);
+
+    /// Converts the sample buffers into compact storage, see 'FIFOSampleBuffer::park'.
+    void parkBuffers(int format);
+
+   private:
+    // Keeps the per-batch state off the cache line of the next heap object
+    SOUNDTOUCH_CACHE_LINE_PAD;
 };
 
 }  // namespace soundtouch
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Lock-free single-producer/single-consumer ring of sample frames. The producer
+/// and consumer share only the two frame counters: each side reads the other's
+/// counter with acquire ordering and publishes its own with release ordering
+/// after it has finished with the sample data.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "RingBuffer.h"
+
+#include <assert.h>
+#include <string.h>
+
+using namespace soundtouch;
+
+RingBuffer::RingBuffer(uint minFrames, uint numChannels) : writeCount(0), readCount(0) {
+    if (minFrames > RING_MAX_FRAMES) minFrames = RING_MAX_FRAMES;
+    capacity = 1;
+    while (capacity < minFrames) capacity <<= 1;
+    channels = numChannels;
+    buffer = new SAMPLETYPE[capacity * channels];
+}
+
+RingBuffer::~RingBuffer() { delete[] buffer; }
+
+// Returns the number of frames available for reading
+uint RingBuffer::numFrames() const {
+    // load the read counter first: the write counter never falls behind it
+    uint readPos = readCount.load(std::memory_order_acquire);
+
+    return writeCount.load(std::memory_order_acquire) - readPos;
+}
+
+// Returns the number of frames that can be written
+uint RingBuffer::freeFrames() const { return capacity - numFrames(); }
+
+// Copies frames into the ring, in two parts if the write wraps around the end
+uint RingBuffer::write(const SAMPLETYPE *samples, uint nFrames) {
+    uint written = writeCount.load(std::memory_order_relaxed);
+    uint space = capacity - (written - readCount.load(std::memory_order_acquire));
+    uint pos, first;
+
+    if (nFrames > space) nFrames = space;
+    pos = written & (capacity - 1);
+    first = capacity - pos;
+    if (first > nFrames) first = nFrames;
+
+    memcpy(buffer + pos * channels, samples, first * channels * sizeof(SAMPLETYPE));
+    memcpy(buffer, samples + first * channels, (nFrames - first) * channels * sizeof(SAMPLETYPE));
+    writeCount.store(written + nFrames, std::memory_order_release);
+    return nFrames;
+}
+
+// Copies frames out of the ring, in two parts if the read wraps around the end
+uint RingBuffer::read(SAMPLETYPE *output, uint maxFrames) {
+    uint readPos = readCount.load(std::memory_order_relaxed);
+    uint avail = writeCount.load(std::memory_order_acquire) - readPos;
+    uint pos, first;
+
+    if (maxFrames > avail) maxFrames = avail;
+    pos = readPos & (capacity - 1);
+    first = capacity - pos;
+    if (first > maxFrames) first = maxFrames;
+
+    memcpy(output, buffer + pos * channels, first * channels * sizeof(SAMPLETYPE));
+    memcpy(output + first * channels, buffer, (maxFrames - first) * channels * sizeof(SAMPLETYPE));
+    readCount.store(readPos + maxFrames, std::memory_order_release);
+    return maxFrames;
+}
+
+// Returns the oldest frames that are readable contiguously
+uint RingBuffer::peek(const SAMPLETYPE **samples) const {
+    uint readPos = readCount.load(std::memory_order_relaxed);
+    uint avail = writeCount.load(std::memory_order_acquire) - readPos;
+    uint pos = readPos & (capacity - 1);
+
+    *samples = buffer + pos * channels;
+    return (avail < capacity - pos) ? avail : capacity - pos;
+}
+
+// Removes frames from the ring
+void RingBuffer::skip(uint nFrames) {
+    uint readPos = readCount.load(std::memory_order_relaxed);
+
+    assert(nFrames <= writeCount.load(std::memory_order_acquire) - readPos);
+    readCount.store(readPos + nFrames, std::memory_order_release);
+}
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'RingBuffer' : A lock-free single-producer/single-consumer ring of sample
+/// frames. One thread writes samples in and another thread reads them out;
+/// neither ever waits for the other.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RingBuffer_H
+#define RingBuffer_H
+
+#include <atomic>
+
+#include "STTypes.h"
+
+namespace soundtouch {
+
+/// Largest ring size in frames. Larger requests are clamped to it, which keeps
+/// the sample storage of SOUNDTOUCH_MAX_CHANNELS channels within 'uint' bytes.
+#define RING_MAX_FRAMES (1U << 24)
+
+class RingBuffer {
+   private:
+    /// Sample storage for 'capacity' frames
+    SAMPLETYPE *buffer;
+
+    /// Ring size in frames, a power of two
+    uint capacity;
+
+    /// Channels, 1=mono, 2=stereo.
+    uint channels;
+
+    /// Total frames written so far, updated by the producer only. Wraps around;
+    /// 'writeCount - readCount' is the amount of frames in the ring.
+    std::atomic<uint> writeCount;
+
+    // Keeps the producer and consumer counters on separate cache lines
+    char counterPad[SOUNDTOUCH_ALIGNMENT];
+
+    /// Total frames read so far, updated by the consumer only.
+    std::atomic<uint> readCount;
+
+   public:
+    /// Creates a ring for at least 'minFrames' frames of 'numChannels' channels, or
+    /// RING_MAX_FRAMES if more were asked.
+    RingBuffer(uint minFrames, uint numChannels);
+    ~RingBuffer();
+
+    /// Returns the ring size in frames.
+    uint getCapacity() const { return capacity; }
+
+    /// Returns the number of bytes allocated for the sample storage.
+    uint getAllocatedBytes() const { return capacity * channels * (uint)sizeof(SAMPLETYPE); }
+
+    /// Returns the number of frames available for reading. Exact when called by
+    /// the producer or the consumer, a momentary estimate from any other thread.
+    uint numFrames() const;
+
+    /// Returns the number of frames that can be written, see 'numFrames'.
+    uint freeFrames() const;
+
+    /// Producer: copies up to 'numFrames' frames into the ring.
+    ///
+    /// \return Number of frames written, less than 'numFrames' if the ring got full.
+    uint write(const SAMPLETYPE *samples, uint numFrames);
+
+    /// Consumer: copies up to 'maxFrames' frames out of the ring.
+    ///
+    /// \return Number of frames read.
+    uint read(SAMPLETYPE *output, uint maxFrames);
+
+    /// Consumer: returns a pointer to the oldest frames in the ring and the number
+    /// of frames readable there contiguously, without removing them. Call 'skip'
+    /// to remove them after use.
+    uint peek(const SAMPLETYPE **samples) const;
+
+    /// Consumer: removes 'numFrames' frames from the ring without copying them.
+    void skip(uint numFrames);
+
+    /// Producer: returns the total number of frames written so far. Wraps around,
+    /// compare positions by their difference.
+    uint getWritePosition() const { return writeCount.load(std::memory_order_relaxed); }
+
+    /// Consumer: returns the total number of frames read so far, see 'getWritePosition'.
+    uint getReadPosition() const { return readCount.load(std::memory_order_relaxed); }
+};
+
+}  // namespace soundtouch
+#endif
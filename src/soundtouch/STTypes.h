@@ -45,6 +45,31 @@ typedef ulong ulongptr;
 // Helper macro for aligning pointer up to next 16-byte boundary
 #define SOUNDTOUCH_ALIGN_POINTER_16(x) (((ulongptr)(x) + 15) & ~(ulongptr)15)
 
+/// Alignment in bytes of the sample buffers and filter coefficient arrays. The
+/// default of 64 bytes equals one cache line on current x86 and ARM cores, so that
+/// also 32-byte AVX2 and 64-byte AVX-512 loads never split a cache line. Can be
+/// overridden at compile time, must be a power of two and at least 16.
+#ifndef SOUNDTOUCH_ALIGNMENT
+#define SOUNDTOUCH_ALIGNMENT 64
+#endif
+
+#if (SOUNDTOUCH_ALIGNMENT < 16) || (SOUNDTOUCH_ALIGNMENT & (SOUNDTOUCH_ALIGNMENT - 1))
+#error "SOUNDTOUCH_ALIGNMENT must be a power of two and at least 16"
+#endif
+
+// Helper macro for aligning pointer up to next SOUNDTOUCH_ALIGNMENT boundary
+#define SOUNDTOUCH_ALIGN_POINTER(x) \
+    (((ulongptr)(x) + (SOUNDTOUCH_ALIGNMENT - 1)) & ~(ulongptr)(SOUNDTOUCH_ALIGNMENT - 1))
+
+// Helper macro for declaring padding at the end of classes whose instances are run
+// by different threads: keeps the frequently written members of an instance off the
+// cache line of whatever is allocated right after it ("false sharing"). Only the end
+// of the instance is covered. Its first members may still share a line with the end
+// of the object before it, which is harmless if that's another padded instance, as
+// with instances allocated one after another. Aligning the classes instead would need
+// the over-aligned 'new' of C++17, and the SIMD variants are created with '::new'.
+#define SOUNDTOUCH_CACHE_LINE_PAD char cacheLinePad[SOUNDTOUCH_ALIGNMENT]
+
 #if (defined(__GNUC__) && !defined(ANDROID))
 // In GCC, include soundtouch_config.h made by config scritps.
 // Skip this in Android compilation that uses GCC but without configure scripts.
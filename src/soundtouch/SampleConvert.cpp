@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SampleConvert' : Converts samples between the external sample formats and
+/// the internal 'SAMPLETYPE'.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SampleConvert.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "cpu_detect.h"
+
+using namespace soundtouch;
+
+// Clips 'value' to the range 'low'..'high' and rounds it to the nearest integer,
+// ties to even as in the SIMD routines
+static inline int roundClip(float value, float low, float high) {
+    if (value < low) value = low;
+    if (value > high) value = high;
+    return (int)lrintf(value);
+}
+
+void SampleConvert::toSamplesStrided(SAMPLETYPE *dest, uint stride, const void *src, int format, uint numValues) {
+    uint i;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16: {
+            const short *s = (const short *)src;
+            for (i = 0; i < numValues; i++) {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                dest[i * stride] = s[i];
+#else
+                dest[i * stride] = s[i] * (1.0f / 32768.0f);
+#endif
+            }
+            break;
+        }
+
+        case SAMPLE_FORMAT_S24:
+        case SAMPLE_FORMAT_S32: {
+            // move 24bit samples to the top of the word, which also sign-extends them
+            const int *s = (const int *)src;
+            uint shift = (format == SAMPLE_FORMAT_S24) ? 8 : 0;
+            for (i = 0; i < numValues; i++) {
+                int value = (int)((uint)s[i] << shift);
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                dest[i * stride] = (short)(value >> 16);
+#else
+                dest[i * stride] = (float)value * (1.0f / 2147483648.0f);
+#endif
+            }
+            break;
+        }
+
+        case SAMPLE_FORMAT_F32: {
+            const float *s = (const float *)src;
+            for (i = 0; i < numValues; i++) {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                dest[i * stride] = (short)roundClip(s[i] * 32768.0f, -32768.0f, 32767.0f);
+#else
+                dest[i * stride] = s[i];
+#endif
+            }
+            break;
+        }
+    }
+}
+
+void SampleConvert::fromSamplesStrided(void *dest, const SAMPLETYPE *src, uint stride, int format, uint numValues) {
+    uint i;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16: {
+            short *d = (short *)dest;
+            for (i = 0; i < numValues; i++) {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                d[i] = src[i * stride];
+#else
+                d[i] = (short)roundClip(src[i * stride] * 32768.0f, -32768.0f, 32767.0f);
+#endif
+            }
+            break;
+        }
+
+        case SAMPLE_FORMAT_S24: {
+            int *d = (int *)dest;
+            for (i = 0; i < numValues; i++) {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                d[i] = src[i * stride] * 256;
+#else
+                d[i] = roundClip(src[i * stride] * 8388608.0f, -8388608.0f, 8388607.0f);
+#endif
+            }
+            break;
+        }
+
+        case SAMPLE_FORMAT_S32: {
+            // 2147483520 is the largest float below 2^31
+            int *d = (int *)dest;
+            for (i = 0; i < numValues; i++) {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                d[i] = src[i * stride] * 65536;
+#else
+                d[i] = roundClip(src[i * stride] * 2147483648.0f, -2147483648.0f, 2147483520.0f);
+#endif
+            }
+            break;
+        }
+
+        case SAMPLE_FORMAT_F32: {
+            float *d = (float *)dest;
+            for (i = 0; i < numValues; i++) {
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+                d[i] = src[i * stride] * (1.0f / 32768.0f);
+#else
+                d[i] = src[i * stride];
+#endif
+            }
+            break;
+        }
+    }
+}
+
+void SampleConvert::toSamples(SAMPLETYPE *dest, const void *src, int format, uint numValues) {
+    if (format == SAMPLE_FORMAT_NATIVE) {
+        memcpy(dest, src, numValues * sizeof(SAMPLETYPE));
+        return;
+    }
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if (detectCPUextensions() & SUPPORT_SSE2) {
+        uint done = toSamplesSSE2(dest, src, format, numValues);
+
+        dest += done;
+        src = (const char *)src + done * getBytesPerSample(format);
+        numValues -= done;
+    }
+#endif  // SOUNDTOUCH_ALLOW_SSE
+    toSamplesStrided(dest, 1, src, format, numValues);
+}
+
+void SampleConvert::fromSamples(void *dest, const SAMPLETYPE *src, int format, uint numValues) {
+    if (format == SAMPLE_FORMAT_NATIVE) {
+        memcpy(dest, src, numValues * sizeof(SAMPLETYPE));
+        return;
+    }
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if (detectCPUextensions() & SUPPORT_SSE2) {
+        uint done = fromSamplesSSE2(dest, src, format, numValues);
+
+        dest = (char *)dest + done * getBytesPerSample(format);
+        src += done;
+        numValues -= done;
+    }
+#endif  // SOUNDTOUCH_ALLOW_SSE
+    fromSamplesStrided(dest, src, 1, format, numValues);
+}
+
+// Mono is a plain conversion and stereo has a dedicated SIMD routine; other
+// channel counts are converted one channel at a time.
+void SampleConvert::toSamplesPlanar(SAMPLETYPE *dest, const void *const *planes, uint offset, int format,
+                                    uint numSamples, uint numChannels) {
+    uint bytes = getBytesPerSample(format);
+    uint start = 0;
+
+    if (numChannels == 1) {
+        toSamples(dest, (const char *)planes[0] + offset * bytes, format, numSamples);
+        return;
+    }
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if ((numChannels == 2) && (detectCPUextensions() & SUPPORT_SSE2)) {
+        start = toSamplesStereoSSE2(dest, (const char *)planes[0] + offset * bytes,
+                                    (const char *)planes[1] + offset * bytes, format, numSamples);
+    }
+#endif  // SOUNDTOUCH_ALLOW_SSE
+    for (uint c = 0; c < numChannels; c++) {
+        toSamplesStrided(dest + start * numChannels + c, numChannels, (const char *)planes[c] + (offset + start) * bytes,
+                         format, numSamples - start);
+    }
+}
+
+void SampleConvert::fromSamplesPlanar(void *const *planes, uint offset, const SAMPLETYPE *src, int format,
+                                      uint numSamples, uint numChannels) {
+    uint bytes = getBytesPerSample(format);
+    uint start = 0;
+
+    if (numChannels == 1) {
+        fromSamples((char *)planes[0] + offset * bytes, src, format, numSamples);
+        return;
+    }
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    if ((numChannels == 2) && (detectCPUextensions() & SUPPORT_SSE2)) {
+        start = fromSamplesStereoSSE2((char *)planes[0] + offset * bytes, (char *)planes[1] + offset * bytes, src,
+                                      format, numSamples);
+    }
+#endif  // SOUNDTOUCH_ALLOW_SSE
+    for (uint c = 0; c < numChannels; c++) {
+        fromSamplesStrided((char *)planes[c] + (offset + start) * bytes, src + start * numChannels + c, numChannels,
+                           format, numSamples - start);
+    }
+}
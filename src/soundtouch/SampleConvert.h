@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SampleConvert' : Converts samples between the external sample formats that
+/// the library accepts and the internal 'SAMPLETYPE', optionally interleaving
+/// or de-interleaving per-channel buffers on the way.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SampleConvert_H
+#define SampleConvert_H
+
+#include "STTypes.h"
+
+namespace soundtouch {
+
+/// External sample formats. Integer formats are converted to and from the full
+/// scale of 'SAMPLETYPE': +-1.0 for float samples, +-32768 for integer samples.
+enum SampleFormat {
+    SAMPLE_FORMAT_S16 = 0,  ///< 16bit signed integer
+    SAMPLE_FORMAT_S24 = 1,  ///< 24bit signed integer in the low bits of a 32bit word
+    SAMPLE_FORMAT_S32 = 2,  ///< 32bit signed integer
+    SAMPLE_FORMAT_F32 = 3   ///< 32bit float, full scale at +-1.0
+};
+
+/// The external format that matches 'SAMPLETYPE' and is copied as such
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+#define SAMPLE_FORMAT_NATIVE SAMPLE_FORMAT_S16
+#else
+#define SAMPLE_FORMAT_NATIVE SAMPLE_FORMAT_F32
+#endif
+
+class SampleConvert {
+   private:
+#ifdef SOUNDTOUCH_ALLOW_SSE
+    // SSE2 versions of the conversions. Convert as many values as fit full vectors
+    // and return their count, leaving the rest to the plain C++ loops.
+    static uint toSamplesSSE2(float *dest, const void *src, int format, uint numValues);
+    static uint fromSamplesSSE2(void *dest, const float *src, int format, uint numValues);
+    static uint toSamplesStereoSSE2(float *dest, const void *left, const void *right, int format, uint numSamples);
+    static uint fromSamplesStereoSSE2(void *left, void *right, const float *src, int format, uint numSamples);
+#endif  // SOUNDTOUCH_ALLOW_SSE
+
+    /// Converts 'numValues' values from 'src' into every 'stride'th item of 'dest'
+    static void toSamplesStrided(SAMPLETYPE *dest, uint stride, const void *src, int format, uint numValues);
+
+    /// Converts every 'stride'th item of 'src' into 'numValues' values in 'dest',
+    /// clipping them to the range of the format
+    static void fromSamplesStrided(void *dest, const SAMPLETYPE *src, uint stride, int format, uint numValues);
+
+   public:
+    /// Returns true if 'format' is one of the SAMPLE_FORMAT_... values
+    static bool isValid(int format) { return (format >= SAMPLE_FORMAT_S16) && (format <= SAMPLE_FORMAT_F32); }
+
+    /// Returns the size of one sample of 'format' in bytes
+    static uint getBytesPerSample(int format) { return (format == SAMPLE_FORMAT_S16) ? 2 : 4; }
+
+    /// Converts 'numValues' values, i.e. samples times channels, of interleaved
+    /// data in 'format' from 'src' into 'dest'.
+    static void toSamples(SAMPLETYPE *dest, const void *src, int format, uint numValues);
+
+    /// Converts 'numValues' values from 'src' into interleaved data in 'format' in
+    /// 'dest'. Integer formats are clipped to their range.
+    static void fromSamples(void *dest, const SAMPLETYPE *src, int format, uint numValues);
+
+    /// Converts and interleaves 'numSamples' samples in 'format' from per-channel
+    /// buffers 'planes', starting 'offset' samples from their beginning, into 'dest'.
+    static void toSamplesPlanar(SAMPLETYPE *dest, const void *const *planes, uint offset, int format, uint numSamples,
+                                uint numChannels);
+
+    /// Converts and de-interleaves 'numSamples' samples from 'src' into per-channel
+    /// buffers 'planes' in 'format', starting 'offset' samples from their beginning.
+    /// Integer formats are clipped to their range.
+    static void fromSamplesPlanar(void *const *planes, uint offset, const SAMPLETYPE *src, int format, uint numSamples,
+                                  uint numChannels);
+};
+
+}  // namespace soundtouch
+
+#endif  // SampleConvert_H
@@ -70,7 +70,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "FIFOSampleBuffer.h"
 #include "RateTransposer.h"
+#include "SampleConvert.h"
+#include "StageWorker.h"
 #include "TDStretch.h"
 #include "cpu_detect.h"
 
@@ -79,18 +82,51 @@ using namespace soundtouch;
 /// test if two floating point numbers are equal
 #define TEST_FLOAT_EQUAL(a, b) (fabs(a - b) < 1e-10)
 
+// Length of the steps that pitch automation glides in, in milliseconds. The tempo
+// follows the rate from step to step.
+#define AUTOMATION_STEP_MS 10
+
+#ifndef SOUNDTOUCH_INT16_ENGINE
 /// Print library version string for autoconf
 extern "C" void soundtouch_ac_test() { printf("SoundTouch Version: %s\n", SOUNDTOUCH_VERSION); }
+#endif
+
+// Moves the samples that the previous stage has output into 'buffer' on to the
+// input of stage 'next'. Same as 'next->moveSamples(previous)', but with the
+// classes known here every call binds statically instead of going through the
+// pipe interface of both stages.
+static inline void moveStageOutput(TDStretch *next, FIFOSampleBuffer *buffer) {
+    uint num = buffer->numSamples();
+
+    next->putSamples(buffer->ptrBegin(), num);
+    buffer->receiveSamples(num);
+}
+
+static inline void moveStageOutput(RateTransposer *next, FIFOSampleBuffer *buffer) {
+    uint num = buffer->numSamples();
+
+    next->putSamples(buffer->ptrBegin(), num);
+    buffer->receiveSamples(num);
+}
 
 SoundTouch::SoundTouch() {
     // Initialize rate transposer and tempo changer instances
 
     pRateTransposer = new RateTransposer();
     pTDStretch = TDStretch::newInstance();
+    pDecimator = NULL;
+    processingRate = 0;
+    decimation = 1.0;
 
     setOutPipe(pTDStretch);
+    lastStage = pTDStretch;
+    outputBuffer = pTDStretch->getOutput();
+    pStageWorker = NULL;
+    bParallelStages = false;
 
     rate = tempo = 0;
+    inputSampleRate = 0;
+    outputSampleRate = 0;
 
     virtualPitch = 1.0;
     virtualRate = 1.0;
@@ -101,11 +137,19 @@ SoundTouch::SoundTouch() {
     samplesExpectedOut = 0;
     samplesOutput = 0;
 
+    memoryBudget = 0;
+    maxBlockSamples = 0;
+    numAutomationPoints = 0;
+    rampFrames = 0;
+    idleStorage = FIFOSampleBuffer::STORAGE_FLOAT;
+
     channels = 0;
     bSrateSet = false;
 }
 
 SoundTouch::~SoundTouch() {
+    delete pStageWorker;
+    delete pDecimator;
     delete pRateTransposer;
     delete pTDStretch;
 }
@@ -124,9 +168,18 @@ uint SoundTouch::getVersionId() { return SOUNDTOUCH_VERSION_ID; }
 void SoundTouch::setChannels(uint numChannels) {
     if (!verifyNumberOfChannels(numChannels)) return;
 
+    // the worker's rings are sized by channel count, so restart it
+    if (pStageWorker) stopStageWorker();
     channels = numChannels;
     pRateTransposer->setChannels((int)numChannels);
     pTDStretch->setChannels((int)numChannels);
+    if (pDecimator) {
+        // redo the initial buffering for the new channel count
+        pDecimator->setChannels((int)numChannels);
+        pDecimator->clear();
+    }
+    if (bParallelStages) startStageWorker();
+    setMemoryBudget(memoryBudget);
 }
 
 // Sets new rate control value. Normal rate = 1.0, smaller values
@@ -177,6 +230,35 @@ void SoundTouch::setPitchSemiTones(int newPitch) { setPitchOctaves((double)newPi
 
 void SoundTouch::setPitchSemiTones(double newPitch) { setPitchOctaves(newPitch / 12.0); }
 
+// Posts new rate/tempo/pitch values to be applied at the next input block
+void SoundTouch::postRate(double newRate) { mailbox.post(ParameterMailbox::PARAM_RATE, newRate); }
+
+void SoundTouch::postTempo(double newTempo) { mailbox.post(ParameterMailbox::PARAM_TEMPO, newTempo); }
+
+void SoundTouch::postPitch(double newPitch) { mailbox.post(ParameterMailbox::PARAM_PITCH, newPitch); }
+
+void SoundTouch::postPitchSemiTones(double newPitch) {
+    mailbox.post(ParameterMailbox::PARAM_PITCH, exp(0.69314718056 * newPitch / 12.0));
+}
+
+// Applies the latest parameter values posted from other threads, if any
+void SoundTouch::applyPostedParameters() {
+    ParameterMailbox::Snapshot snapshot;
+
+    if (!mailbox.fetch(snapshot)) return;
+
+    if (snapshot.posted & (1u << ParameterMailbox::PARAM_RATE)) {
+        virtualRate = snapshot.values[ParameterMailbox::PARAM_RATE];
+    }
+    if (snapshot.posted & (1u << ParameterMailbox::PARAM_TEMPO)) {
+        virtualTempo = snapshot.values[ParameterMailbox::PARAM_TEMPO];
+    }
+    if (snapshot.posted & (1u << ParameterMailbox::PARAM_PITCH)) {
+        virtualPitch = snapshot.values[ParameterMailbox::PARAM_PITCH];
+    }
+    calcEffectiveRateAndTempo();
+}
+
 // Calculates 'effective' rate and tempo values from the
 // nominal control values.
 void SoundTouch::calcEffectiveRateAndTempo() {
@@ -185,75 +267,289 @@ void SoundTouch::calcEffectiveRateAndTempo() {
 
     tempo = virtualTempo / virtualPitch;
     rate = virtualPitch * virtualRate;
+    if (inputSampleRate) {
+        uint stageRate = pDecimator ? processingRate : inputSampleRate;
+        uint outRate = outputSampleRate ? outputSampleRate : inputSampleRate;
+
+        // convert the sample rate in the same pass as the rate change
+        if (stageRate != outRate) rate *= (double)stageRate / (double)outRate;
+    }
+    if (rampFrames > 0) {
+        // the rate glides linearly over the automation step: match the tempo to the
+        // average rate, so that the glide doesn't change the duration of the output
+        tempo *= 2.0 * rate / (rate + oldRate);
+    }
+
+    if (!TEST_FLOAT_EQUAL(rate, oldRate) || !TEST_FLOAT_EQUAL(tempo, oldTempo)) {
+        // the stages can't be changed while the worker is processing
+        syncStages();
+    }
 
-    if (!TEST_FLOAT_EQUAL(rate, oldRate)) pRateTransposer->setRate(rate);
+    if (!TEST_FLOAT_EQUAL(rate, oldRate)) {
+        if (rampFrames > 0) {
+            // glide the rate over the automation segment. If the rate transposer runs
+            // after time-stretch, its input is 1/tempo times as long, and shorter
+            // still by the decimation to the processing rate
+            int rampLength = ((rate <= 1.0) && !pDecimator) ? (int)rampFrames
+                                                            : (int)(rampFrames / (tempo * decimation) + 0.5);
+            pRateTransposer->setRateRamp(rate, rampLength);
+        } else {
+            pRateTransposer->setRate(rate);
+        }
+    }
     if (!TEST_FLOAT_EQUAL(tempo, oldTempo)) pTDStretch->setTempo(tempo);
 
 #ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
-    if (rate <= 1.0f) {
-        if (output != pTDStretch) {
+    // at a reduced processing rate, time-stretch runs first on the decimated input
+    if ((rate <= 1.0f) && !pDecimator) {
+        if (lastStage != pTDStretch) {
             FIFOSamplePipe *tempoOut;
 
-            assert(output == pRateTransposer);
+            assert(lastStage == pRateTransposer);
             // move samples in the current output buffer to the output of pTDStretch
             tempoOut = pTDStretch->getOutput();
-            tempoOut->moveSamples(*output);
+            tempoOut->moveSamples(*lastStage);
             // move samples in pitch transposer's store buffer to tempo changer's input
             // deprecated : pTDStretch->moveSamples(*pRateTransposer->getStore());
 
-            output = pTDStretch;
+            lastStage = pTDStretch;
         }
     } else
 #endif
     {
-        if (output != pRateTransposer) {
+        if (lastStage != pRateTransposer) {
             FIFOSamplePipe *transOut;
 
-            assert(output == pTDStretch);
+            assert(lastStage == pTDStretch);
             // move samples in the current output buffer to the output of pRateTransposer
             transOut = pRateTransposer->getOutput();
-            transOut->moveSamples(*output);
+            transOut->moveSamples(*lastStage);
             // move samples in tempo changer's input to pitch transposer's input
             pRateTransposer->moveSamples(*pTDStretch->getInput());
 
-            output = pRateTransposer;
+            lastStage = pRateTransposer;
         }
     }
+
+    if (pStageWorker) {
+        pStageWorker->setStage(lastStage);
+    } else {
+        output = lastStage;
+        outputBuffer = getLastStageOutput();
+    }
+    updateStretchSampleRate();
+}
+
+// Sets the sample rate of the time-stretch stage for its place in the pipeline
+void SoundTouch::updateStretchSampleRate() {
+    uint srate = pDecimator ? processingRate : inputSampleRate;
+    int current;
+
+    if (outputSampleRate && (lastStage == pTDStretch)) {
+        // time-stretch processes the output of the rate transposer
+        srate = outputSampleRate;
+    }
+    pTDStretch->getParameters(&current, NULL, NULL, NULL);
+    if ((srate > 0) && ((int)srate != current)) {
+        // leave other tempo changer parameters as they are
+        pTDStretch->setParameters((int)srate);
+    }
 }
 
 // Sets sample rate.
 void SoundTouch::setSampleRate(uint srate) {
-    // set sample rate, leave other tempo changer parameters as they are.
-    pTDStretch->setParameters((int)srate);
+    syncStages();
+    inputSampleRate = srate;
     bSrateSet = true;
+    updateDecimator();
+    calcEffectiveRateAndTempo();
+}
+
+// Creates or removes the decimator according to the processing and input rates
+void SoundTouch::updateDecimator() {
+    if ((processingRate == 0) || (processingRate >= inputSampleRate)) {
+        delete pDecimator;
+        pDecimator = NULL;
+        decimation = 1.0;
+        return;
+    }
+
+    decimation = (double)inputSampleRate / (double)processingRate;
+    if (pDecimator == NULL) {
+        // same anti-alias filter settings as in the rate transposer
+        pDecimator = new RateTransposer();
+        pDecimator->enableAAFilter(pRateTransposer->isAAFilterEnabled());
+        pDecimator->getAAFilter()->setLength(pRateTransposer->getAAFilter()->getLength());
+        pDecimator->setAlgorithm(pRateTransposer->getAlgorithm());
+    }
+    if (channels > 0) pDecimator->setChannels((int)channels);
+    pDecimator->setRate(decimation);
+    // redo the initial buffering for the new rate and channel count
+    pDecimator->clear();
+}
+
+// Sets the output sample rate, converted along with the rate change
+void SoundTouch::setOutputSampleRate(uint srate) {
+    syncStages();
+    outputSampleRate = srate;
+    calcEffectiveRateAndTempo();
 }
 
 // Adds 'numSamples' pcs of samples from the 'samples' memory position into
 // the input of the object.
 void SoundTouch::putSamples(const SAMPLETYPE *samples, uint nSamples) {
+    feedStages(samples, NULL, SAMPLE_FORMAT_NATIVE, nSamples);
+}
+
+// Adds 'numSamples' pcs of samples from the per-channel 'planes' buffers into
+// the input of the object.
+void SoundTouch::putSamplesPlanar(const SAMPLETYPE *const *planes, uint nSamples) {
+    feedStages(NULL, (const void *const *)planes, SAMPLE_FORMAT_NATIVE, nSamples);
+}
+
+// Adds 'numSamples' pcs of samples in external 'format' into the input of the object.
+void SoundTouch::putSamplesFormat(const void *samples, const void *const *planes, int format, uint nSamples) {
+    feedStages(samples, planes, format, nSamples);
+}
+
+// Checks the stream setup and feeds samples into the processing stages, in blocks
+// of 'maxBlockSamples' at most if a memory budget is set.
+void SoundTouch::feedStages(const void *samples, const void *const *planes, int format, uint nSamples) {
     if (bSrateSet == false) {
         ST_THROW_RT_ERROR("SoundTouch : Sample rate not defined");
     } else if (channels == 0) {
         ST_THROW_RT_ERROR("SoundTouch : Number of channels not defined");
     }
+    if (!SampleConvert::isValid(format)) {
+        ST_THROW_RT_ERROR("SoundTouch : Illegal sample format");
+        return;
+    }
+
+    applyPostedParameters();
 
     // accumulate how many samples are expected out from processing, given the current
-    // processing setting
-    samplesExpectedOut += (double)nSamples / ((double)rate * (double)tempo);
+    // processing setting. Notice that pitch doesn't affect the duration, so pitch
+    // automation needn't be accounted for here.
+    samplesExpectedOut += (double)nSamples / ((double)rate * (double)tempo * decimation);
+
+    // glide the pitch over the segments between the automation breakpoints, in short
+    // steps so that the tempo can follow the rate
+    uint step = (inputSampleRate * AUTOMATION_STEP_MS) / 1000;
+    uint pos = 0;
+    bool glided = (numAutomationPoints > 0);
+
+    if (step == 0) step = 1;
+    for (uint i = 0; (i < numAutomationPoints) && (pos < nSamples); i++) {
+        uint end = automation[i].frameOffset;
+        double semiTones = automation[i].semiTones;
+
+        if (end > nSamples) {
+            // breakpoint beyond this block: glide to the intermediate value at block end
+            double current = 12.0 * log(virtualPitch) / log(2.0);
+            semiTones = current + (semiTones - current) * (nSamples - pos) / (end - pos);
+            end = nSamples;
+        }
+        if (end <= pos) {
+            // breakpoints at the same position: jump to the latter
+            setPitchSemiTones(semiTones);
+            continue;
+        }
+        while (pos < end) {
+            double current = 12.0 * log(virtualPitch) / log(2.0);
+            uint stepEnd = (end - pos > step) ? pos + step : end;
+
+            rampFrames = stepEnd - pos;
+            setPitchSemiTones(current + (semiTones - current) * (stepEnd - pos) / (end - pos));
+            rampFrames = 0;
+
+            feedRange(samples, planes, format, pos, stepEnd - pos);
+            pos = stepEnd;
+        }
+    }
+    numAutomationPoints = 0;
+    // settle the tempo of the last step to the end pitch
+    if (glided) calcEffectiveRateAndTempo();
+
+    feedRange(samples, planes, format, pos, nSamples - pos);
+    enforceMemoryBudget();
+}
+
+// Feeds samples starting from 'offset' into the processing stages, in blocks of
+// 'maxBlockSamples' at most if memory budget is set.
+void SoundTouch::feedRange(const void *samples, const void *const *planes, int format, uint offset, uint nSamples) {
+    const void *blockPlanes[SOUNDTOUCH_MAX_CHANNELS];
+    uint bytes = SampleConvert::getBytesPerSample(format);
+
+    while (nSamples > 0) {
+        uint block = nSamples;
+
+        // with memory budget set, feed the samples in smaller blocks so that the
+        // stage buffers needn't grow by the size of the whole input
+        if ((maxBlockSamples > 0) && (block > maxBlockSamples)) block = maxBlockSamples;
+        if (samples) {
+            feedBlock((const char *)samples + offset * channels * bytes, NULL, format, block);
+        } else {
+            for (uint c = 0; c < channels; c++) {
+                blockPlanes[c] = (const char *)planes[c] + offset * bytes;
+            }
+            feedBlock(NULL, blockPlanes, format, block);
+        }
+        offset += block;
+        nSamples -= block;
+    }
+}
 
+// Sets pitch automation breakpoints for the next input block
+bool SoundTouch::setPitchAutomation(const PitchAutomationPoint *points, uint numPoints) {
+    if (numPoints > SOUNDTOUCH_MAX_AUTOMATION_POINTS) return false;
+    for (uint i = 1; i < numPoints; i++) {
+        if (points[i].frameOffset < points[i - 1].frameOffset) return false;
+    }
+    memcpy(automation, points, numPoints * sizeof(PitchAutomationPoint));
+    numAutomationPoints = numPoints;
+    return true;
+}
+
+// Feeds samples into the first processing stage and moves the result into the
+// second stage. The order of the stages depends on the effective 'rate'.
+void SoundTouch::feedBlock(const void *samples, const void *const *planes, int format, uint nSamples) {
 #ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
-    if (rate <= 1.0f) {
+    if ((rate <= 1.0f) && !pDecimator) {
         // transpose the rate down, output the transposed sound to tempo changer buffer
-        assert(output == pTDStretch);
-        pRateTransposer->putSamples(samples, nSamples);
-        pTDStretch->moveSamples(*pRateTransposer);
+        assert(lastStage == pTDStretch);
+        if (samples || planes) {
+            pRateTransposer->putSamplesFormat(samples, planes, format, nSamples);
+        } else {
+            pRateTransposer->addSilent(nSamples);
+        }
+        if (pStageWorker) {
+            pStageWorker->feed(*pRateTransposer);
+        } else {
+            moveStageOutput(pTDStretch, pRateTransposer->getOutput());
+        }
     } else
 #endif
     {
         // evaluate the tempo changer, then transpose the rate up,
-        assert(output == pRateTransposer);
-        pTDStretch->putSamples(samples, nSamples);
-        pRateTransposer->moveSamples(*pTDStretch);
+        assert(lastStage == pRateTransposer);
+        if (pDecimator) {
+            // decimate to the processing rate first
+            if (samples || planes) {
+                pDecimator->putSamplesFormat(samples, planes, format, nSamples);
+            } else {
+                pDecimator->addSilent(nSamples);
+            }
+            moveStageOutput(pTDStretch, pDecimator->getOutput());
+        } else if (samples || planes) {
+            pTDStretch->putSamplesFormat(samples, planes, format, nSamples);
+        } else {
+            pTDStretch->addSilent(nSamples);
+        }
+        if (pStageWorker) {
+            pStageWorker->feed(*pTDStretch);
+        } else {
+            moveStageOutput(pRateTransposer, pTDStretch->getOutput());
+        }
     }
 }
 
@@ -267,29 +563,74 @@ void SoundTouch::putSamples(const SAMPLETYPE *samples, uint nSamples) {
 void SoundTouch::flush() {
     int i;
     int numStillExpected;
-    SAMPLETYPE *buff = new SAMPLETYPE[128 * channels];
+    uint padding;
 
     // how many samples are still expected to output
     numStillExpected = (int)((long)(samplesExpectedOut + 0.5) - samplesOutput);
     if (numStillExpected < 0) numStillExpected = 0;
 
-    memset(buff, 0, 128 * channels * sizeof(SAMPLETYPE));
-    // "Push" the last active samples out from the processing pipeline by
-    // feeding blank samples into the processing pipeline until new,
-    // processed samples appear in the output (not however, more than
-    // 24ksamples in any case)
-    for (i = 0; (numStillExpected > (int)numSamples()) && (i < 200); i++) {
-        putSamples(buff, 128);
+    // "Push" the last active samples out from the processing pipeline by feeding
+    // as much silence as the stages hold back. Because of rounding in the stages,
+    // that may fall a few samples short, in which case top up with the missing
+    // amount plus one processing batch, a few times at most.
+    syncStages();
+    padding = getFlushPadding();
+    for (i = 0; (numStillExpected > (int)numSamples()) && (i < 4); i++) {
+        feedSilence(padding);
+        syncStages();
+        padding = (uint)((numStillExpected - (int)numSamples()) * rate * tempo * decimation) +
+                  (uint)getSetting(SETTING_NOMINAL_INPUT_SEQUENCE);
     }
 
     adjustAmountOfSamples(numStillExpected);
 
-    delete[] buff;
-
     // Clear input buffers
     pTDStretch->clearInput();
     // yet leave the output intouched as that's where the
     // flushed samples are!
+
+    enforceMemoryBudget();
+}
+
+// Feeds silence through the stages without accounting it to expected output
+void SoundTouch::feedSilence(uint nSamples) {
+    while (nSamples > 0) {
+        uint block = nSamples;
+
+        if ((maxBlockSamples > 0) && (block > maxBlockSamples)) block = maxBlockSamples;
+        feedBlock(NULL, NULL, SAMPLE_FORMAT_NATIVE, block);
+        nSamples -= block;
+    }
+}
+
+// Calculates how many input samples are needed for pushing the samples held back
+// in the stages to the output: the rate transposer holds back its interpolation
+// latency plus the anti-alias filter length, and the time-stretch a full processing
+// window. The second stage's share gets scaled by the first stage's ratio.
+uint SoundTouch::getFlushPadding() const {
+    double transposerHold, stretchHold;
+
+    transposerHold = pRateTransposer->getLatency();
+    if (pRateTransposer->isAAFilterEnabled()) transposerHold += pRateTransposer->getAAFilter()->getLength();
+    stretchHold = pTDStretch->getLatency();
+
+    if (pDecimator) {
+        // the decimator holds back like the rate transposer, and the stages after
+        // it consume 'decimation' times the input samples
+        double decimatorHold = pDecimator->getLatency();
+
+        if (pDecimator->isAAFilterEnabled()) decimatorHold += pDecimator->getAAFilter()->getLength();
+        return (uint)(decimatorHold + (stretchHold + transposerHold * tempo) * decimation + 1.0);
+    }
+
+#ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
+    if (rate <= 1.0) {
+        // rate transposer first, time-stretch consumes 'rate' times the input samples
+        return (uint)(transposerHold + stretchHold * rate + 1.0);
+    }
+#endif
+    // time-stretch first, rate transposer consumes 'tempo' times the input samples
+    return (uint)(stretchHold + transposerHold * tempo + 1.0);
 }
 
 // Changes a setting controlling the processing system behaviour. See the
@@ -297,6 +638,8 @@ void SoundTouch::flush() {
 bool SoundTouch::setSetting(int settingId, int value) {
     int sampleRate, sequenceMs, seekWindowMs, overlapMs;
 
+    syncStages();
+
     // read current tdstretch routine parameters
     pTDStretch->getParameters(&sampleRate, &sequenceMs, &seekWindowMs, &overlapMs);
 
@@ -304,11 +647,20 @@ bool SoundTouch::setSetting(int settingId, int value) {
         case SETTING_USE_AA_FILTER:
             // enables / disabless anti-alias filter
             pRateTransposer->enableAAFilter((value != 0) ? true : false);
+            if (pDecimator) pDecimator->enableAAFilter((value != 0) ? true : false);
             return true;
 
         case SETTING_AA_FILTER_LENGTH:
             // sets anti-alias filter length
             pRateTransposer->getAAFilter()->setLength(value);
+            if (pDecimator) pDecimator->getAAFilter()->setLength(value);
+            return true;
+
+        case SETTING_INTERPOLATION:
+            // changes the rate transposer interpolation algorithm
+            if ((value < TransposerBase::LINEAR) || (value > TransposerBase::SHANNON)) return false;
+            pRateTransposer->setAlgorithm((TransposerBase::ALGORITHM)value);
+            if (pDecimator) pDecimator->setAlgorithm((TransposerBase::ALGORITHM)value);
             return true;
 
         case SETTING_USE_QUICKSEEK:
@@ -331,6 +683,39 @@ bool SoundTouch::setSetting(int settingId, int value) {
             pTDStretch->setParameters(sampleRate, sequenceMs, seekWindowMs, value);
             return true;
 
+        case SETTING_IDLE_STORAGE:
+            // choose storage format for compacting idle buffers
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+            if ((value < FIFOSampleBuffer::STORAGE_FLOAT) || (value > FIFOSampleBuffer::STORAGE_BF16)) return false;
+            idleStorage = value;
+            return true;
+#else
+            return false;
+#endif
+
+        case SETTING_PARALLEL_STAGES:
+            // run the second stage on a worker thread
+            bParallelStages = (value != 0) ? true : false;
+            if (bParallelStages && !pStageWorker && (channels > 0)) {
+                startStageWorker();
+            } else if (!bParallelStages && pStageWorker) {
+                stopStageWorker();
+            }
+            return true;
+
+        case SETTING_SEPARATE_CHANNELS:
+            // process the channels as separate mono streams
+            pTDStretch->enableSeparateChannels((value != 0) ? true : false);
+            return true;
+
+        case SETTING_PROCESSING_RATE:
+            // decimate to a lower rate for time-stretch
+            if (value < 0) return false;
+            processingRate = (uint)value;
+            updateDecimator();
+            calcEffectiveRateAndTempo();
+            return true;
+
         default:
             return false;
     }
@@ -350,6 +735,9 @@ int SoundTouch::getSetting(int settingId) const {
         case SETTING_AA_FILTER_LENGTH:
             return pRateTransposer->getAAFilter()->getLength();
 
+        case SETTING_INTERPOLATION:
+            return (int)pRateTransposer->getAlgorithm();
+
         case SETTING_USE_QUICKSEEK:
             return (uint)pTDStretch->isQuickSeekEnabled();
 
@@ -365,9 +753,33 @@ int SoundTouch::getSetting(int settingId) const {
             pTDStretch->getParameters(NULL, NULL, NULL, &temp);
             return temp;
 
+        case SETTING_IDLE_STORAGE:
+            return idleStorage;
+
+        case SETTING_PARALLEL_STAGES:
+            return (uint)bParallelStages;
+
+        case SETTING_SEPARATE_CHANNELS:
+            return (uint)pTDStretch->isSeparateChannelsEnabled();
+
+        case SETTING_PROCESSING_RATE:
+            return (int)processingRate;
+
+        case SETTING_PROCESSING_BANDWIDTH: {
+            uint outRate = outputSampleRate ? outputSampleRate : inputSampleRate;
+
+            // transposing the rate down cuts the bandwidth of the stage input
+            return (int)(0.5 * outRate * ((rate < 1.0) ? rate : 1.0) + 0.5);
+        }
+
         case SETTING_NOMINAL_INPUT_SEQUENCE: {
             int size = pTDStretch->getInputSampleReq();
 
+            if (pDecimator) {
+                // decimation done before timestretch
+                return (int)(size * decimation + 0.5);
+            }
+
 #ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
             if (rate <= 1.0) {
                 // transposing done before timestretch, which impacts latency
@@ -380,7 +792,7 @@ int SoundTouch::getSetting(int settingId) const {
         case SETTING_NOMINAL_OUTPUT_SEQUENCE: {
             int size = pTDStretch->getOutputBatchSize();
 
-            if (rate > 1.0) {
+            if ((rate > 1.0) || pDecimator) {
                 // transposing done after timestretch, which impacts latency
                 return (int)(size / rate + 0.5);
             }
@@ -391,6 +803,12 @@ int SoundTouch::getSetting(int settingId) const {
             double latency = pTDStretch->getLatency();
             int latency_tr = pRateTransposer->getLatency();
 
+            if (pDecimator) {
+                // decimation done before timestretch, transposing after it
+                latency += pDecimator->getLatency() / decimation;
+                return (int)((latency + latency_tr) / rate + 0.5);
+            }
+
 #ifndef SOUNDTOUCH_PREVENT_CLICK_AT_RATE_CROSSOVER
             if (rate <= 1.0) {
                 // transposing done before timestretch, which impacts latency
@@ -414,13 +832,33 @@ int SoundTouch::getSetting(int settingId) const {
 void SoundTouch::clear() {
     samplesExpectedOut = 0;
     samplesOutput = 0;
+    syncStages();
+    if (pDecimator) pDecimator->clear();
     pRateTransposer->clear();
     pTDStretch->clear();
+    if (pStageWorker) pStageWorker->getOutput()->clear();
+    enforceMemoryBudget();
+}
+
+// Restores rate, tempo and pitch, and drops pending parameter changes
+void SoundTouch::resetParameters() {
+    ParameterMailbox::Snapshot snapshot;
+
+    mailbox.fetch(snapshot);
+    numAutomationPoints = 0;
+    rampFrames = 0;
+
+    virtualRate = 1.0;
+    virtualTempo = 1.0;
+    virtualPitch = 1.0;
+    calcEffectiveRateAndTempo();
 }
 
 /// Returns number of samples currently unprocessed.
 uint SoundTouch::numUnprocessedSamples() const {
     FIFOSamplePipe *psp;
+
+    syncStages();
     if (pTDStretch) {
         psp = pTDStretch->getInput();
         if (psp) {
@@ -436,23 +874,186 @@ uint SoundTouch::numUnprocessedSamples() const {
 ///
 /// \return Number of samples returned.
 uint SoundTouch::receiveSamples(SAMPLETYPE *output, uint maxSamples) {
-    uint ret = FIFOProcessor::receiveSamples(output, maxSamples);
+    if (pStageWorker) pStageWorker->collect();
+    uint ret = outputBuffer->receiveSamples(output, maxSamples);
     samplesOutput += (long)ret;
+    if (outputBuffer->isEmpty()) enforceMemoryBudget();
     return ret;
 }
 
+/// Output samples into per-channel buffers, see 'receiveSamples'.
+///
+/// \return Number of samples returned.
+uint SoundTouch::receiveSamplesPlanar(SAMPLETYPE *const *planes, uint maxSamples) {
+    uint num = numSamples();
+
+    if (num > maxSamples) num = maxSamples;
+    FIFOSampleBuffer::deinterleave(planes, 0, outputBuffer->ptrBegin(), num, channels);
+    return receiveSamples(num);
+}
+
+/// Output samples in external 'format', see 'receiveSamples'.
+///
+/// \return Number of samples returned.
+uint SoundTouch::receiveSamplesFormat(void *samples, void *const *planes, int format, uint maxSamples) {
+    uint num = numSamples();
+
+    if (!SampleConvert::isValid(format)) {
+        ST_THROW_RT_ERROR("SoundTouch : Illegal sample format");
+        return 0;
+    }
+    if (num > maxSamples) num = maxSamples;
+    if (samples) {
+        SampleConvert::fromSamples(samples, outputBuffer->ptrBegin(), format, num * channels);
+    } else {
+        SampleConvert::fromSamplesPlanar(planes, 0, outputBuffer->ptrBegin(), format, num, channels);
+    }
+    return receiveSamples(num);
+}
+
 /// Adjusts book-keeping so that given number of samples are removed from beginning of the
 /// sample buffer without copying them anywhere.
 ///
 /// Used to reduce the number of samples in the buffer when accessing the sample buffer directly
 /// with 'ptrBegin' function.
 uint SoundTouch::receiveSamples(uint maxSamples) {
-    uint ret = FIFOProcessor::receiveSamples(maxSamples);
+    if (pStageWorker) pStageWorker->collect();
+    uint ret = outputBuffer->receiveSamples(maxSamples);
     samplesOutput += (long)ret;
+    if (outputBuffer->isEmpty()) enforceMemoryBudget();
     return ret;
 }
 
+// Feeds samples and receives the processed samples in one call
+uint SoundTouch::process(const SAMPLETYPE *input, uint nSamples, SAMPLETYPE *output, uint maxSamples) {
+    if (nSamples > 0) putSamples(input, nSamples);
+    return receiveSamples(output, maxSamples);
+}
+
+// Returns the most samples that can be output after feeding 'nSamples' samples.
+// The stages output whole batches once they have enough input, so besides the
+// samples corresponding to the new input, a large enough block also releases the
+// input held back from earlier calls, which is at most the pipeline latency plus
+// one input batch. One more output batch covers the rounding of batch lengths.
+uint SoundTouch::getMaxOutput(uint nSamples) const {
+    double ratio = 1.0 / (tempo * rate * decimation);
+    uint held = (uint)getSetting(SETTING_INITIAL_LATENCY) + (uint)getSetting(SETTING_NOMINAL_INPUT_SEQUENCE);
+
+    return (uint)((nSamples + held) * ratio + 1.0) + (uint)getSetting(SETTING_NOMINAL_OUTPUT_SEQUENCE);
+}
+
 /// Get ratio between input and output audio durations, useful for calculating
 /// processed output duration: if you'll process a stream of N samples, then
 /// you can expect to get out N * getInputOutputSampleRatio() samples.
-double SoundTouch::getInputOutputSampleRatio() { return 1.0 / (tempo * rate); }
+double SoundTouch::getInputOutputSampleRatio() { return 1.0 / (tempo * rate * decimation); }
+
+// Sets memory budget for this instance. The sample budget is divided between the
+// four buffers that may hold a full block of samples at a time: the input buffer
+// of the first stage, the input and output buffer of the second stage, and the
+// intermediate buffer of the rate transposer.
+void SoundTouch::setMemoryBudget(uint bytes) {
+    memoryBudget = bytes;
+    if ((bytes == 0) || (channels == 0)) {
+        maxBlockSamples = 0;
+        if (pStageWorker) pStageWorker->setBatchLimit(0);
+        return;
+    }
+    maxBlockSamples = bytes / (4 * channels * sizeof(SAMPLETYPE));
+    if (maxBlockSamples < 256) maxBlockSamples = 256;
+    if (pStageWorker) pStageWorker->setBatchLimit(maxBlockSamples);
+    enforceMemoryBudget();
+}
+
+// Shrinks the stage buffers down towards the block size if the memory budget is exceeded
+void SoundTouch::enforceMemoryBudget() {
+    if ((memoryBudget == 0) || (maxBlockSamples == 0)) return;
+    if (measureMemoryUsage().total <= memoryBudget) return;
+
+    if (pDecimator) pDecimator->shrinkBuffers(maxBlockSamples);
+    if (pStageWorker) pStageWorker->shrinkStage(maxBlockSamples);
+    if (!pStageWorker || (lastStage != pRateTransposer)) pRateTransposer->shrinkBuffers(maxBlockSamples);
+    if (!pStageWorker || (lastStage != pTDStretch)) pTDStretch->shrinkBuffers(maxBlockSamples);
+}
+
+// Returns the amount of heap memory currently used by this instance
+MemoryUsage SoundTouch::getMemoryUsage() const {
+    syncStages();
+    return measureMemoryUsage();
+}
+
+// Adds up the memory usage of the stages; the worker reports its own stage
+MemoryUsage SoundTouch::measureMemoryUsage() const {
+    MemoryUsage usage;
+    bool workerTransposes = pStageWorker && (lastStage == pRateTransposer);
+    bool workerStretches = pStageWorker && (lastStage == pTDStretch);
+
+    usage.rateTransposer =
+        workerTransposes ? pStageWorker->getStageMemoryUsage() : pRateTransposer->getBufferMemoryUsage();
+    usage.tdStretch = workerStretches ? pStageWorker->getStageMemoryUsage() : pTDStretch->getBufferMemoryUsage();
+    usage.instance = (uint)(sizeof(*this) + sizeof(*pRateTransposer) + sizeof(*pTDStretch));
+    if (pDecimator) {
+        usage.rateTransposer += pDecimator->getBufferMemoryUsage();
+        usage.instance += (uint)sizeof(*pDecimator);
+    }
+    if (pStageWorker) usage.instance += (uint)sizeof(*pStageWorker) + pStageWorker->getAllocatedBytes();
+    usage.total = usage.rateTransposer + usage.tdStretch + usage.instance;
+    return usage;
+}
+
+// Parks the stage buffers into compact storage until they're accessed next time
+bool SoundTouch::compactIdle() {
+    if (idleStorage == FIFOSampleBuffer::STORAGE_FLOAT) return false;
+
+    syncStages();
+
+    if (pDecimator) pDecimator->parkBuffers(idleStorage);
+    pRateTransposer->parkBuffers(idleStorage);
+    pTDStretch->parkBuffers(idleStorage);
+    return true;
+}
+
+/// Returns number of samples currently available for receiving. With the stage
+/// worker running, collects the samples it has processed so far first.
+uint SoundTouch::numSamples() const {
+    if (pStageWorker) pStageWorker->collect();
+    return outputBuffer->numSamples();
+}
+
+/// Returns nonzero if there aren't any samples available for receiving.
+int SoundTouch::isEmpty() const {
+    if (pStageWorker) pStageWorker->collect();
+    return FIFOProcessor::isEmpty();
+}
+
+// Starts running the last stage on a worker thread. The samples that the last stage
+// has output so far go first to the worker's output buffer.
+void SoundTouch::startStageWorker() {
+    pStageWorker = new StageWorker(lastStage, channels);
+    pStageWorker->setBatchLimit(maxBlockSamples);
+    pStageWorker->getOutput()->moveSamples(*lastStage);
+    output = pStageWorker->getOutput();
+    outputBuffer = pStageWorker->getOutput();
+}
+
+// Stops the worker thread and returns the samples it has processed to the output
+// buffer of the last stage
+void SoundTouch::stopStageWorker() {
+    FIFOSampleBuffer *lastOut;
+
+    pStageWorker->sync();
+    lastOut = getLastStageOutput();
+    lastOut->moveSamples(*pStageWorker->getOutput());
+    delete pStageWorker;
+    pStageWorker = NULL;
+    output = lastStage;
+    outputBuffer = lastOut;
+}
+
+FIFOSampleBuffer *SoundTouch::getLastStageOutput() const {
+    return (lastStage == pTDStretch) ? pTDStretch->getOutput() : pRateTransposer->getOutput();
+}
+
+// Waits for the stage worker to finish the samples handed to it
+void SoundTouch::syncStages() const {
+    if (pStageWorker) pStageWorker->sync();
+}
@@ -66,6 +66,7 @@
 #define SoundTouch_H
 
 #include "FIFOSamplePipe.h"
+#include "ParameterMailbox.h"
 #include "STTypes.h"
 
 namespace soundtouch {
@@ -160,6 +161,83 @@ namespace soundtouch {
 ///   tempo/pitch/rate/samplerate settings.
 #define SETTING_INITIAL_LATENCY 8
 
+/// Storage format that 'compactIdle' converts the buffered samples into, see
+/// FIFOSampleBuffer::StorageFormat: 0 = disabled (default), 1 = 16-bit integer,
+/// 2 = bfloat16. Available with floating point samples only. The 16-bit integer
+/// format clips samples beyond +-1.0; bfloat16 keeps the full float range.
+#define SETTING_IDLE_STORAGE 9
+
+/// Enable/disable running the second processing stage on its own thread (0 = disable,
+/// default). Lets a single stream use two cores, at the cost of a busy worker thread
+/// and of 'numSamples' lagging behind until the worker catches up. The output is
+/// identical to single-threaded processing. Intended for offline processing with
+/// steady settings: changing rate, tempo or settings waits for the worker to finish.
+#define SETTING_PARALLEL_STAGES 10
+
+/// Enable/disable processing the channels as a batch of separate mono streams
+/// (0 = disable, default). All streams share the same settings and are processed
+/// side by side, channel 'n' being stream 'n', but each stream seeks its own
+/// time-stretch overlap positions as if processed by an instance of its own.
+/// Batching 4, 8 or 16 streams lets the processing routines handle several streams
+/// per SIMD instruction. Use 'putSamplesPlanar' and 'receiveSamplesPlanar' to pass
+/// one buffer per stream.
+#define SETTING_SEPARATE_CHANNELS 11
+
+/// Internal processing sample rate in Hz for band-limited content such as speech
+/// (0 = process at the input sample rate, default). The input is decimated to this
+/// rate before time-stretch, and the rate transposer interpolates the result back
+/// to the output sample rate. Time-stretch work drops in proportion to the square
+/// of the rate, but the output loses the content above half the processing rate,
+/// see SETTING_PROCESSING_BANDWIDTH. Has no effect unless below the input sample
+/// rate. Set before processing.
+#define SETTING_PROCESSING_RATE 12
+
+/// Call "getSetting" with this ID to query the audio bandwidth of the output in Hz:
+/// half the output sample rate, or less if the content gets band-limited by the
+/// rate transposer or by SETTING_PROCESSING_RATE.
+///
+/// Notices:
+/// - This is read-only parameter, i.e. setSetting ignores this parameter
+/// - This parameter value is not constant but change depending on
+///   pitch/rate/samplerate settings.
+#define SETTING_PROCESSING_BANDWIDTH 13
+
+/// Interpolation algorithm of the rate transposer: 0 = linear, 1 = cubic (default),
+/// 2 = shannon, see TransposerBase::ALGORITHM. Linear is the fastest and shannon
+/// much the slowest. Changing the algorithm clears the rate transposer, so set it
+/// before processing. Integer sample builds always interpolate linearly.
+#define SETTING_INTERPOLATION 14
+
+/// Maximum number of breakpoints accepted by 'SoundTouch::setPitchAutomation'
+#define SOUNDTOUCH_MAX_AUTOMATION_POINTS 32
+
+/// Pitch automation breakpoint, see 'SoundTouch::setPitchAutomation'.
+struct PitchAutomationPoint {
+    /// Position in the next input block, in sample frames
+    uint frameOffset;
+
+    /// Pitch change in semi-tones reached at 'frameOffset'
+    float semiTones;
+};
+
+/// Heap memory used by a SoundTouch instance, broken down by processing stage.
+/// All values are in bytes.
+struct MemoryUsage {
+    /// Sample buffers and anti-alias filter of the rate transposer stage, and of the
+    /// decimator if SETTING_PROCESSING_RATE is in use
+    uint rateTransposer;
+
+    /// Sample buffers and overlap buffer of the time-stretch stage
+    uint tdStretch;
+
+    /// The SoundTouch object and its stage objects themselves, and the stage worker
+    /// buffers if SETTING_PARALLEL_STAGES is enabled
+    uint instance;
+
+    /// Sum of the above
+    uint total;
+};
+
 class SoundTouch : public FIFOProcessor {
    private:
     /// Rate transposer class instance
@@ -168,6 +246,43 @@ class SoundTouch : public FIFOProcessor {
     /// Time-stretch class instance
     class TDStretch *pTDStretch;
 
+    /// Rate transposer decimating the input to SETTING_PROCESSING_RATE ahead of the
+    /// other stages, or NULL if processing at the input sample rate.
+    class RateTransposer *pDecimator;
+
+    /// SETTING_PROCESSING_RATE value, and the ratio of the input sample rate to it
+    /// while 'pDecimator' is in use (otherwise 1.0)
+    uint processingRate;
+    double decimation;
+
+    /// Worker thread running the second stage when SETTING_PARALLEL_STAGES is
+    /// enabled, otherwise NULL.
+    class StageWorker *pStageWorker;
+
+    /// The stage that processes last, either 'pRateTransposer' or 'pTDStretch'. Same
+    /// as 'output' unless the stage worker runs, in which case 'output' is the buffer
+    /// that the worker returns the processed samples to.
+    FIFOSamplePipe *lastStage;
+
+    /// The buffer that 'output' ends in: the output buffer of 'lastStage', or the
+    /// buffer of the stage worker while it runs. Receiving reads it directly rather
+    /// than through the pipe interface of 'output' and the stage.
+    class FIFOSampleBuffer *outputBuffer;
+
+    /// Returns the output buffer of 'lastStage'
+    class FIFOSampleBuffer *getLastStageOutput() const;
+
+    /// Flag: Has SETTING_PARALLEL_STAGES been enabled?
+    bool bParallelStages;
+
+    /// Starts and stops the stage worker thread
+    void startStageWorker();
+    void stopStageWorker();
+
+    /// Waits until the stage worker, if running, has processed all samples handed to
+    /// it. Afterwards the stages can be accessed until the next feed.
+    void syncStages() const;
+
     /// Virtual pitch parameter. Effective rate & tempo are calculated from these parameters.
     double virtualRate;
 
@@ -180,6 +295,11 @@ class SoundTouch : public FIFOProcessor {
     /// Flag: Has sample rate been set?
     bool bSrateSet;
 
+    /// Sample rates of the input and of the output. 'outputSampleRate' is zero if
+    /// the output has the same rate as the input.
+    uint inputSampleRate;
+    uint outputSampleRate;
+
     /// Accumulator for how many samples in total will be expected as output vs. samples put in,
     /// considering current processing settings.
     double samplesExpectedOut;
@@ -187,10 +307,71 @@ class SoundTouch : public FIFOProcessor {
     /// Accumulator for how many samples in total have been read out from the processing so far
     long samplesOutput;
 
+    /// Memory budget in bytes, zero if unlimited
+    uint memoryBudget;
+
+    /// Largest block of samples fed into the stages at a time when memory budget is set,
+    /// zero if unlimited. Larger putSamples calls are processed in blocks of this size.
+    uint maxBlockSamples;
+
+    /// Shrinks the stage buffers if the memory budget is exceeded. Doesn't wait for
+    /// the stage worker, which shrinks the buffers of its stage itself.
+    void enforceMemoryBudget();
+
+    /// Adds up the memory usage without waiting for the stage worker, counting the
+    /// stage it runs as of the last batch if it's busy.
+    MemoryUsage measureMemoryUsage() const;
+
+    /// Storage format for 'compactIdle', see SETTING_IDLE_STORAGE
+    int idleStorage;
+
+    /// Pitch automation breakpoints for the next input block
+    PitchAutomationPoint automation[SOUNDTOUCH_MAX_AUTOMATION_POINTS];
+    uint numAutomationPoints;
+
+    /// Length of the automation segment being applied, in input samples. When
+    /// nonzero, 'calcEffectiveRateAndTempo' glides the rate instead of changing it
+    /// at once.
+    uint rampFrames;
+
+    /// Parameters posted from other threads, applied at the next input block
+    ParameterMailbox mailbox;
+
+    /// Applies the parameters posted into 'mailbox' since the previous call
+    void applyPostedParameters();
+
+    /// Feeds 'numSamples' samples starting from sample 'offset' into the stages.
+    void feedRange(const void *samples, const void *const *planes, int format, uint offset, uint numSamples);
+
     /// Calculates effective rate & tempo valuescfrom 'virtualRate', 'virtualTempo' and
     /// 'virtualPitch' parameters.
     void calcEffectiveRateAndTempo();
 
+    /// Sets the sample rate of the time-stretch stage: the output sample rate if it
+    /// runs after the rate transposer, otherwise the input sample rate.
+    void updateStretchSampleRate();
+
+    /// Creates or removes 'pDecimator' according to SETTING_PROCESSING_RATE and the
+    /// input sample rate.
+    void updateDecimator();
+
+    /// Feeds 'numSamples' samples in sample 'format' into the processing stages, taking
+    /// them either from the interleaved 'samples' buffer or, if that is NULL, from
+    /// per-channel 'planes'.
+    void feedStages(const void *samples, const void *const *planes, int format, uint numSamples);
+
+    /// Runs one block of samples through the processing stages, see 'feedStages'.
+    /// Feeds silence if both 'samples' and 'planes' are NULL.
+    void feedBlock(const void *samples, const void *const *planes, int format, uint numSamples);
+
+    /// Feeds 'numSamples' silent samples through the stages, in blocks limited by
+    /// the memory budget. Doesn't count to the expected output amount.
+    void feedSilence(uint numSamples);
+
+    /// Returns the amount of input samples that pushes all samples held back by the
+    /// processing stages through to the output.
+    uint getFlushPadding() const;
+
    protected:
     /// Number of channels
     uint channels;
@@ -240,12 +421,46 @@ class SoundTouch : public FIFOProcessor {
     void setPitchSemiTones(int newPitch);
     void setPitchSemiTones(double newPitch);
 
+    /// Sets pitch automation for the next putSamples call. The pitch glides linearly
+    /// in semi-tones from its current value to each breakpoint in turn, reaching it
+    /// 'frameOffset' samples into the block, and then stays at the last value.
+    /// Breakpoints beyond the end of the block get cut to the block end.
+    ///
+    /// The resampling ratio is updated for every input sample. The anti-alias filter
+    /// is updated only when its cut-off moves more than AA_CUTOFF_TOLERANCE, using
+    /// cached filter designs, so automation is cheap compared to calling
+    /// 'setPitchSemiTones' for every block.
+    ///
+    /// \return 'false' if there are too many breakpoints or they're not in order.
+    bool setPitchAutomation(const PitchAutomationPoint *points,  ///< Breakpoints in increasing offset order.
+                            uint numPoints                       ///< Number of breakpoints.
+    );
+
+    /// Thread-safe variants of 'setRate', 'setTempo', 'setPitch' and 'setPitchSemiTones'.
+    /// These can be called from any thread while another thread is processing: the new
+    /// value gets posted without blocking, and the processing thread applies the latest
+    /// posted values together at the beginning of the next putSamples call.
+    ///
+    /// Once posted, a parameter gets re-applied with its latest posted value whenever
+    /// any parameter is posted, so don't mix these with the direct setters for the
+    /// same parameter.
+    void postRate(double newRate);
+    void postTempo(double newTempo);
+    void postPitch(double newPitch);
+    void postPitchSemiTones(double newPitch);
+
     /// Sets the number of channels, 1 = mono, 2 = stereo
     void setChannels(uint numChannels);
 
     /// Sets sample rate.
     void setSampleRate(uint srate);
 
+    /// Sets the sample rate of the output, if different from the input sample rate.
+    /// The sample rate is converted by the rate transposer along with the rate and
+    /// pitch changes, with the anti-alias filter placed for the combined ratio.
+    /// Zero makes the output sample rate follow the input sample rate again.
+    void setOutputSampleRate(uint srate);
+
     /// Get ratio between input and output audio durations, useful for calculating
     /// processed output duration: if you'll process a stream of N samples, then
     /// you can expect to get out N * getInputOutputSampleRatio() samples.
@@ -282,6 +497,26 @@ class SoundTouch : public FIFOProcessor {
                                                         ///< contains data for both channels.
     );
 
+    /// Adds 'numSamples' pcs of samples from separate per-channel (planar) buffers
+    /// into the input of the object. 'planes' must contain 'numChannels()' pointers.
+    /// The channels are interleaved directly into the pipeline input buffer, so no
+    /// separate interleaving pass or temporary buffer is needed. The processing
+    /// stages work on interleaved frames; only the FIR filter de-interleaves its
+    /// input for channel counts without a dedicated routine.
+    void putSamplesPlanar(const SAMPLETYPE *const *planes,  ///< One sample buffer per channel.
+                          uint numSamples                   ///< Number of samples in each buffer.
+    );
+
+    /// Adds 'numSamples' pcs of samples in an external sample format (see
+    /// SampleConvert.h) into the input of the object, from the interleaved 'samples'
+    /// buffer or, if that is NULL, from per-channel 'planes'. The samples are
+    /// converted directly into the pipeline input buffer.
+    void putSamplesFormat(const void *samples,        ///< Interleaved samples, or NULL.
+                          const void *const *planes,  ///< One sample buffer per channel if 'samples' is NULL.
+                          int format,                 ///< Sample format, SAMPLE_FORMAT_...
+                          uint numSamples             ///< Number of samples.
+    );
+
     /// Output samples from beginning of the sample buffer. Copies requested samples to
     /// output buffer and removes them from the sample buffer. If there are less than
     /// 'numsample' samples in the buffer, returns all that available.
@@ -291,6 +526,25 @@ class SoundTouch : public FIFOProcessor {
                                 uint maxSamples      ///< How many samples to receive at max.
     );
 
+    /// Output samples into separate per-channel (planar) buffers. 'planes' must contain
+    /// 'numChannels()' pointers, each with space for 'maxSamples' samples.
+    ///
+    /// \return Number of samples returned.
+    uint receiveSamplesPlanar(SAMPLETYPE *const *planes,  ///< One output buffer per channel.
+                              uint maxSamples             ///< How many samples to receive at max.
+    );
+
+    /// Output samples in an external sample format into the interleaved 'samples'
+    /// buffer or, if that is NULL, into per-channel 'planes'. Integer formats are
+    /// clipped to their range.
+    ///
+    /// \return Number of samples returned.
+    uint receiveSamplesFormat(void *samples,        ///< Interleaved output buffer, or NULL.
+                              void *const *planes,  ///< One output buffer per channel if 'samples' is NULL.
+                              int format,           ///< Sample format, SAMPLE_FORMAT_...
+                              uint maxSamples       ///< How many samples to receive at max.
+    );
+
     /// Adjusts book-keeping so that given number of samples are removed from beginning of the
     /// sample buffer without copying them anywhere.
     ///
@@ -299,10 +553,36 @@ class SoundTouch : public FIFOProcessor {
     virtual uint receiveSamples(uint maxSamples  ///< Remove this many samples from the beginning of pipe.
     );
 
+    /// Feeds 'numSamples' samples and receives the processed samples in one call,
+    /// same as 'putSamples' followed by 'receiveSamples'. With 'numSamples' zero,
+    /// only receives, e.g. to drain the output after 'flush'.
+    ///
+    /// \return Number of samples returned.
+    uint process(const SAMPLETYPE *input,  ///< Input samples, may be NULL if 'numSamples' is zero.
+                 uint numSamples,          ///< Number of input samples.
+                 SAMPLETYPE *output,       ///< Buffer where to copy output samples.
+                 uint maxSamples           ///< How many samples to receive at max.
+    );
+
+    /// Returns the most samples that 'receiveSamples' can return after feeding
+    /// 'numSamples' samples with the current settings, provided that the output was
+    /// drained before. Sizing the output buffer to this lets each 'process' call
+    /// return all the output. Derived from 'getInputOutputSampleRatio' and
+    /// the SETTING_INITIAL_LATENCY and SETTING_NOMINAL_* values. Parameters posted
+    /// from other threads take effect with the next input, so the bound is for the
+    /// parameters already applied. Doesn't hold with SETTING_PARALLEL_STAGES, as
+    /// the worker thread may deliver the output of several calls at once.
+    uint getMaxOutput(uint numSamples) const;
+
     /// Clears all the samples in the object's output and internal processing
     /// buffers.
     virtual void clear();
 
+    /// Restores rate, tempo and pitch to their original values, and drops posted
+    /// parameter changes and pitch automation not applied yet. Doesn't touch the
+    /// settings or the buffered samples.
+    void resetParameters();
+
     /// Changes a setting controlling the processing system behaviour. See the
     /// 'SETTING_...' defines for available setting ID's.
     ///
@@ -321,9 +601,46 @@ class SoundTouch : public FIFOProcessor {
     /// Returns number of samples currently unprocessed.
     virtual uint numUnprocessedSamples() const;
 
+    /// Returns number of samples currently available for receiving.
+    virtual uint numSamples() const;
+
+    /// Returns nonzero if there aren't any samples available for receiving.
+    virtual int isEmpty() const;
+
+    /// Sets a memory budget for this instance, in bytes. Zero (the default) means
+    /// unlimited. With a budget set, large putSamples calls are fed into the processing
+    /// stages in smaller blocks so that the sample buffers don't grow by the size of the
+    /// whole call, and buffers exceeding the budget are shrunk when the instance is
+    /// cleared, flushed or its output drained.
+    ///
+    /// The budget can't go below the working memory the current processing settings
+    /// require; in that case buffers just keep their minimum size.
+    void setMemoryBudget(uint bytes);
+
+    /// Returns the memory budget set with 'setMemoryBudget', zero if unlimited.
+    uint getMemoryBudget() const { return memoryBudget; }
+
+    /// Returns the amount of heap memory currently used by this instance.
+    MemoryUsage getMemoryUsage() const;
+
+    /// Converts the samples buffered in the processing stages into the compact storage
+    /// format chosen with SETTING_IDLE_STORAGE and releases the float sample buffers.
+    /// Call this when the stream goes idle; the buffers are restored automatically on
+    /// next put/receive. Restored samples are rounded to the storage precision.
+    ///
+    /// \return 'true' if the buffers were compacted.
+    bool compactIdle();
+
     /// Return number of channels
     uint numChannels() const { return channels; }
 
+    /// Returns the input sample rate
+    uint getSampleRate() const { return inputSampleRate; }
+
+    /// Returns the output sample rate set with 'setOutputSampleRate', zero if it
+    /// follows the input sample rate
+    uint getOutputSampleRate() const { return outputSampleRate; }
+
     /// Other handy functions that are implemented in the ancestor classes (see
     /// classes 'FIFOProcessor' and 'FIFOSamplePipe')
     ///
@@ -332,6 +649,10 @@ class SoundTouch : public FIFOProcessor {
     ///                      function 'receiveSamples()'
     /// - isEmpty()        : Returns nonzero if there aren't any 'ready' samples.
     /// - clear()          : Clears all samples from ready/processing buffers.
+
+   private:
+    // Keeps the state of this instance off the cache line of the next heap object
+    SOUNDTOUCH_CACHE_LINE_PAD;
 };
 
 }  // namespace soundtouch
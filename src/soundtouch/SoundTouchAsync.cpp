@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Worker thread mode for SoundTouch. The worker moves samples from the input
+/// ring through SoundTouch to the output ring, and sleeps briefly when there's
+/// nothing to do, so the caller never has to signal it.
+///
+/// The worker stops feeding input while SoundTouch holds as much output as
+/// fits in the output ring, so a caller that doesn't read the output overruns
+/// the input ring instead of growing SoundTouch's buffers without limit.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SoundTouchAsync.h"
+
+using namespace soundtouch;
+
+SoundTouchAsync::SoundTouchAsync(SoundTouch *soundTouch, uint ringFrames)
+    : pSoundTouch(soundTouch),
+      inputRing(ringFrames, soundTouch->numChannels()),
+      outputRing(ringFrames, soundTouch->numChannels()),
+      running(true),
+      parked(false),
+      flushesRequested(0),
+      flushesDone(0),
+      overruns(0),
+      underruns(0),
+      pipelineSamples(0) {
+    transfer = new SAMPLETYPE[SOUNDTOUCH_ASYNC_TRANSFER_FRAMES * soundTouch->numChannels()];
+    worker = std::thread(&SoundTouchAsync::run, this);
+}
+
+SoundTouchAsync::~SoundTouchAsync() {
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        running.store(false, std::memory_order_relaxed);
+    }
+    wakeUp.notify_one();
+    worker.join();
+    delete pSoundTouch;
+    delete[] transfer;
+}
+
+// Copies samples into the input ring for the worker
+uint SoundTouchAsync::putSamples(const SAMPLETYPE *samples, uint nSamples) {
+    uint written = inputRing.write(samples, nSamples);
+
+    if (written < nSamples) overruns.fetch_add(1, std::memory_order_relaxed);
+    if (written > 0) wake();
+    return written;
+}
+
+// Copies processed samples from the output ring
+uint SoundTouchAsync::receiveSamples(SAMPLETYPE *output, uint maxSamples) {
+    uint received = outputRing.read(output, maxSamples);
+
+    if (received < maxSamples) underruns.fetch_add(1, std::memory_order_relaxed);
+    if (received > 0) wake();
+    return received;
+}
+
+// Asks the worker to flush once it has processed the input ring up to its current
+// write position
+void SoundTouchAsync::flush() {
+    uint requested = flushesRequested.load(std::memory_order_relaxed);
+
+    if (requested - flushesDone.load(std::memory_order_acquire) >= SOUNDTOUCH_ASYNC_MAX_FLUSHES) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    flushPositions[requested % SOUNDTOUCH_ASYNC_MAX_FLUSHES] = inputRing.getWritePosition();
+    flushesRequested.store(requested + 1, std::memory_order_release);
+    wake();
+}
+
+// Takes the lock only if the worker has parked, so the caller's thread doesn't
+// contend with a busy worker
+void SoundTouchAsync::wake() {
+    // pairs with the fence in 'run': either we see 'parked', or the worker sees our change
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        parked.store(false, std::memory_order_relaxed);
+        wakeUp.notify_one();
+    }
+}
+
+// Returns the samples in the rings and inside SoundTouch
+uint SoundTouchAsync::getLatency() const {
+    return inputRing.numFrames() + pipelineSamples.load(std::memory_order_relaxed) + outputRing.numFrames();
+}
+
+// Worker thread main loop: parks until woken up when there's nothing to do
+void SoundTouchAsync::run() {
+    while (running.load(std::memory_order_relaxed)) {
+        if (process()) continue;
+
+        // announce parking before looking once more, so that a change made
+        // meanwhile is either seen here or wakes us up
+        parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (process()) {
+            parked.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(parkMutex);
+        wakeUp.wait(lock, [this] {
+            return !parked.load(std::memory_order_relaxed) || !running.load(std::memory_order_relaxed);
+        });
+    }
+}
+
+// Does one round of work on the worker thread
+bool SoundTouchAsync::process() {
+    const SAMPLETYPE *samples;
+    bool busy = false;
+    uint n;
+
+    // move ready output to the ring as far as there's room
+    for (;;) {
+        n = outputRing.freeFrames();
+        if (n > SOUNDTOUCH_ASYNC_TRANSFER_FRAMES) n = SOUNDTOUCH_ASYNC_TRANSFER_FRAMES;
+        if (n > pSoundTouch->numSamples()) n = pSoundTouch->numSamples();
+        if (n == 0) break;
+        pSoundTouch->receiveSamples(transfer, n);
+        outputRing.write(transfer, n);
+        busy = true;
+    }
+
+    // feed new input unless the output is backing up, up to the next flush position
+    if (pSoundTouch->numSamples() < outputRing.getCapacity()) {
+        uint done = flushesDone.load(std::memory_order_relaxed);
+        bool flushPending = (flushesRequested.load(std::memory_order_acquire) != done);
+        uint toFlush = 0;
+
+        n = inputRing.peek(&samples);
+        if (flushPending) {
+            toFlush = flushPositions[done % SOUNDTOUCH_ASYNC_MAX_FLUSHES] - inputRing.getReadPosition();
+            if (n > toFlush) n = toFlush;
+        }
+        if (n > 0) {
+            pSoundTouch->putSamples(samples, n);
+            inputRing.skip(n);
+            busy = true;
+        } else if (flushPending && (toFlush == 0)) {
+            pSoundTouch->flush();
+            flushesDone.store(done + 1, std::memory_order_release);
+            busy = true;
+        }
+    }
+
+    pipelineSamples.store(pSoundTouch->numUnprocessedSamples() + pSoundTouch->numSamples(),
+                          std::memory_order_relaxed);
+    return busy;
+}
@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SoundTouchAsync' : Runs a SoundTouch instance on a worker thread. The
+/// calling thread, typically a real-time audio callback, only copies samples
+/// into an input ring and out of an output ring, so it never blocks or does
+/// any DSP itself.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SoundTouchAsync_H
+#define SoundTouchAsync_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "RingBuffer.h"
+#include "STTypes.h"
+#include "SoundTouch.h"
+
+namespace soundtouch {
+
+/// Size of the worker's buffer for moving output to the output ring, in frames
+#define SOUNDTOUCH_ASYNC_TRANSFER_FRAMES 1024
+
+/// Number of flush requests that can wait for the worker at a time
+#define SOUNDTOUCH_ASYNC_MAX_FLUSHES 16
+
+class SoundTouchAsync {
+   private:
+    /// The processing instance, used by the worker thread only
+    SoundTouch *pSoundTouch;
+
+    /// Samples put in by the caller, waiting for the worker
+    RingBuffer inputRing;
+
+    /// Processed samples waiting for the caller
+    RingBuffer outputRing;
+
+    /// Worker's buffer for moving output from SoundTouch to 'outputRing'
+    SAMPLETYPE *transfer;
+
+    std::thread worker;
+
+    /// Cleared to stop the worker thread
+    std::atomic<bool> running;
+
+    /// Set by the worker when it has nothing to do and parks on 'wakeUp', cleared
+    /// by 'wake'
+    std::atomic<bool> parked;
+
+    /// Lets the worker sleep until the caller puts, receives or flushes samples
+    std::mutex parkMutex;
+    std::condition_variable wakeUp;
+
+    /// Input ring write positions of the pending flush requests, see 'flush'
+    uint flushPositions[SOUNDTOUCH_ASYNC_MAX_FLUSHES];
+
+    /// Number of flush requests made by 'flush', and done by the worker. The
+    /// pending requests are in 'flushPositions' at these counts modulo its size.
+    std::atomic<uint> flushesRequested;
+    std::atomic<uint> flushesDone;
+
+    /// Number of 'putSamples' calls that didn't fit in the input ring
+    std::atomic<uint> overruns;
+
+    /// Number of 'receiveSamples' calls that got less samples than asked
+    std::atomic<uint> underruns;
+
+    /// Samples inside 'pSoundTouch', published by the worker for 'getLatency'
+    std::atomic<uint> pipelineSamples;
+
+    /// Worker thread main loop
+    void run();
+
+    /// Does one round of work: moves ready samples to the output ring and feeds
+    /// new input to the processing.
+    ///
+    /// \return 'true' if anything was done.
+    bool process();
+
+    /// Wakes up the worker if it's parked. Called after each change the worker
+    /// may be waiting for.
+    void wake();
+
+   public:
+    /// Starts a worker thread running 'soundTouch', which must already have its
+    /// sample rate, channels and settings set. Takes ownership of 'soundTouch'.
+    /// Both rings hold at least 'ringFrames' sample frames.
+    SoundTouchAsync(SoundTouch *soundTouch, uint ringFrames);
+
+    /// Stops the worker thread and deletes the SoundTouch instance.
+    ~SoundTouchAsync();
+
+    /// Copies samples into the input ring. Wait-free, apart from briefly taking the
+    /// worker's lock to wake it up if it's parked; call from one thread only.
+    ///
+    /// \return Number of samples accepted, less than 'numSamples' on overrun.
+    uint putSamples(const SAMPLETYPE *samples, uint numSamples);
+
+    /// Copies processed samples out of the output ring. Wait-free like 'putSamples';
+    /// call from one thread only.
+    ///
+    /// \return Number of samples returned, less than 'maxSamples' on underrun.
+    uint receiveSamples(SAMPLETYPE *output, uint maxSamples);
+
+    /// Asks the worker to flush the processing pipeline once it has processed all
+    /// samples put in so far; samples put in afterwards are processed after the
+    /// flush. Wait-free like 'putSamples'; call from the thread that puts samples
+    /// in. If too many flushes are pending, the request is dropped and counted as
+    /// an overrun.
+    void flush();
+
+    /// Thread-safe parameter changes, applied by the worker at its next block.
+    /// See 'SoundTouch::postRate' etc.
+    void postRate(double newRate) { pSoundTouch->postRate(newRate); }
+    void postTempo(double newTempo) { pSoundTouch->postTempo(newTempo); }
+    void postPitchSemiTones(double newPitch) { pSoundTouch->postPitchSemiTones(newPitch); }
+
+    /// Returns the number of 'putSamples' calls that overran the input ring.
+    uint getOverruns() const { return overruns.load(std::memory_order_relaxed); }
+
+    /// Returns the number of 'receiveSamples' calls that underran the output ring.
+    uint getUnderruns() const { return underruns.load(std::memory_order_relaxed); }
+
+    /// Returns the latency added by the rings and the processing pipeline, in sample
+    /// frames: the samples in the input ring, buffered inside SoundTouch, and waiting
+    /// in the output ring. Approximate, as the worker is running meanwhile.
+    uint getLatency() const;
+};
+
+}  // namespace soundtouch
+#endif
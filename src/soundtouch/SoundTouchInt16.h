@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SoundTouchInt16' : SoundTouch processing 16bit integer samples in the library
+/// built with float samples. The engine sources are compiled a second time with
+/// integer samples into namespace 'soundtouch_int16' (see the 'int16' directory),
+/// and this class forwards to a SoundTouch instance of that build. The integer
+/// engine costs less per sample than the float one with some settings, see
+/// test/profile_bench.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SoundTouchInt16_H
+#define SoundTouchInt16_H
+
+// Notice: this header mustn't depend on the sample type, so it doesn't include
+// STTypes.h and uses plain types
+
+#include "SoundTouch_Wrapper.h"
+
+namespace soundtouch_int16 {
+class SoundTouch;
+}
+
+namespace soundtouch {
+
+/// Forwards to 'soundtouch_int16::SoundTouch'; the functions work like those of
+/// 'SoundTouch' with 'short' samples.
+class SoundTouchInt16 {
+   private:
+    soundtouch_int16::SoundTouch *instance;
+
+   public:
+    SoundTouchInt16();
+    ~SoundTouchInt16();
+
+    bool setSetting(int settingId, int value);
+    int getSetting(int settingId) const;
+
+    void setSampleRate(unsigned int srate);
+    void setOutputSampleRate(unsigned int srate);
+    void setChannels(unsigned int numChannels);
+    void setPitchSemiTones(double newPitch);
+    void postRate(double newRate);
+    void postTempo(double newTempo);
+    void postPitchSemiTones(double newPitch);
+
+    /// Sets pitch automation breakpoints for the next input block, see
+    /// 'SoundTouch::setPitchAutomation'
+    bool setPitchAutomation(const SoundTouchPitchPoint *points, unsigned int numPoints);
+
+    void putSamples(const short *samples, unsigned int numSamples);
+    unsigned int receiveSamples(short *output, unsigned int maxSamples);
+    void putSamplesPlanar(const short *const *planes, unsigned int numSamples);
+    unsigned int receiveSamplesPlanar(short *const *planes, unsigned int maxSamples);
+    void putSamplesFormat(const void *samples, const void *const *planes, int format, unsigned int numSamples);
+    unsigned int receiveSamplesFormat(void *samples, void *const *planes, int format, unsigned int maxSamples);
+    unsigned int process(const short *input, unsigned int numSamples, short *output, unsigned int maxSamples);
+    unsigned int getMaxOutput(unsigned int numSamples) const;
+    double getInputOutputSampleRatio();
+    unsigned int numSamples() const;
+    void flush();
+
+    void setMemoryBudget(unsigned int bytes);
+    void getMemoryUsage(SoundTouchMemoryUsage *usage) const;
+    bool compactIdle();
+};
+
+}  // namespace soundtouch
+
+#endif  // SoundTouchInt16_H
@@ -0,0 +1,250 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Chunk-parallel processing of a whole recording. The output is laid out on a
+/// global time line where input sample 'i' maps to output sample 'i * ratio';
+/// chunk 'k' covers the output between its two boundaries, and consecutive
+/// chunks are crossfaded over OFFLINE_CROSSFADE_MS centered on the boundary.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SoundTouchOffline.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <thread>
+
+#include "SoundTouch.h"
+
+using namespace soundtouch;
+
+/// Samples fed into an instance at a time when processing a chunk
+#define OFFLINE_BLOCK_SAMPLES 16384
+
+SoundTouchOffline::SoundTouchOffline() {
+    sampleRate = 0;
+    outputSampleRate = 0;
+    channels = 0;
+    tempo = 1.0;
+    rate = 1.0;
+    pitchSemiTones = 0;
+    numSettings = 0;
+}
+
+// Stores a setting for the SoundTouch instances
+bool SoundTouchOffline::setSetting(int settingId, int value) {
+    if (numSettings >= OFFLINE_MAX_SETTINGS) return false;
+    settings[numSettings][0] = settingId;
+    settings[numSettings][1] = value;
+    numSettings++;
+    return true;
+}
+
+// Creates a SoundTouch instance with the stored parameters
+SoundTouch *SoundTouchOffline::newInstance() const {
+    SoundTouch *soundTouch = new SoundTouch();
+
+    soundTouch->setSampleRate(sampleRate);
+    soundTouch->setOutputSampleRate(outputSampleRate);
+    soundTouch->setChannels(channels);
+    soundTouch->setTempo(tempo);
+    soundTouch->setRate(rate);
+    soundTouch->setPitchSemiTones(pitchSemiTones);
+    for (uint i = 0; i < numSettings; i++) {
+        soundTouch->setSetting(settings[i][0], settings[i][1]);
+    }
+    return soundTouch;
+}
+
+// Returns the number of output samples for given amount of input
+uint SoundTouchOffline::getOutputLength(uint nSamples) const {
+    SoundTouch *soundTouch = newInstance();
+    double ratio = soundTouch->getInputOutputSampleRatio();
+
+    delete soundTouch;
+    return (uint)(nSamples * ratio + 0.5);
+}
+
+// Processes a range of input with a single instance
+void SoundTouchOffline::processChunk(const SAMPLETYPE *input, uint begin, uint end, OfflineChunk *chunk) const {
+    SoundTouch *soundTouch = newInstance();
+
+    chunk->length = 0;
+    while (begin < end) {
+        uint block = end - begin;
+
+        if (block > OFFLINE_BLOCK_SAMPLES) block = OFFLINE_BLOCK_SAMPLES;
+        soundTouch->putSamples(input + begin * channels, block);
+        chunk->length += soundTouch->receiveSamples(chunk->samples + chunk->length * channels,
+                                                    chunk->capacity - chunk->length);
+        begin += block;
+    }
+    soundTouch->flush();
+    chunk->length +=
+        soundTouch->receiveSamples(chunk->samples + chunk->length * channels, chunk->capacity - chunk->length);
+    delete soundTouch;
+}
+
+// Copies 'count' frames starting from 'frame' of 'chunk' into 'dest'. Frames
+// outside the chunk read as silence.
+static void copyFrames(SAMPLETYPE *dest, const OfflineChunk &chunk, long frame, uint count, uint channels) {
+    long avail = (long)chunk.length;
+    const SAMPLETYPE *src = chunk.samples;
+
+    for (uint i = 0; i < count; i++, frame++) {
+        if ((frame >= 0) && (frame < avail)) {
+            memcpy(dest + i * channels, src + frame * channels, channels * sizeof(SAMPLETYPE));
+        } else {
+            memset(dest + i * channels, 0, channels * sizeof(SAMPLETYPE));
+        }
+    }
+}
+
+// Finds the offset within +-'range' at which 'next' correlates best with 'prev'.
+// 'next' has 'range' frames of room before and after the 'length' compared.
+int SoundTouchOffline::findAlignment(const SAMPLETYPE *prev, const SAMPLETYPE *next, uint length,
+                                     int range) const {
+    double bestCorr = -1e30;
+    int bestOffset = 0;
+
+    for (int offset = -range; offset <= range; offset++) {
+        const SAMPLETYPE *cand = next + (long)offset * channels;
+        double corr = 0, norm = 0;
+
+        for (uint i = 0; i < length * channels; i++) {
+            corr += (double)prev[i] * (double)cand[i];
+            norm += (double)cand[i] * (double)cand[i];
+        }
+        // normalize by the candidate energy, like the time-stretch overlap seek
+        corr /= sqrt(norm + 1e-9);
+        if (corr > bestCorr) {
+            bestCorr = corr;
+            bestOffset = offset;
+        }
+    }
+    return bestOffset;
+}
+
+// Processes the input in parallel chunks and joins the chunk outputs
+uint SoundTouchOffline::process(const SAMPLETYPE *input, uint nSamples, SAMPLETYPE *output, uint numJobs) {
+    SoundTouch *soundTouch;
+    double ratio;
+    uint outLength, outRate, crossfade, roll;
+    int range;
+
+    if ((sampleRate == 0) || (channels == 0)) {
+        ST_THROW_RT_ERROR("SoundTouchOffline : Sample rate or channels not defined");
+        return 0;
+    }
+
+    soundTouch = newInstance();
+    ratio = soundTouch->getInputOutputSampleRatio();
+    // pre- and post-roll: room for the crossfade and alignment search, plus the
+    // processing latency for the instances to settle. These are output samples.
+    outRate = outputSampleRate ? outputSampleRate : sampleRate;
+    crossfade = OFFLINE_CROSSFADE_MS * outRate / 1000;
+    range = (int)(OFFLINE_ALIGN_MS * outRate / 1000);
+    roll = (uint)((crossfade / 2 + range) / ratio) + 2 * (uint)soundTouch->getSetting(SETTING_INITIAL_LATENCY);
+    delete soundTouch;
+
+    outLength = (uint)(nSamples * ratio + 0.5);
+
+    // each chunk should be considerably longer than the rolls around it
+    if (numJobs > nSamples / (4 * roll)) numJobs = nSamples / (4 * roll);
+    if (numJobs < 1) numJobs = 1;
+
+    uint *begin = new uint[numJobs + 1];
+    OfflineChunk *results = new OfflineChunk[numJobs];
+    std::thread *workers = new std::thread[numJobs];
+
+    for (uint k = 0; k <= numJobs; k++) {
+        begin[k] = (uint)((unsigned long long)nSamples * k / numJobs);
+    }
+    for (uint k = 0; k < numJobs; k++) {
+        uint from = (k > 0) ? begin[k] - roll : 0;
+        uint to = (k < numJobs - 1) ? begin[k + 1] + roll : nSamples;
+
+        // room for the flushed output of the chunk plus rounding
+        results[k].capacity = (uint)((to - from) * ratio) + OFFLINE_BLOCK_SAMPLES;
+        results[k].samples = new SAMPLETYPE[results[k].capacity * channels];
+        if (k == 0) continue;
+        workers[k] = std::thread(&SoundTouchOffline::processChunk, this, input, from, to, &results[k]);
+    }
+    processChunk(input, 0, (numJobs > 1) ? begin[1] + roll : nSamples, &results[0]);
+    for (uint k = 1; k < numJobs; k++) {
+        workers[k].join();
+    }
+
+    // Join the chunks. 'origin' is the output position of the first frame of a
+    // chunk's output, and 'shift' how much the chunk is delayed against that for
+    // aligning it with the previous chunk.
+    SAMPLETYPE *prevFade = new SAMPLETYPE[crossfade * channels];
+    SAMPLETYPE *nextFade = new SAMPLETYPE[(crossfade + 2 * range) * channels];
+    long origin = 0, shift = 0;
+    uint pos = 0;
+
+    for (uint k = 0; k < numJobs; k++) {
+        uint segmentEnd = outLength;
+
+        if (k < numJobs - 1) {
+            segmentEnd = (uint)(begin[k + 1] * ratio + 0.5) - crossfade / 2;
+            if (segmentEnd < pos) segmentEnd = pos;
+        }
+        copyFrames(output + pos * channels, results[k], (long)pos - origin + shift, segmentEnd - pos, channels);
+        pos = segmentEnd;
+        if (k == numJobs - 1) break;
+
+        // align the next chunk against this one over the crossfade and fade over
+        long nextOrigin = (long)((begin[k + 1] - roll) * ratio + 0.5);
+        uint fade = (pos + crossfade <= outLength) ? crossfade : outLength - pos;
+
+        copyFrames(prevFade, results[k], (long)pos - origin + shift, fade, channels);
+        copyFrames(nextFade, results[k + 1], (long)pos - nextOrigin - range, fade + 2 * range, channels);
+        shift = findAlignment(prevFade, nextFade + range * channels, fade, range);
+        origin = nextOrigin;
+
+        const SAMPLETYPE *next = nextFade + (range + shift) * channels;
+        for (uint i = 0; i < fade; i++) {
+            float w = ((float)i + 0.5f) / (float)fade;
+
+            for (uint c = 0; c < channels; c++) {
+                uint j = i * channels + c;
+                output[pos * channels + j] = (SAMPLETYPE)((1.0f - w) * prevFade[j] + w * next[j]);
+            }
+        }
+        pos += fade;
+    }
+
+    delete[] prevFade;
+    delete[] nextFade;
+    for (uint k = 0; k < numJobs; k++) {
+        delete[] results[k].samples;
+    }
+    delete[] workers;
+    delete[] results;
+    delete[] begin;
+    return outLength;
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SoundTouchOffline' : Processes a whole recording held in memory by splitting
+/// it into chunks that separate SoundTouch instances process in parallel.
+///
+/// Each chunk is processed with some pre-roll before and post-roll after it, so
+/// the instances have settled by the time they reach the chunk boundaries. The
+/// chunk outputs are joined with a crossfade, aligned by cross-correlation as
+/// the time-stretch of different instances isn't in the same phase.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SoundTouchOffline_H
+#define SoundTouchOffline_H
+
+#include "STTypes.h"
+
+namespace soundtouch {
+
+/// Length of the crossfade between chunks, in milliseconds of output
+#define OFFLINE_CROSSFADE_MS 20
+
+/// Range searched for the best alignment of a chunk against the previous one,
+/// in +- milliseconds of output
+#define OFFLINE_ALIGN_MS 8
+
+/// Maximum number of settings stored by 'SoundTouchOffline::setSetting'
+#define OFFLINE_MAX_SETTINGS 16
+
+/// Output of one chunk
+struct OfflineChunk {
+    SAMPLETYPE *samples;
+    uint capacity;
+    uint length;
+};
+
+class SoundTouchOffline {
+   private:
+    uint sampleRate;
+    uint outputSampleRate;
+    uint channels;
+    double tempo;
+    double rate;
+    double pitchSemiTones;
+
+    /// Settings for the SoundTouch instances as (id, value) pairs
+    int settings[OFFLINE_MAX_SETTINGS][2];
+    uint numSettings;
+
+    /// Creates a SoundTouch instance with the stored parameters
+    class SoundTouch *newInstance() const;
+
+    /// Processes input samples 'begin' .. 'end' with one instance, flushing it
+    /// at the end, into 'chunk'.
+    void processChunk(const SAMPLETYPE *input, uint begin, uint end, OfflineChunk *chunk) const;
+
+    /// Returns the offset of 'next' against 'prev' within +-'range' samples, for
+    /// which they correlate best over 'length' samples.
+    int findAlignment(const SAMPLETYPE *prev, const SAMPLETYPE *next, uint length, int range) const;
+
+   public:
+    SoundTouchOffline();
+
+    /// Processing parameters, see the corresponding SoundTouch functions.
+    void setSampleRate(uint srate) { sampleRate = srate; }
+    void setOutputSampleRate(uint srate) { outputSampleRate = srate; }
+    void setChannels(uint numChannels) { channels = numChannels; }
+    void setTempo(double newTempo) { tempo = newTempo; }
+    void setRate(double newRate) { rate = newRate; }
+    void setPitchSemiTones(double newPitch) { pitchSemiTones = newPitch; }
+
+    /// Stores a setting for the SoundTouch instances, see 'SoundTouch::setSetting'.
+    ///
+    /// \return 'false' if too many settings have been stored.
+    bool setSetting(int settingId, int value);
+
+    /// Returns the number of samples output for 'numSamples' input samples. This
+    /// equals the amount that a single SoundTouch instance outputs up to 'flush'.
+    uint getOutputLength(uint numSamples) const;
+
+    /// Processes 'numSamples' samples from 'input' into 'output', which must have
+    /// room for 'getOutputLength(numSamples)' samples. The input is split into
+    /// 'numJobs' chunks that are processed on as many threads; fewer if the input
+    /// is too short for that many.
+    ///
+    /// \return Number of samples written to 'output'.
+    uint process(const SAMPLETYPE *input,  ///< Input samples, interleaved.
+                 uint numSamples,          ///< Number of input samples.
+                 SAMPLETYPE *output,       ///< Buffer for the output samples.
+                 uint numJobs              ///< Number of parallel chunks.
+    );
+};
+
+}  // namespace soundtouch
+#endif
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SoundTouchPool' : Keeps ready-built SoundTouch instances for services that
+/// process many short streams.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SoundTouchPool.h"
+
+#include "SoundTouch.h"
+
+using namespace soundtouch;
+
+// Settings that an instance may have changed while handed out. Parallel stages go
+// first so that the worker thread is stopped before the others are set.
+static const int resetSettingIds[POOL_NUM_RESET_SETTINGS] = {
+    SETTING_PARALLEL_STAGES, SETTING_USE_AA_FILTER, SETTING_AA_FILTER_LENGTH, SETTING_INTERPOLATION, SETTING_USE_QUICKSEEK,
+    SETTING_SEQUENCE_MS, SETTING_SEEKWINDOW_MS, SETTING_OVERLAP_MS, SETTING_IDLE_STORAGE, SETTING_SEPARATE_CHANNELS,
+    SETTING_PROCESSING_RATE};
+
+SoundTouchPool::SoundTouchPool(uint srate, uint numChannels) {
+    SoundTouch soundTouch;
+
+    sampleRate = srate;
+    channels = numChannels;
+    numSettings = 0;
+    for (uint i = 0; i < POOL_NUM_RESET_SETTINGS; i++) {
+        defaults[i] = soundTouch.getSetting(resetSettingIds[i]);
+    }
+}
+
+SoundTouchPool::~SoundTouchPool() {
+    for (size_t i = 0; i < idle.size(); i++) {
+        delete idle[i];
+    }
+}
+
+// Stores a setting for the SoundTouch instances
+bool SoundTouchPool::setSetting(int settingId, int value) {
+    if (numSettings >= POOL_MAX_SETTINGS) return false;
+    settings[numSettings][0] = settingId;
+    settings[numSettings][1] = value;
+    numSettings++;
+    return true;
+}
+
+// Creates a SoundTouch instance with the pool parameters
+SoundTouch *SoundTouchPool::newInstance() const {
+    SoundTouch *soundTouch = new SoundTouch();
+
+    soundTouch->setSampleRate(sampleRate);
+    soundTouch->setChannels(channels);
+    for (uint i = 0; i < numSettings; i++) {
+        soundTouch->setSetting(settings[i][0], settings[i][1]);
+    }
+    // redo the initial buffering for the channel count, so that new and reused
+    // instances have the same latency
+    soundTouch->clear();
+    return soundTouch;
+}
+
+// Returns an instance to its initial state. Only what was changed is set again,
+// as some of the settings recalculate the processing parameters.
+void SoundTouchPool::resetInstance(SoundTouch *soundTouch) const {
+    for (uint i = 0; i < POOL_NUM_RESET_SETTINGS; i++) {
+        int value = defaults[i];
+
+        // the last pool setting of the same id wins, as in 'newInstance'
+        for (uint k = 0; k < numSettings; k++) {
+            if (settings[k][0] == resetSettingIds[i]) value = settings[k][1];
+        }
+        if (soundTouch->getSetting(resetSettingIds[i]) != value) soundTouch->setSetting(resetSettingIds[i], value);
+    }
+    if (soundTouch->getMemoryBudget() != 0) soundTouch->setMemoryBudget(0);
+    if (soundTouch->getSampleRate() != sampleRate) soundTouch->setSampleRate(sampleRate);
+    if (soundTouch->getOutputSampleRate() != 0) soundTouch->setOutputSampleRate(0);
+    if (soundTouch->numChannels() != channels) soundTouch->setChannels(channels);
+    soundTouch->resetParameters();
+    soundTouch->clear();
+}
+
+// Builds instances until the pool holds at least 'count' idle ones
+void SoundTouchPool::reserve(uint count) {
+    while (numIdle() < count) {
+        SoundTouch *soundTouch = newInstance();
+        std::lock_guard<std::mutex> guard(lock);
+        idle.push_back(soundTouch);
+    }
+}
+
+// Returns the number of idle instances
+uint SoundTouchPool::numIdle() {
+    std::lock_guard<std::mutex> guard(lock);
+    return (uint)idle.size();
+}
+
+// Hands out an idle instance, or builds a new one
+SoundTouch *SoundTouchPool::acquire() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!idle.empty()) {
+            SoundTouch *soundTouch = idle.back();
+            idle.pop_back();
+            return soundTouch;
+        }
+    }
+    // build outside the lock so that other threads aren't held up
+    return newInstance();
+}
+
+// Takes back an instance handed out by 'acquire'
+void SoundTouchPool::release(SoundTouch *soundTouch) {
+    // reset before taking the lock, so that the instance is ready when handed out
+    resetInstance(soundTouch);
+
+    std::lock_guard<std::mutex> guard(lock);
+    idle.push_back(soundTouch);
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SoundTouchPool' : Keeps ready-built SoundTouch instances for services that
+/// process many short streams, so that a stream needn't pay for constructing and
+/// configuring an instance. Instances returned to the pool are cleared and their
+/// parameters restored, which costs far less than building a new one.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SoundTouchPool_H
+#define SoundTouchPool_H
+
+#include <mutex>
+#include <vector>
+
+#include "STTypes.h"
+
+namespace soundtouch {
+
+/// Maximum number of settings stored by 'SoundTouchPool::setSetting'
+#define POOL_MAX_SETTINGS 16
+
+/// Number of settable SETTING_... values that 'SoundTouchPool::release' restores
+#define POOL_NUM_RESET_SETTINGS 11
+
+class SoundTouchPool {
+   private:
+    uint sampleRate;
+    uint channels;
+
+    /// Settings for the SoundTouch instances as (id, value) pairs
+    int settings[POOL_MAX_SETTINGS][2];
+    uint numSettings;
+
+    /// Values of the settable settings in a new SoundTouch instance, before the
+    /// pool settings are applied, in the order of 'resetSettingIds'
+    int defaults[POOL_NUM_RESET_SETTINGS];
+
+    /// Guards 'idle'
+    std::mutex lock;
+
+    /// Instances ready to be handed out
+    std::vector<class SoundTouch *> idle;
+
+    /// Creates a SoundTouch instance with the pool parameters
+    class SoundTouch *newInstance() const;
+
+    /// Returns an instance to its state right after 'newInstance'
+    void resetInstance(class SoundTouch *soundTouch) const;
+
+   public:
+    SoundTouchPool(uint sampleRate, uint numChannels);
+    ~SoundTouchPool();
+
+    /// Stores a setting for the SoundTouch instances, see 'SoundTouch::setSetting'.
+    /// Store the settings before 'reserve' or 'acquire'.
+    ///
+    /// \return 'false' if too many settings have been stored.
+    bool setSetting(int settingId, int value);
+
+    /// Builds instances until the pool holds at least 'count' idle ones.
+    void reserve(uint count);
+
+    /// Returns the number of idle instances in the pool.
+    uint numIdle();
+
+    /// Hands out an idle instance, or builds a new one if none is left. The
+    /// instance can be used freely, but should keep the pool's sample rate and
+    /// channel count. Thread-safe.
+    class SoundTouch *acquire();
+
+    /// Takes back an instance handed out by 'acquire'. The instance is cleared and
+    /// returned to the configuration of a new pool instance before it's handed out
+    /// again: rate, tempo, pitch, sample rates, memory budget and all the settable
+    /// settings. Thread-safe.
+    void release(class SoundTouch *soundTouch);
+};
+
+}  // namespace soundtouch
+#endif
@@ -1,59 +1,419 @@
 
 #include "SoundTouch_Wrapper.h"
 
+#include "RateTransposer.h"
+#include "SampleConvert.h"
 #include "SoundTouch.h"
+#include "SoundTouchAsync.h"
+#include "SoundTouchInt16.h"
+#include "SoundTouchOffline.h"
+#include "SoundTouchPool.h"
+#include "StreamEngine.h"
+#include "TDStretch.h"
 
 using namespace soundtouch;
 
-void *SoundTouch_init(void) {
-    SoundTouch *soundTouch = new SoundTouch();
-    soundTouch->setSetting(SETTING_USE_QUICKSEEK, false);
-    soundTouch->setSetting(SETTING_USE_AA_FILTER, true);
-    soundTouch->setSetting(SETTING_SEQUENCE_MS, 40);
-    soundTouch->setSetting(SETTING_SEEKWINDOW_MS, 15);
-    soundTouch->setSetting(SETTING_OVERLAP_MS, 8);
+// Handles of int16 engine instances are 'SoundTouchInt16' pointers tagged with the
+// lowest bit, which is clear in every pointer returned by 'new'. Other handles are
+// plain 'SoundTouch' pointers.
+#define INT16_HANDLE_TAG ((ulongptr)1)
+
+static inline bool isInt16Handle(void *stouch) { return ((ulongptr)stouch & INT16_HANDLE_TAG) != 0; }
+
+static inline SoundTouchInt16 *int16Instance(void *stouch) {
+    return (SoundTouchInt16 *)((ulongptr)stouch & ~INT16_HANDLE_TAG);
+}
+
+// Makes 'call' on the instance behind handle 'stouch', whichever engine it uses.
+// Only for calls whose arguments don't depend on the sample type.
+#define INSTANCE_CALL(stouch, call) \
+    (isInt16Handle(stouch) ? int16Instance(stouch)->call : ((SoundTouch *)(stouch))->call)
+
+#define NUM_PROFILES 4
+#define NUM_PROFILE_SETTINGS 7
+
+// Settings of the SOUNDTOUCH_PROFILE_* profiles
+static const int profileSettings[NUM_PROFILES][NUM_PROFILE_SETTINGS][2] = {
+    // low latency: short sequences and seek window
+    {{SETTING_USE_QUICKSEEK, false},
+     {SETTING_USE_AA_FILTER, true},
+     {SETTING_AA_FILTER_LENGTH, 32},
+     {SETTING_INTERPOLATION, TransposerBase::CUBIC},
+     {SETTING_SEQUENCE_MS, 20},
+     {SETTING_SEEKWINDOW_MS, 8},
+     {SETTING_OVERLAP_MS, 4}},
+    // speech
+    {{SETTING_USE_QUICKSEEK, false},
+     {SETTING_USE_AA_FILTER, true},
+     {SETTING_AA_FILTER_LENGTH, 64},
+     {SETTING_INTERPOLATION, TransposerBase::CUBIC},
+     {SETTING_SEQUENCE_MS, 40},
+     {SETTING_SEEKWINDOW_MS, 15},
+     {SETTING_OVERLAP_MS, 8}},
+    // music quality: sequence and seek window adjusted to the tempo, long anti-alias
+    // filter and sinc interpolation
+    {{SETTING_USE_QUICKSEEK, false},
+     {SETTING_USE_AA_FILTER, true},
+     {SETTING_AA_FILTER_LENGTH, 128},
+     {SETTING_INTERPOLATION, TransposerBase::SHANNON},
+     {SETTING_SEQUENCE_MS, USE_AUTO_SEQUENCE_LEN},
+     {SETTING_SEEKWINDOW_MS, USE_AUTO_SEEKWINDOW_LEN},
+     {SETTING_OVERLAP_MS, 8}},
+    // max throughput: quick seek, short anti-alias filter and linear interpolation
+    {{SETTING_USE_QUICKSEEK, true},
+     {SETTING_USE_AA_FILTER, true},
+     {SETTING_AA_FILTER_LENGTH, 16},
+     {SETTING_INTERPOLATION, TransposerBase::LINEAR},
+     {SETTING_SEQUENCE_MS, 40},
+     {SETTING_SEEKWINDOW_MS, 15},
+     {SETTING_OVERLAP_MS, 8}},
+};
+
+// Settings applied to the other instances created through the wrapper
+static const int (*const defaultSettings)[2] = profileSettings[SOUNDTOUCH_PROFILE_SPEECH];
+
+#define NUM_DEFAULT_SETTINGS NUM_PROFILE_SETTINGS
+
+void *SoundTouch_init(void) { return SoundTouch_initWithProfile(SOUNDTOUCH_PROFILE_SPEECH); }
+
+void *SoundTouch_initWithProfile(int profile) { return SoundTouch_initWithEngine(profile, SOUNDTOUCH_ENGINE_FLOAT); }
+
+void *SoundTouch_initWithEngine(int profile, int engine) {
+    void *stouch;
+
+    if ((profile < 0) || (profile >= NUM_PROFILES)) return NULL;
+    if (engine == SOUNDTOUCH_ENGINE_INT16) {
+        stouch = (void *)((ulongptr) new SoundTouchInt16() | INT16_HANDLE_TAG);
+    } else if (engine == SOUNDTOUCH_ENGINE_FLOAT) {
+        stouch = (void *)new SoundTouch();
+    } else {
+        return NULL;
+    }
+    for (unsigned int i = 0; i < NUM_PROFILE_SETTINGS; i++) {
+        INSTANCE_CALL(stouch, setSetting(profileSettings[profile][i][0], profileSettings[profile][i][1]));
+    }
+    return stouch;
+}
+
+void *SoundTouch_initBatch(unsigned int sampleRate, unsigned int numStreams) {
+    SoundTouch *soundTouch = (SoundTouch *)SoundTouch_init();
+    soundTouch->setSampleRate(sampleRate);
+    soundTouch->setChannels(numStreams);
+    soundTouch->setSetting(SETTING_SEPARATE_CHANNELS, true);
+    // redo the initial buffering for the new channel count, so that every stream
+    // gets the same latency as when processed alone
+    soundTouch->clear();
     return (void *)soundTouch;
 }
 
 void SoundTouch_setSampleRate(void *stouch, unsigned int sampleRate) {
-    SoundTouch *soundTouch = (SoundTouch *)stouch;
-    soundTouch->setSampleRate(sampleRate);
+    INSTANCE_CALL(stouch, setSampleRate(sampleRate));
+}
+
+void SoundTouch_setOutputSampleRate(void *stouch, unsigned int sampleRate) {
+    INSTANCE_CALL(stouch, setOutputSampleRate(sampleRate));
+}
+
+int SoundTouch_setSetting(void *stouch, int settingId, int value) {
+    return INSTANCE_CALL(stouch, setSetting(settingId, value)) ? 1 : 0;
+}
+
+int SoundTouch_getSetting(void *stouch, int settingId) {
+    return INSTANCE_CALL(stouch, getSetting(settingId));
+}
+
+void SoundTouch_setProcessingRate(void *stouch, unsigned int sampleRate) {
+    INSTANCE_CALL(stouch, setSetting(SETTING_PROCESSING_RATE, (int)sampleRate));
 }
 
 void SoundTouch_setChannels(void *stouch, unsigned int channels) {
-    SoundTouch *soundTouch = (SoundTouch *)stouch;
-    soundTouch->setChannels(channels);
+    INSTANCE_CALL(stouch, setChannels(channels));
 }
 
 void SoundTouch_setPitchSemiTones(void *stouch, float semiTones) {
+    INSTANCE_CALL(stouch, setPitchSemiTones(semiTones));
+}
+
+void SoundTouch_postRate(void *stouch, float rate) {
+    INSTANCE_CALL(stouch, postRate(rate));
+}
+
+void SoundTouch_postTempo(void *stouch, float tempo) {
+    INSTANCE_CALL(stouch, postTempo(tempo));
+}
+
+void SoundTouch_postPitchSemiTones(void *stouch, float semiTones) {
+    INSTANCE_CALL(stouch, postPitchSemiTones(semiTones));
+}
+
+int SoundTouch_setPitchAutomation(void *stouch, const SoundTouchPitchPoint *points, unsigned int numPoints) {
     SoundTouch *soundTouch = (SoundTouch *)stouch;
-    soundTouch->setPitchSemiTones(semiTones);
+    PitchAutomationPoint automation[SOUNDTOUCH_MAX_AUTOMATION_POINTS];
+
+    if (isInt16Handle(stouch)) return int16Instance(stouch)->setPitchAutomation(points, numPoints) ? 1 : 0;
+    if (numPoints > SOUNDTOUCH_MAX_AUTOMATION_POINTS) return 0;
+    for (unsigned int i = 0; i < numPoints; i++) {
+        automation[i].frameOffset = points[i].frameOffset;
+        automation[i].semiTones = points[i].semiTones;
+    }
+    return soundTouch->setPitchAutomation(automation, numPoints) ? 1 : 0;
 }
 
 void SoundTouch_free(void *stouch) {
-    SoundTouch *soundTouch = (SoundTouch *)stouch;
-    delete soundTouch;
+    if (isInt16Handle(stouch)) {
+        delete int16Instance(stouch);
+    } else {
+        delete (SoundTouch *)stouch;
+    }
+}
+
+void *SoundTouch_poolInit(unsigned int sampleRate, unsigned int channels, unsigned int size) {
+    SoundTouchPool *pool = new SoundTouchPool(sampleRate, channels);
+    for (unsigned int i = 0; i < NUM_DEFAULT_SETTINGS; i++) {
+        pool->setSetting(defaultSettings[i][0], defaultSettings[i][1]);
+    }
+    pool->reserve(size);
+    return (void *)pool;
+}
+
+void SoundTouch_poolFree(void *pool) {
+    SoundTouchPool *soundTouchPool = (SoundTouchPool *)pool;
+    delete soundTouchPool;
+}
+
+void *SoundTouch_poolAcquire(void *pool) {
+    SoundTouchPool *soundTouchPool = (SoundTouchPool *)pool;
+    return (void *)soundTouchPool->acquire();
+}
+
+void SoundTouch_poolRelease(void *pool, void *stouch) {
+    SoundTouchPool *soundTouchPool = (SoundTouchPool *)pool;
+    soundTouchPool->release((SoundTouch *)stouch);
 }
 
 void SoundTouch_putSamples(void *stouch, void *samples, unsigned int numSamples) {
-    SoundTouch *soundTouch = (SoundTouch *)stouch;
-#ifdef SOUNDTOUCH_INTEGER_SAMPLES
-    soundTouch->putSamples((SAMPLETYPE *)samples, numSamples);
-#else
-    soundTouch->putSamples((SAMPLETYPE *)samples, numSamples);
-#endif
+    if (isInt16Handle(stouch)) {
+        int16Instance(stouch)->putSamples((const short *)samples, numSamples);
+    } else {
+        ((SoundTouch *)stouch)->putSamples((const SAMPLETYPE *)samples, numSamples);
+    }
 }
 
 unsigned int SoundTouch_receiveSamples(void *stouch, void *samples, unsigned int maxSamples) {
-    SoundTouch *soundTouch = (SoundTouch *)stouch;
-#ifdef SOUNDTOUCH_INTEGER_SAMPLES
-    return soundTouch->receiveSamples((SAMPLETYPE *)samples, maxSamples);
-#else
-    return soundTouch->receiveSamples((SAMPLETYPE *)samples, maxSamples);
-#endif
+    if (isInt16Handle(stouch)) {
+        return int16Instance(stouch)->receiveSamples((short *)samples, maxSamples);
+    }
+    return ((SoundTouch *)stouch)->receiveSamples((SAMPLETYPE *)samples, maxSamples);
+}
+
+int SoundTouch_process(void *stouch, const void *input, unsigned int numSamples, void *output, unsigned int maxOutput,
+                       unsigned int *numOutput) {
+    if (isInt16Handle(stouch)) {
+        *numOutput = int16Instance(stouch)->process((const short *)input, numSamples, (short *)output, maxOutput);
+    } else {
+        *numOutput =
+            ((SoundTouch *)stouch)->process((const SAMPLETYPE *)input, numSamples, (SAMPLETYPE *)output, maxOutput);
+    }
+    return (INSTANCE_CALL(stouch, numSamples()) == 0) ? 1 : 0;
+}
+
+unsigned int SoundTouch_getMaxOutput(void *stouch, unsigned int numSamples) {
+    return INSTANCE_CALL(stouch, getMaxOutput(numSamples));
+}
+
+double SoundTouch_getInputOutputSampleRatio(void *stouch) { return INSTANCE_CALL(stouch, getInputOutputSampleRatio()); }
+
+void SoundTouch_putSamplesPlanar(void *stouch, const void *const *planes, unsigned int numSamples) {
+    if (isInt16Handle(stouch)) {
+        int16Instance(stouch)->putSamplesPlanar((const short *const *)planes, numSamples);
+    } else {
+        ((SoundTouch *)stouch)->putSamplesPlanar((const SAMPLETYPE *const *)planes, numSamples);
+    }
+}
+
+unsigned int SoundTouch_receiveSamplesPlanar(void *stouch, void *const *planes, unsigned int maxSamples) {
+    if (isInt16Handle(stouch)) {
+        return int16Instance(stouch)->receiveSamplesPlanar((short *const *)planes, maxSamples);
+    }
+    return ((SoundTouch *)stouch)->receiveSamplesPlanar((SAMPLETYPE *const *)planes, maxSamples);
+}
+
+int SoundTouch_putSamplesFormat(void *stouch, const void *samples, unsigned int numSamples, int format) {
+    if (!SampleConvert::isValid(format)) return 0;
+    INSTANCE_CALL(stouch, putSamplesFormat(samples, NULL, format, numSamples));
+    return 1;
+}
+
+unsigned int SoundTouch_receiveSamplesFormat(void *stouch, void *samples, unsigned int maxSamples, int format) {
+    if (!SampleConvert::isValid(format)) return 0;
+    return INSTANCE_CALL(stouch, receiveSamplesFormat(samples, NULL, format, maxSamples));
+}
+
+int SoundTouch_putSamplesPlanarFormat(void *stouch, const void *const *planes, unsigned int numSamples, int format) {
+    if (!SampleConvert::isValid(format)) return 0;
+    INSTANCE_CALL(stouch, putSamplesFormat(NULL, planes, format, numSamples));
+    return 1;
+}
+
+unsigned int SoundTouch_receiveSamplesPlanarFormat(void *stouch, void *const *planes, unsigned int maxSamples,
+                                                   int format) {
+    if (!SampleConvert::isValid(format)) return 0;
+    return INSTANCE_CALL(stouch, receiveSamplesFormat(NULL, planes, format, maxSamples));
 }
 
 void SoundTouch_flush(void *stouch) {
-    SoundTouch *soundTouch = (SoundTouch *)stouch;
-    soundTouch->flush();
+    INSTANCE_CALL(stouch, flush());
+}
+
+void SoundTouch_setMemoryBudget(void *stouch, unsigned int bytes) {
+    INSTANCE_CALL(stouch, setMemoryBudget(bytes));
+}
+
+void SoundTouch_getMemoryUsage(void *stouch, SoundTouchMemoryUsage *usage) {
+    if (isInt16Handle(stouch)) {
+        int16Instance(stouch)->getMemoryUsage(usage);
+        return;
+    }
+    MemoryUsage mem = ((SoundTouch *)stouch)->getMemoryUsage();
+
+    usage->rateTransposer = mem.rateTransposer;
+    usage->tdStretch = mem.tdStretch;
+    usage->instance = mem.instance;
+    usage->total = mem.total;
+}
+
+int SoundTouch_setIdleStorage(void *stouch, int format) {
+    return INSTANCE_CALL(stouch, setSetting(SETTING_IDLE_STORAGE, format)) ? 1 : 0;
+}
+
+int SoundTouch_compactIdle(void *stouch) {
+    return INSTANCE_CALL(stouch, compactIdle()) ? 1 : 0;
+}
+
+void SoundTouch_setParallelStages(void *stouch, int enable) {
+    INSTANCE_CALL(stouch, setSetting(SETTING_PARALLEL_STAGES, enable));
+}
+
+void *SoundTouch_initAsync(unsigned int sampleRate, unsigned int channels, unsigned int ringFrames) {
+    SoundTouch *soundTouch = (SoundTouch *)SoundTouch_init();
+    soundTouch->setSampleRate(sampleRate);
+    soundTouch->setChannels(channels);
+    return (void *)new SoundTouchAsync(soundTouch, ringFrames);
+}
+
+void SoundTouch_freeAsync(void *stouchAsync) {
+    SoundTouchAsync *async = (SoundTouchAsync *)stouchAsync;
+    delete async;
+}
+
+unsigned int SoundTouch_putSamplesAsync(void *stouchAsync, const void *samples, unsigned int numSamples) {
+    SoundTouchAsync *async = (SoundTouchAsync *)stouchAsync;
+    return async->putSamples((const SAMPLETYPE *)samples, numSamples);
+}
+
+unsigned int SoundTouch_receiveSamplesAsync(void *stouchAsync, void *samples, unsigned int maxSamples) {
+    SoundTouchAsync *async = (SoundTouchAsync *)stouchAsync;
+    return async->receiveSamples((SAMPLETYPE *)samples, maxSamples);
+}
+
+void SoundTouch_postPitchSemiTonesAsync(void *stouchAsync, float semiTones) {
+    SoundTouchAsync *async = (SoundTouchAsync *)stouchAsync;
+    async->postPitchSemiTones(semiTones);
+}
+
+void SoundTouch_flushAsync(void *stouchAsync) {
+    SoundTouchAsync *async = (SoundTouchAsync *)stouchAsync;
+    async->flush();
+}
+
+void SoundTouch_getAsyncStats(void *stouchAsync, SoundTouchAsyncStats *stats) {
+    SoundTouchAsync *async = (SoundTouchAsync *)stouchAsync;
+
+    stats->overruns = async->getOverruns();
+    stats->underruns = async->getUnderruns();
+    stats->latencyFrames = async->getLatency();
+}
+
+void *SoundTouch_initOffline(unsigned int sampleRate, unsigned int channels) {
+    SoundTouchOffline *offline = new SoundTouchOffline();
+    offline->setSampleRate(sampleRate);
+    offline->setChannels(channels);
+    for (unsigned int i = 0; i < NUM_DEFAULT_SETTINGS; i++) {
+        offline->setSetting(defaultSettings[i][0], defaultSettings[i][1]);
+    }
+    return (void *)offline;
+}
+
+void SoundTouch_freeOffline(void *stouchOffline) {
+    SoundTouchOffline *offline = (SoundTouchOffline *)stouchOffline;
+    delete offline;
+}
+
+void SoundTouch_setPitchSemiTonesOffline(void *stouchOffline, float semiTones) {
+    SoundTouchOffline *offline = (SoundTouchOffline *)stouchOffline;
+    offline->setPitchSemiTones(semiTones);
+}
+
+void SoundTouch_setOutputSampleRateOffline(void *stouchOffline, unsigned int sampleRate) {
+    SoundTouchOffline *offline = (SoundTouchOffline *)stouchOffline;
+    offline->setOutputSampleRate(sampleRate);
+}
+
+void SoundTouch_setProcessingRateOffline(void *stouchOffline, unsigned int sampleRate) {
+    SoundTouchOffline *offline = (SoundTouchOffline *)stouchOffline;
+    offline->setSetting(SETTING_PROCESSING_RATE, (int)sampleRate);
+}
+
+unsigned int SoundTouch_getOfflineOutputLength(void *stouchOffline, unsigned int numSamples) {
+    SoundTouchOffline *offline = (SoundTouchOffline *)stouchOffline;
+    return offline->getOutputLength(numSamples);
+}
+
+unsigned int SoundTouch_processOffline(void *stouchOffline, const void *input, unsigned int numSamples, void *output,
+                                       unsigned int numJobs) {
+    SoundTouchOffline *offline = (SoundTouchOffline *)stouchOffline;
+    return offline->process((const SAMPLETYPE *)input, numSamples, (SAMPLETYPE *)output, numJobs);
+}
+
+void *SoundTouch_engineInit(unsigned int numThreads) { return (void *)new StreamEngine(numThreads); }
+
+void SoundTouch_engineFree(void *engine) {
+    StreamEngine *streamEngine = (StreamEngine *)engine;
+    delete streamEngine;
+}
+
+void *SoundTouch_engineCreateStream(void *engine, unsigned int sampleRate, unsigned int channels) {
+    StreamEngine *streamEngine = (StreamEngine *)engine;
+    StreamEngine::Stream *stream = streamEngine->createStream(sampleRate, channels);
+    for (unsigned int i = 0; i < NUM_DEFAULT_SETTINGS; i++) {
+        stream->setSetting(defaultSettings[i][0], defaultSettings[i][1]);
+    }
+    return (void *)stream;
+}
+
+void SoundTouch_engineDestroyStream(void *engine, void *stream) {
+    StreamEngine *streamEngine = (StreamEngine *)engine;
+    streamEngine->destroyStream((StreamEngine::Stream *)stream);
+}
+
+void SoundTouch_engineSetPitchSemiTones(void *stream, float semiTones) {
+    StreamEngine::Stream *engineStream = (StreamEngine::Stream *)stream;
+    engineStream->postPitchSemiTones(semiTones);
+}
+
+void SoundTouch_engineSubmit(void *engine, void *stream, const void *input, unsigned int numSamples, void *output,
+                             unsigned int maxOutput, SoundTouchBlockCallback callback, void *userData) {
+    StreamEngine *streamEngine = (StreamEngine *)engine;
+    streamEngine->submit((StreamEngine::Stream *)stream, (const SAMPLETYPE *)input, numSamples, (SAMPLETYPE *)output,
+                         maxOutput, (StreamEngine::Callback)callback, userData);
+}
+
+void SoundTouch_engineWait(void *engine, void *stream) {
+    StreamEngine *streamEngine = (StreamEngine *)engine;
+    streamEngine->wait((StreamEngine::Stream *)stream);
+}
+
+void SoundTouch_engineWaitAll(void *engine) {
+    StreamEngine *streamEngine = (StreamEngine *)engine;
+    streamEngine->waitAll();
 }
@@ -5,18 +5,213 @@
 extern "C" {
 #endif
 
+// Heap memory used by an instance, broken down by processing stage, in bytes.
+typedef struct {
+    unsigned int rateTransposer;
+    unsigned int tdStretch;
+    unsigned int instance;
+    unsigned int total;
+} SoundTouchMemoryUsage;
+
+// Storage formats for SoundTouch_setIdleStorage.
+#define SOUNDTOUCH_STORAGE_FLOAT 0
+#define SOUNDTOUCH_STORAGE_INT16 1
+#define SOUNDTOUCH_STORAGE_BF16 2
+
+// Sample formats for the ...Format functions. Integer samples are scaled to the
+// full range of the format and clipped on output. S24 holds 24bit samples in the
+// low bits of 32bit words.
+#define SOUNDTOUCH_FORMAT_S16 0
+#define SOUNDTOUCH_FORMAT_S24 1
+#define SOUNDTOUCH_FORMAT_S32 2
+#define SOUNDTOUCH_FORMAT_F32 3
+
+// Performance profiles for SoundTouch_initWithProfile. Low latency halves the
+// latency of speech, the profile used by SoundTouch_init. Music quality costs about
+// three times the CPU time of speech, and max throughput about a third of it at
+// some loss of sound quality. test/profile_bench prints the figures.
+#define SOUNDTOUCH_PROFILE_LOW_LATENCY 0
+#define SOUNDTOUCH_PROFILE_SPEECH 1
+#define SOUNDTOUCH_PROFILE_MUSIC_QUALITY 2
+#define SOUNDTOUCH_PROFILE_MAX_THROUGHPUT 3
+
+// Processing engines for SoundTouch_initWithEngine. The int16 engine processes
+// 16bit integer samples, so the plain put, receive and process functions of its
+// handles take 'short' samples instead of 'float'; the SOUNDTOUCH_FORMAT_* functions
+// work as with float handles. It is faster with the music quality profile, slower
+// with most others. Handle pools, batches, asynchronous and offline processing
+// use the float engine only.
+#define SOUNDTOUCH_ENGINE_FLOAT 0
+#define SOUNDTOUCH_ENGINE_INT16 1
+
+// Setting IDs for SoundTouch_setSetting and SoundTouch_getSetting, see the
+// corresponding SETTING_* defines in SoundTouch.h.
+#define SOUNDTOUCH_SETTING_USE_AA_FILTER 0
+#define SOUNDTOUCH_SETTING_AA_FILTER_LENGTH 1
+#define SOUNDTOUCH_SETTING_USE_QUICKSEEK 2
+#define SOUNDTOUCH_SETTING_SEQUENCE_MS 3
+#define SOUNDTOUCH_SETTING_SEEKWINDOW_MS 4
+#define SOUNDTOUCH_SETTING_OVERLAP_MS 5
+#define SOUNDTOUCH_SETTING_NOMINAL_INPUT_SEQUENCE 6
+#define SOUNDTOUCH_SETTING_NOMINAL_OUTPUT_SEQUENCE 7
+#define SOUNDTOUCH_SETTING_INITIAL_LATENCY 8
+#define SOUNDTOUCH_SETTING_IDLE_STORAGE 9
+#define SOUNDTOUCH_SETTING_PARALLEL_STAGES 10
+#define SOUNDTOUCH_SETTING_SEPARATE_CHANNELS 11
+#define SOUNDTOUCH_SETTING_PROCESSING_RATE 12
+#define SOUNDTOUCH_SETTING_PROCESSING_BANDWIDTH 13
+#define SOUNDTOUCH_SETTING_INTERPOLATION 14
+
+// Pitch automation breakpoint: pitch in semitones reached 'frameOffset' frames
+// into the next block passed to SoundTouch_putSamples.
+typedef struct {
+    unsigned int frameOffset;
+    float semiTones;
+} SoundTouchPitchPoint;
+
+// Statistics of an asynchronous handle, see SoundTouch_getAsyncStats.
+typedef struct {
+    unsigned int overruns;
+    unsigned int underruns;
+    unsigned int latencyFrames;
+} SoundTouchAsyncStats;
+
 void *SoundTouch_init(void);
+// Returns NULL for an unknown profile
+void *SoundTouch_initWithProfile(int profile);
+// Returns NULL for an unknown profile or engine
+void *SoundTouch_initWithEngine(int profile, int engine);
 void SoundTouch_free(void *stouch);
 
+// Returns 1 if the setting was accepted, 0 otherwise
+int SoundTouch_setSetting(void *stouch, int settingId, int value);
+int SoundTouch_getSetting(void *stouch, int settingId);
+
 void SoundTouch_setSampleRate(void *stouch, unsigned int sampleRate);
+// Converts the output to 'sampleRate' in the same pass as the pitch shift
+// (0 = same rate as the input)
+void SoundTouch_setOutputSampleRate(void *stouch, unsigned int sampleRate);
+// Runs time-stretch at 'sampleRate' for band-limited speech, e.g. 16000 for
+// 48 kHz input (0 = at the input rate). Call after SoundTouch_setSampleRate.
+void SoundTouch_setProcessingRate(void *stouch, unsigned int sampleRate);
 void SoundTouch_setChannels(void *stouch, unsigned int channels);
 void SoundTouch_setPitchSemiTones(void *stouch, float semiTones);
 
+// Thread-safe parameter changes: callable from any thread while another thread
+// is processing, applied at the start of the next SoundTouch_putSamples call.
+void SoundTouch_postRate(void *stouch, float rate);
+void SoundTouch_postTempo(void *stouch, float tempo);
+void SoundTouch_postPitchSemiTones(void *stouch, float semiTones);
+
+// Glides the pitch through the given breakpoints during the next put call.
+// Returns 0 if the breakpoints are out of order or too many.
+int SoundTouch_setPitchAutomation(void *stouch, const SoundTouchPitchPoint *points, unsigned int numPoints);
+
 void SoundTouch_putSamples(void *stouch, void *samples, unsigned int numSamples);
 unsigned int SoundTouch_receiveSamples(void *stouch, void *samples, unsigned int maxSamples);
 
+// Single call per block: feeds 'numSamples' frames and writes up to 'maxOutput'
+// frames to 'output', storing the number written into 'numOutput'. Returns 1 if
+// all the output was returned, 0 if frames were left for the next call. With
+// 'maxOutput' at least SoundTouch_getMaxOutput(numSamples), and no parallel
+// stages, every call returns all the output. 'numSamples' = 0 only drains the
+// output, e.g. after SoundTouch_flush until 'numOutput' is 0.
+int SoundTouch_process(void *stouch, const void *input, unsigned int numSamples, void *output, unsigned int maxOutput,
+                       unsigned int *numOutput);
+unsigned int SoundTouch_getMaxOutput(void *stouch, unsigned int numSamples);
+// Output frames per input frame with the current settings, e.g. for sizing the
+// output of a whole file
+double SoundTouch_getInputOutputSampleRatio(void *stouch);
+
+// Planar variants: 'planes' holds one sample buffer per channel. The layout is
+// converted on the way in and out; processing runs on interleaved frames.
+void SoundTouch_putSamplesPlanar(void *stouch, const void *const *planes, unsigned int numSamples);
+unsigned int SoundTouch_receiveSamplesPlanar(void *stouch, void *const *planes, unsigned int maxSamples);
+
+// Variants taking samples in a SOUNDTOUCH_FORMAT_* format, converted straight
+// into and out of the processing buffers. The put functions return 0 and the
+// receive functions return 0 samples if the format is invalid.
+int SoundTouch_putSamplesFormat(void *stouch, const void *samples, unsigned int numSamples, int format);
+unsigned int SoundTouch_receiveSamplesFormat(void *stouch, void *samples, unsigned int maxSamples, int format);
+int SoundTouch_putSamplesPlanarFormat(void *stouch, const void *const *planes, unsigned int numSamples, int format);
+unsigned int SoundTouch_receiveSamplesPlanarFormat(void *stouch, void *const *planes, unsigned int maxSamples,
+                                                   int format);
+
 void SoundTouch_flush(void *stouch);
 
+// Memory budget in bytes, 0 = unlimited (default).
+void SoundTouch_setMemoryBudget(void *stouch, unsigned int bytes);
+void SoundTouch_getMemoryUsage(void *stouch, SoundTouchMemoryUsage *usage);
+
+// Compact storage of the buffers of an idle stream. SoundTouch_compactIdle returns
+// nonzero if the buffers were compacted; they're restored on next put/receive.
+// SOUNDTOUCH_STORAGE_INT16 clips samples beyond +-1.0, SOUNDTOUCH_STORAGE_BF16 doesn't.
+int SoundTouch_setIdleStorage(void *stouch, int format);
+int SoundTouch_compactIdle(void *stouch);
+
+// Runs the second processing stage on a worker thread (nonzero = enable). The
+// output stays identical; meant for offline processing.
+void SoundTouch_setParallelStages(void *stouch, int enable);
+
+// Batch handle: processes 'numStreams' (at most 16) mono streams sharing the same
+// settings side by side, one stream per channel; 4, 8 or 16 streams give the best
+// throughput. Use the planar functions with one buffer per stream, and the other
+// SoundTouch_* functions as with a handle from SoundTouch_init.
+void *SoundTouch_initBatch(unsigned int sampleRate, unsigned int numStreams);
+
+// Handle pool: hands out ready-built handles with the pool's sample rate and
+// channel count, starting with 'size' idle handles and building more when they
+// run out. An acquired handle is used with the functions above and given back
+// with SoundTouch_poolRelease, which clears it and resets rate, tempo and pitch;
+// never pass it to SoundTouch_free. Acquire and release are thread-safe.
+void *SoundTouch_poolInit(unsigned int sampleRate, unsigned int channels, unsigned int size);
+void SoundTouch_poolFree(void *pool);
+void *SoundTouch_poolAcquire(void *pool);
+void SoundTouch_poolRelease(void *pool, void *stouch);
+
+// Asynchronous handle: processing runs on a worker thread, and put/receive only
+// copy samples into/out of lock-free rings of at least 'ringFrames' frames (at
+// most 2^24), so they're safe to call from a real-time callback. Put returns the number of
+// frames accepted and receive the number of frames returned; shortfalls are
+// counted as overruns and underruns. Use only the *Async functions on this handle.
+void *SoundTouch_initAsync(unsigned int sampleRate, unsigned int channels, unsigned int ringFrames);
+void SoundTouch_freeAsync(void *stouchAsync);
+unsigned int SoundTouch_putSamplesAsync(void *stouchAsync, const void *samples, unsigned int numSamples);
+unsigned int SoundTouch_receiveSamplesAsync(void *stouchAsync, void *samples, unsigned int maxSamples);
+void SoundTouch_postPitchSemiTonesAsync(void *stouchAsync, float semiTones);
+void SoundTouch_flushAsync(void *stouchAsync);
+void SoundTouch_getAsyncStats(void *stouchAsync, SoundTouchAsyncStats *stats);
+
+// Offline handle: processes a whole recording held in memory, split into
+// 'numJobs' chunks processed in parallel and crossfaded together. 'output' must
+// have room for SoundTouch_getOfflineOutputLength(numSamples) frames, which is
+// also the number of frames written.
+void *SoundTouch_initOffline(unsigned int sampleRate, unsigned int channels);
+void SoundTouch_freeOffline(void *stouchOffline);
+void SoundTouch_setPitchSemiTonesOffline(void *stouchOffline, float semiTones);
+void SoundTouch_setOutputSampleRateOffline(void *stouchOffline, unsigned int sampleRate);
+void SoundTouch_setProcessingRateOffline(void *stouchOffline, unsigned int sampleRate);
+unsigned int SoundTouch_getOfflineOutputLength(void *stouchOffline, unsigned int numSamples);
+unsigned int SoundTouch_processOffline(void *stouchOffline, const void *input, unsigned int numSamples, void *output,
+                                       unsigned int numJobs);
+
+// Stream engine: runs many streams on a pool of 'numThreads' worker threads (0 =
+// one per core). Blocks can be submitted to any stream from any thread; the
+// callback is called on a worker thread once the block has been processed, with
+// the number of frames written to 'output'. The buffers must stay valid until
+// then. SoundTouch_engineWait waits for the blocks submitted to a stream so far.
+typedef void (*SoundTouchBlockCallback)(void *userData, unsigned int numOutput);
+
+void *SoundTouch_engineInit(unsigned int numThreads);
+void SoundTouch_engineFree(void *engine);
+void *SoundTouch_engineCreateStream(void *engine, unsigned int sampleRate, unsigned int channels);
+void SoundTouch_engineDestroyStream(void *engine, void *stream);
+void SoundTouch_engineSetPitchSemiTones(void *stream, float semiTones);
+void SoundTouch_engineSubmit(void *engine, void *stream, const void *input, unsigned int numSamples, void *output,
+                             unsigned int maxOutput, SoundTouchBlockCallback callback, void *userData);
+void SoundTouch_engineWait(void *engine, void *stream);
+void SoundTouch_engineWaitAll(void *engine);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Worker thread for running the second processing stage of SoundTouch.
+///
+/// The worker removes samples from the 'input' ring only after it has processed
+/// them and moved the stage output into the 'result' ring. An empty 'input'
+/// ring therefore tells the calling thread that the stage is idle and that all
+/// of its output is waiting in 'result'.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "StageWorker.h"
+
+#include <chrono>
+
+using namespace soundtouch;
+
+/// Wait rounds spent spinning before 'backOff' starts sleeping or 'waitForWork' parks
+#define STAGE_WORKER_SPIN_ROUNDS 64
+
+StageWorker::StageWorker(FIFOSamplePipe *secondStage, uint numChannels)
+    : stage(secondStage),
+      input(STAGE_WORKER_RING_FRAMES, numChannels),
+      result(STAGE_WORKER_RING_FRAMES, numChannels),
+      output(numChannels),
+      running(true),
+      parked(false),
+      stageBytes(secondStage->getBufferMemoryUsage()),
+      shrinkLimit(0),
+      batchLimit(0) {
+    worker = std::thread(&StageWorker::run, this);
+}
+
+StageWorker::~StageWorker() {
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        running.store(false, std::memory_order_relaxed);
+    }
+    wakeUp.notify_one();
+    worker.join();
+}
+
+// Yields or sleeps depending on how long we've been waiting
+void StageWorker::backOff(uint round) {
+    if (round < STAGE_WORKER_SPIN_ROUNDS) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+// Spins for a while, then parks the worker until the ring it waits for changes
+void StageWorker::waitForWork(uint round, bool forResult) {
+    if (round < STAGE_WORKER_SPIN_ROUNDS) {
+        std::this_thread::yield();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(parkMutex);
+    parked.store(true, std::memory_order_relaxed);
+    // pairs with the fence in 'wake': either the caller sees 'parked', or we see its ring update
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wakeUp.wait(lock, [this, forResult] {
+        if (!running.load(std::memory_order_relaxed)) return true;
+        return forResult ? (result.freeFrames() > 0) : (input.numFrames() > 0);
+    });
+    parked.store(false, std::memory_order_relaxed);
+}
+
+// Notifies the worker only if it has parked, so that the processing thread
+// doesn't take the lock in the common case
+void StageWorker::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        wakeUp.notify_one();
+    }
+}
+
+// Hands the first stage's output over to the worker
+void StageWorker::feed(FIFOSamplePipe &firstStage) {
+    uint round = 0;
+
+    while (firstStage.numSamples() > 0) {
+        uint n = input.write(firstStage.ptrBegin(), firstStage.numSamples());
+
+        firstStage.receiveSamples(n);
+        if (n == 0) {
+            // ring full: make room in the result ring so the worker can proceed
+            collect();
+            backOff(round++);
+        } else {
+            wake();
+            round = 0;
+        }
+    }
+}
+
+// Moves processed samples from the result ring to the output buffer
+void StageWorker::collect() {
+    const SAMPLETYPE *samples;
+    uint n;
+    bool collected = false;
+
+    while ((n = result.peek(&samples)) > 0) {
+        output.putSamples(samples, n);
+        result.skip(n);
+        collected = true;
+    }
+    if (collected) wake();
+}
+
+// Waits for the worker to process everything handed over
+void StageWorker::sync() {
+    uint round = 0;
+
+    while (input.numFrames() > 0) {
+        collect();
+        backOff(round++);
+    }
+    collect();
+}
+
+// Returns the memory allocated for the rings and the output buffer
+uint StageWorker::getAllocatedBytes() const {
+    return input.getAllocatedBytes() + result.getAllocatedBytes() + output.getAllocatedBytes();
+}
+
+// Returns the stage memory usage, measured or as published by the worker. The
+// stage belongs to the calling thread while the input ring is empty.
+uint StageWorker::getStageMemoryUsage() const {
+    if (input.numFrames() == 0) return stage->getBufferMemoryUsage();
+    return stageBytes.load(std::memory_order_relaxed);
+}
+
+// Shrinks the stage buffers now, or leaves that to the worker if it's busy. The
+// output buffer is filled by 'collect' on the calling thread.
+void StageWorker::shrinkStage(uint capacityLimit) {
+    output.shrink(capacityLimit);
+    if (input.numFrames() == 0) {
+        stage->shrinkBuffers(capacityLimit);
+    } else {
+        shrinkLimit.store(capacityLimit, std::memory_order_relaxed);
+    }
+}
+
+// Sets the batch size limit for the worker
+void StageWorker::setBatchLimit(uint maxFrames) {
+    batchLimit.store(maxFrames, std::memory_order_relaxed);
+}
+
+// Worker thread main loop: processes the handed over samples and moves the
+// stage output to the result ring
+void StageWorker::run() {
+    uint round = 0;
+
+    while (running.load(std::memory_order_relaxed)) {
+        const SAMPLETYPE *samples;
+        uint n = input.peek(&samples);
+        uint maxFrames = batchLimit.load(std::memory_order_relaxed);
+
+        if ((maxFrames > 0) && (n > maxFrames)) n = maxFrames;
+        if (n == 0) {
+            waitForWork(round++, false);
+            continue;
+        }
+        round = 0;
+
+        stage->putSamples(samples, n);
+        while ((stage->numSamples() > 0) && running.load(std::memory_order_relaxed)) {
+            uint moved = result.write(stage->ptrBegin(), stage->numSamples());
+
+            stage->receiveSamples(moved);
+            if (moved == 0) waitForWork(round++, true);
+        }
+        round = 0;
+
+        // the stage is still owned by the worker until the batch is skipped
+        uint limit = shrinkLimit.exchange(0, std::memory_order_relaxed);
+        if (limit > 0) stage->shrinkBuffers(limit);
+        stageBytes.store(stage->getBufferMemoryUsage(), std::memory_order_relaxed);
+        input.skip(n);
+    }
+}
@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'StageWorker' : Runs the second processing stage of SoundTouch on its own
+/// thread. The first stage's output is handed over through a lock-free ring
+/// instead of a direct 'moveSamples' call, and the stage's output comes back
+/// through another ring, so both stages process concurrently.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StageWorker_H
+#define StageWorker_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "FIFOSampleBuffer.h"
+#include "FIFOSamplePipe.h"
+#include "RingBuffer.h"
+#include "STTypes.h"
+
+namespace soundtouch {
+
+/// Size of the rings between the stages, in sample frames
+#define STAGE_WORKER_RING_FRAMES 16384
+
+class StageWorker {
+   private:
+    /// Stage run by the worker thread. Owned by the worker while 'input' holds samples.
+    FIFOSamplePipe *stage;
+
+    /// Samples from the first stage, waiting for 'stage'
+    RingBuffer input;
+
+    /// Samples processed by 'stage', waiting for 'collect'
+    RingBuffer result;
+
+    /// Processed samples collected from 'result', owned by the calling thread
+    FIFOSampleBuffer output;
+
+    std::thread worker;
+
+    /// Cleared to stop the worker thread
+    std::atomic<bool> running;
+
+    /// Set while the worker is parked, or about to park, on 'wakeUp'
+    std::atomic<bool> parked;
+
+    /// Lets the worker sleep until 'feed', 'collect' or the destructor has something for it
+    std::mutex parkMutex;
+    std::condition_variable wakeUp;
+
+    /// Memory used by 'stage' after the last batch that the worker processed
+    std::atomic<uint> stageBytes;
+
+    /// Capacity limit for the worker to shrink the 'stage' buffers to after its
+    /// current batch, zero if not requested
+    std::atomic<uint> shrinkLimit;
+
+    /// Maximum number of frames the worker passes to 'stage' at once, zero if unlimited
+    std::atomic<uint> batchLimit;
+
+    /// Worker thread main loop
+    void run();
+
+    /// Waits for 'feed' to hand samples over, or for 'collect' to make room in the
+    /// result ring if 'forResult' is set. Spins for the first 'round's and then parks
+    /// the worker until it's woken up, so an idle worker doesn't burn a core.
+    void waitForWork(uint round, bool forResult);
+
+    /// Wakes up the worker if it's parked. Call after changing a ring.
+    void wake();
+
+    /// Waits a while for the worker to make progress. Spins for the first 'round's
+    /// and then starts sleeping.
+    static void backOff(uint round);
+
+   public:
+    /// Starts a worker thread running 'secondStage' for 'numChannels' channels.
+    StageWorker(FIFOSamplePipe *secondStage, uint numChannels);
+
+    /// Stops the worker thread. Samples still in the rings are discarded.
+    ~StageWorker();
+
+    /// Hands all samples from 'firstStage' over to the worker, waiting if the ring
+    /// is full. Call from the processing thread.
+    void feed(FIFOSamplePipe &firstStage);
+
+    /// Moves the samples processed so far to 'getOutput' without waiting.
+    void collect();
+
+    /// Waits until the worker has processed all samples handed over and collects
+    /// them. Afterwards the stage may be accessed until the next 'feed'.
+    void sync();
+
+    /// Changes the stage that the worker runs. Call only after 'sync'.
+    void setStage(FIFOSamplePipe *secondStage) { stage = secondStage; }
+
+    /// Returns the buffer that processed samples are collected into.
+    FIFOSampleBuffer *getOutput() { return &output; }
+
+    /// Returns the number of samples handed over but not processed yet.
+    uint numPending() const { return input.numFrames(); }
+
+    /// Returns the number of bytes allocated for the rings and the output buffer.
+    uint getAllocatedBytes() const;
+
+    /// Returns the memory used by the stage without waiting for the worker: measured
+    /// if the worker is idle, else as of the last batch that it has processed.
+    uint getStageMemoryUsage() const;
+
+    /// Shrinks the stage buffers, see 'FIFOSamplePipe::shrinkBuffers', without
+    /// waiting for the worker: right away if it's idle, else on the worker thread
+    /// after the batch it's processing.
+    void shrinkStage(uint capacityLimit);
+
+    /// Limits the number of frames the worker passes to the stage at once, so that its
+    /// buffers stay within a memory budget (0 = unlimited).
+    void setBatchLimit(uint maxFrames);
+};
+
+}  // namespace soundtouch
+#endif
@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Worker pool for running many SoundTouch streams. A stream with pending
+/// blocks sits in exactly one worker queue at a time ('scheduled' flag), so
+/// its blocks are never processed concurrently. Workers take streams from the
+/// front of their own queue and steal from the back of the others' queues.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "StreamEngine.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "SoundTouch.h"
+
+using namespace soundtouch;
+
+// Changes a setting of the stream's SoundTouch instance
+bool StreamEngine::Stream::setSetting(int settingId, int value) { return soundTouch->setSetting(settingId, value); }
+
+// Posts parameter changes to the stream's SoundTouch instance
+void StreamEngine::Stream::postPitchSemiTones(double newPitch) { soundTouch->postPitchSemiTones(newPitch); }
+
+void StreamEngine::Stream::postTempo(double newTempo) { soundTouch->postTempo(newTempo); }
+
+void StreamEngine::Stream::postRate(double newRate) { soundTouch->postRate(newRate); }
+
+StreamEngine::StreamEngine(uint numThreads) : queued(0), nextWorker(0), running(true) {
+    if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 1;
+
+    for (uint i = 0; i < numThreads; i++) {
+        workers.push_back(new Worker);
+    }
+    for (uint i = 0; i < numThreads; i++) {
+        workers[i]->thread = std::thread(&StreamEngine::run, this, i);
+#if defined(__linux__)
+        // bind each worker to its own core so the streams it runs stay in that
+        // core's cache
+        uint numCores = std::thread::hardware_concurrency();
+        if (numCores > 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % numCores, &cpus);
+            pthread_setaffinity_np(workers[i]->thread.native_handle(), sizeof(cpus), &cpus);
+        }
+#endif
+    }
+}
+
+StreamEngine::~StreamEngine() {
+    waitAll();
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        running = false;
+    }
+    wakeup.notify_all();
+    for (uint i = 0; i < workers.size(); i++) {
+        workers[i]->thread.join();
+        delete workers[i];
+    }
+    for (uint i = 0; i < streams.size(); i++) {
+        delete streams[i]->soundTouch;
+        delete streams[i];
+    }
+}
+
+// Creates a new stream
+StreamEngine::Stream *StreamEngine::createStream(uint sampleRate, uint numChannels) {
+    Stream *stream = new Stream;
+
+    stream->soundTouch = new SoundTouch();
+    stream->soundTouch->setSampleRate(sampleRate);
+    stream->soundTouch->setChannels(numChannels);
+    stream->pending = 0;
+    stream->scheduled = false;
+    stream->homeWorker = -1;
+
+    std::lock_guard<std::mutex> guard(streamLock);
+    streams.push_back(stream);
+    return stream;
+}
+
+// Deletes a stream once its blocks have completed
+void StreamEngine::destroyStream(Stream *stream) {
+    {
+        // wait also for the worker to finish its turn with the stream
+        std::unique_lock<std::mutex> lk(stream->lock);
+        while ((stream->pending > 0) || stream->scheduled) stream->idle.wait(lk);
+    }
+    {
+        std::lock_guard<std::mutex> guard(streamLock);
+        for (uint i = 0; i < streams.size(); i++) {
+            if (streams[i] == stream) {
+                streams.erase(streams.begin() + i);
+                break;
+            }
+        }
+    }
+    delete stream->soundTouch;
+    delete stream;
+}
+
+// Queues a block of samples to the stream, and the stream to a worker unless
+// it's already queued or running
+void StreamEngine::submit(Stream *stream, const SAMPLETYPE *input, uint nSamples, SAMPLETYPE *output, uint maxOutput,
+                          Callback callback, void *userData) {
+    Block block = {input, nSamples, output, maxOutput, callback, userData};
+    bool wasIdle;
+    int home;
+
+    {
+        std::lock_guard<std::mutex> guard(stream->lock);
+        stream->blocks.push_back(block);
+        stream->pending++;
+        wasIdle = !stream->scheduled;
+        stream->scheduled = true;
+        home = stream->homeWorker;
+    }
+    if (wasIdle) schedule(stream, home);
+}
+
+// Waits for the blocks of one stream
+void StreamEngine::wait(Stream *stream) {
+    std::unique_lock<std::mutex> lk(stream->lock);
+    while (stream->pending > 0) stream->idle.wait(lk);
+}
+
+// Waits for the blocks of all streams
+void StreamEngine::waitAll() {
+    std::vector<Stream *> current;
+
+    {
+        std::lock_guard<std::mutex> guard(streamLock);
+        current = streams;
+    }
+    for (uint i = 0; i < current.size(); i++) {
+        wait(current[i]);
+    }
+}
+
+// Queues a runnable stream to its home worker, or to the next worker in turn if
+// it hasn't run yet, and wakes up a sleeping worker
+void StreamEngine::schedule(Stream *stream, int home) {
+    uint index = (home >= 0) ? (uint)home : nextWorker++ % (uint)workers.size();
+    Worker *worker = workers[index];
+
+    {
+        std::lock_guard<std::mutex> guard(worker->lock);
+        worker->queue.push_back(stream);
+    }
+    {
+        // increment under 'sleepLock' so a worker about to sleep can't miss it
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queued++;
+    }
+    wakeup.notify_one();
+}
+
+// Takes a stream from the own queue, or steals one from another worker
+StreamEngine::Stream *StreamEngine::takeStream(uint index) {
+    uint numWorkers = (uint)workers.size();
+
+    for (uint i = 0; i < numWorkers; i++) {
+        Worker *worker = workers[(index + i) % numWorkers];
+        std::lock_guard<std::mutex> guard(worker->lock);
+        Stream *stream;
+
+        if (worker->queue.empty()) continue;
+        if (i == 0) {
+            // own queue: oldest first
+            stream = worker->queue.front();
+            worker->queue.pop_front();
+        } else {
+            // steal the most recently queued, the least likely to be cache-hot
+            // on the victim's core yet
+            stream = worker->queue.back();
+            worker->queue.pop_back();
+        }
+        queued--;
+        return stream;
+    }
+    return NULL;
+}
+
+// Processes blocks of the stream. Processing runs without holding the stream
+// lock, so more blocks can be submitted meanwhile.
+void StreamEngine::runStream(Stream *stream, uint index) {
+    std::unique_lock<std::mutex> lk(stream->lock);
+
+    stream->homeWorker = (int)index;
+    for (uint n = 0;; n++) {
+        Block block;
+        uint numOutput;
+
+        if (stream->blocks.empty()) {
+            stream->scheduled = false;
+            stream->idle.notify_all();
+            return;
+        }
+        if (n == ENGINE_BLOCKS_PER_TURN) {
+            // give the other streams a turn, the stream stays scheduled
+            lk.unlock();
+            schedule(stream, (int)index);
+            return;
+        }
+        block = stream->blocks.front();
+        stream->blocks.pop_front();
+        lk.unlock();
+
+        stream->soundTouch->putSamples(block.input, block.numSamples);
+        numOutput = stream->soundTouch->receiveSamples(block.output, block.maxOutput);
+        if (block.callback) block.callback(block.userData, numOutput);
+
+        lk.lock();
+        stream->pending--;
+    }
+}
+
+// Worker thread main loop
+void StreamEngine::run(uint index) {
+    while (running) {
+        Stream *stream = takeStream(index);
+
+        if (stream) {
+            runStream(stream, index);
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(sleepLock);
+        while (running && (queued == 0)) wakeup.wait(lk);
+    }
+}
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'StreamEngine' : Runs many SoundTouch streams on a pool of worker threads.
+///
+/// Blocks of samples can be submitted to any stream from any thread. The blocks
+/// of one stream are processed in submission order, one at a time, while
+/// different streams run in parallel. A stream with pending blocks is queued to
+/// the worker that ran it last, to keep its state in that core's cache, and
+/// workers running out of streams steal them from the other workers' queues.
+///
+/// SoundTouch WWW: http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef StreamEngine_H
+#define StreamEngine_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "STTypes.h"
+
+namespace soundtouch {
+
+/// Maximum number of blocks of a stream processed in a row before the worker
+/// moves on to other streams
+#define ENGINE_BLOCKS_PER_TURN 4
+
+class StreamEngine {
+   public:
+    /// Called by a worker thread when a block has been processed, with the number
+    /// of samples written to the block's output buffer.
+    typedef void (*Callback)(void *userData, uint numOutput);
+
+   private:
+    /// A submitted block of samples
+    struct Block {
+        const SAMPLETYPE *input;
+        uint numSamples;
+        SAMPLETYPE *output;
+        uint maxOutput;
+        Callback callback;
+        void *userData;
+    };
+
+   public:
+    /// A stream: a SoundTouch instance with its queue of submitted blocks
+    class Stream {
+        friend class StreamEngine;
+
+        class SoundTouch *soundTouch;
+
+        /// Guards the members below
+        std::mutex lock;
+
+        /// Blocks waiting for processing
+        std::deque<Block> blocks;
+
+        /// Blocks submitted but not completed yet
+        uint pending;
+
+        /// Flag: Is the stream queued to or running on a worker?
+        bool scheduled;
+
+        /// Worker that ran the stream last, -1 if none yet
+        int homeWorker;
+
+        /// Signalled when 'pending' drops to zero
+        std::condition_variable idle;
+
+       public:
+        /// Changes a setting, see 'SoundTouch::setSetting'. Call only while the
+        /// stream has no blocks pending.
+        bool setSetting(int settingId, int value);
+
+        /// Thread-safe parameter changes, applied at the stream's next block.
+        void postPitchSemiTones(double newPitch);
+        void postTempo(double newTempo);
+        void postRate(double newRate);
+    };
+
+   private:
+    /// A worker thread with its queue of runnable streams
+    struct Worker {
+        std::thread thread;
+        std::mutex lock;
+        std::deque<Stream *> queue;
+    };
+
+    std::vector<Worker *> workers;
+
+    /// All streams created, guarded by 'streamLock'
+    std::vector<Stream *> streams;
+    std::mutex streamLock;
+
+    /// Number of streams in the worker queues
+    std::atomic<uint> queued;
+
+    /// Round-robin counter for placing streams that have no home worker yet
+    std::atomic<uint> nextWorker;
+
+    /// Cleared to stop the workers
+    std::atomic<bool> running;
+
+    /// Idle workers sleep on 'wakeup'
+    std::mutex sleepLock;
+    std::condition_variable wakeup;
+
+    /// Queues a runnable stream to worker 'home', or to the next worker in turn
+    /// if negative
+    void schedule(Stream *stream, int home);
+
+    /// Takes a stream from the front of worker 'index' own queue, or if that's
+    /// empty, from the back of another worker's queue. NULL if there's none.
+    Stream *takeStream(uint index);
+
+    /// Processes up to ENGINE_BLOCKS_PER_TURN blocks of 'stream' on worker 'index'
+    void runStream(Stream *stream, uint index);
+
+    /// Worker thread main loop
+    void run(uint index);
+
+   public:
+    /// Starts 'numThreads' worker threads, one per core if zero. Each worker is
+    /// bound to a core where the platform supports it.
+    StreamEngine(uint numThreads = 0);
+
+    /// Waits for all submitted blocks, stops the workers and deletes the streams.
+    ~StreamEngine();
+
+    /// Returns the number of worker threads.
+    uint getNumThreads() const { return (uint)workers.size(); }
+
+    /// Creates a stream for given sample rate and channels, with default settings.
+    Stream *createStream(uint sampleRate, uint numChannels);
+
+    /// Waits for the stream's blocks to complete and deletes the stream.
+    void destroyStream(Stream *stream);
+
+    /// Submits a block of samples to 'stream'. Callable from any thread. The
+    /// worker puts the 'numSamples' input samples into the stream, receives up
+    /// to 'maxOutput' samples into 'output' and then calls 'callback', if not
+    /// NULL. The buffers must stay valid until then.
+    void submit(Stream *stream, const SAMPLETYPE *input, uint numSamples, SAMPLETYPE *output, uint maxOutput,
+                Callback callback, void *userData);
+
+    /// Waits until all blocks submitted to 'stream' so far have completed.
+    void wait(Stream *stream);
+
+    /// Waits until all blocks submitted to any stream so far have completed.
+    void waitAll();
+};
+
+}  // namespace soundtouch
+#endif
@@ -78,10 +78,12 @@ const short _scanOffsets[5][24] = {
 
 TDStretch::TDStretch() : FIFOProcessor(&outputBuffer) {
     bQuickSeek = false;
+    bSeparateChannels = false;
     channels = 2;
 
     pMidBuffer = NULL;
     pMidBufferUnaligned = NULL;
+    midBufferBytes = 0;
     overlapLength = 0;
 
     bAutoSeqSetting = true;
@@ -198,6 +200,12 @@ void TDStretch::enableQuickSeek(bool enable) { bQuickSeek = enable; }
 // Returns nonzero if the quick seeking algorithm is enabled.
 bool TDStretch::isQuickSeekEnabled() const { return bQuickSeek; }
 
+// Enables/disables processing the channels as separate streams
+void TDStretch::enableSeparateChannels(bool enable) { bSeparateChannels = enable; }
+
+// Returns nonzero if the channels are processed as separate streams
+bool TDStretch::isSeparateChannelsEnabled() const { return bSeparateChannels; }
+
 // Seeks for the optimal overlap-mixing position.
 int TDStretch::seekBestOverlapPosition(const SAMPLETYPE *refPos) {
     if (bQuickSeek) {
@@ -531,6 +539,126 @@ void TDStretch::processNominalTempo()
 }
 */
 
+// Calculates the cross-correlation of 'mixingPos' and 'compare' separately for
+// each channel, without normalization. The channels are processed in groups of
+// four with a fixed-length inner loop that the compiler can turn into SIMD
+// instructions.
+void TDStretch::calcCrossCorrSeparate(const SAMPLETYPE *mixingPos, const SAMPLETYPE *compare, float *corr) const {
+    int c, i, k;
+
+    for (c = 0; c + 4 <= channels; c += 4) {
+        float sums[4] = {0, 0, 0, 0};
+        const SAMPLETYPE *pMix = mixingPos + c;
+        const SAMPLETYPE *pCmp = compare + c;
+
+        for (i = 0; i < overlapLength; i++) {
+            for (k = 0; k < 4; k++) {
+                sums[k] += (float)pMix[k] * (float)pCmp[k];
+            }
+            pMix += channels;
+            pCmp += channels;
+        }
+        for (k = 0; k < 4; k++) {
+            corr[c + k] = sums[k];
+        }
+    }
+
+    // remaining channels one by one
+    for (; c < channels; c++) {
+        float sum = 0;
+        for (i = 0; i < overlapLength; i++) {
+            sum += (float)mixingPos[channels * i + c] * (float)compare[channels * i + c];
+        }
+        corr[c] = sum;
+    }
+}
+
+// Seeks for the optimal overlap-mixing position separately for each channel, see
+// 'enableSeparateChannels'. Stores the best offset of each channel into 'offsets'.
+//
+// Same full search as 'seekBestOverlapPositionFull' run for all channels at once,
+// so that the correlation routine can process several channels in the same SIMD
+// instruction.
+void TDStretch::seekBestOverlapPositionSeparate(const SAMPLETYPE *refPos, int *offsets) {
+    float corr[SOUNDTOUCH_MAX_CHANNELS];
+    float initialNorm[SOUNDTOUCH_MAX_CHANNELS];
+    double norm[SOUNDTOUCH_MAX_CHANNELS];
+    double bestCorr[SOUNDTOUCH_MAX_CHANNELS];
+    int i, c, s;
+
+#ifdef ST_SIMD_AVOID_UNALIGNED
+    // test every 4th position, the same resolution as the SIMD mono routines use
+    const int step = 4;
+#else
+    const int step = 1;
+#endif
+
+    // correlation and normalizer of the first position
+    calcCrossCorrSeparate(refPos, pMidBuffer, corr);
+    calcCrossCorrSeparate(refPos, refPos, initialNorm);
+
+    for (c = 0; c < channels; c++) {
+        norm[c] = initialNorm[c];
+        bestCorr[c] = (corr[c] / sqrt((norm[c] < 1e-9 ? 1.0 : norm[c])) + 0.1) * 0.75;
+        offsets[c] = 0;
+    }
+
+    for (i = step; i < seekLength; i += step) {
+        const SAMPLETYPE *mixingPos = refPos + channels * i;
+
+        // heuristic rule to slightly favour values close to mid of the range
+        double tmp = (double)(2 * i - seekLength) / (double)seekLength;
+        double weight = 1.0 - 0.25 * tmp * tmp;
+
+        // roll the normalizer window by 'step' samples
+        for (s = 0; s < step; s++) {
+            const SAMPLETYPE *first = mixingPos + channels * (s - step);
+            const SAMPLETYPE *last = mixingPos + channels * (overlapLength - step + s);
+            for (c = 0; c < channels; c++) {
+                norm[c] += (float)last[c] * (float)last[c] - (float)first[c] * (float)first[c];
+            }
+        }
+
+        calcCrossCorrSeparate(mixingPos, pMidBuffer, corr);
+
+        for (c = 0; c < channels; c++) {
+            double value = (corr[c] / sqrt((norm[c] < 1e-9 ? 1.0 : norm[c])) + 0.1) * weight;
+            if (value > bestCorr[c]) {
+                bestCorr[c] = value;
+                offsets[c] = i;
+            }
+        }
+    }
+}
+
+// Overlaps samples in 'midBuffer' with the samples in 'pInput', each channel at
+// its own position given in 'offsets'
+void TDStretch::overlapSeparate(SAMPLETYPE *pOutput, const SAMPLETYPE *pInput, const int *offsets) const {
+    const SAMPLETYPE *pChannel[SOUNDTOUCH_MAX_CHANNELS];
+    const SAMPLETYPE *pMid = pMidBuffer;
+    SAMPLETYPE m1, m2;
+    int i, c;
+
+    for (c = 0; c < channels; c++) {
+        pChannel[c] = pInput + channels * offsets[c] + c;
+    }
+
+    // same weighting as in 'overlapMono'
+    m1 = (SAMPLETYPE)0;
+    m2 = (SAMPLETYPE)overlapLength;
+
+    for (i = 0; i < overlapLength; i++) {
+        for (c = 0; c < channels; c++) {
+            pOutput[c] = (pChannel[c][0] * m1 + pMid[c] * m2) / overlapLength;
+            pChannel[c] += channels;
+        }
+        pOutput += channels;
+        pMid += channels;
+        m1 += 1;
+        m2 -= 1;
+    }
+}
+
 // Processes as many processing frames of the samples 'inputBuffer', store
 // the result into 'outputBuffer'
 void TDStretch::processSamples() {
@@ -548,6 +676,11 @@ void TDStretch::processSamples() {
     }
     */
 
+    if (bSeparateChannels) {
+        processSamplesSeparate();
+        return;
+    }
+
     // Process samples as long as there are enough samples in 'inputBuffer'
     // to form a processing frame.
     while ((int)inputBuffer.numSamples() >= sampleReq) {
@@ -611,6 +744,84 @@ void TDStretch::processSamples() {
     }
 }
 
+// Same as 'processSamples' but with each channel processed as a separate mono
+// stream, see 'enableSeparateChannels'. All channels share the sequence timing,
+// and only the overlap positions differ between channels.
+void TDStretch::processSamplesSeparate() {
+    int offsets[SOUNDTOUCH_MAX_CHANNELS];
+    int ovlSkip;
+    int temp;
+    int i, c;
+
+    while ((int)inputBuffer.numSamples() >= sampleReq) {
+        const SAMPLETYPE *pInput = inputBuffer.ptrBegin();
+        const SAMPLETYPE *pChannel[SOUNDTOUCH_MAX_CHANNELS];
+        SAMPLETYPE *pOutput;
+
+        if (isBeginning == false) {
+            // scan for the best overlapping position of each channel & do overlap-add
+            seekBestOverlapPositionSeparate(pInput, offsets);
+            overlapSeparate(outputBuffer.ptrEnd((uint)overlapLength), pInput, offsets);
+            outputBuffer.putSamples((uint)overlapLength);
+            for (c = 0; c < channels; c++) {
+                offsets[c] += overlapLength;
+            }
+        } else {
+            // at beginning of track skip the initial overlapping, as in 'processSamples'
+            isBeginning = false;
+            int skip = (int)(tempo * overlapLength + 0.5 * seekLength + 0.5);
+
+#ifdef ST_SIMD_AVOID_UNALIGNED
+            // round the skip amount as the mono routines do, so that each channel
+            // keeps the timing of a mono stream
+            skip &= -4;
+#endif
+            skipFract -= skip;
+            if (skipFract <= -nominalSkip) {
+                skipFract = -nominalSkip;
+            }
+            for (c = 0; c < channels; c++) {
+                offsets[c] = 0;
+            }
+        }
+
+        // length of sequence
+        temp = (seekWindowLength - 2 * overlapLength);
+
+        for (c = 0; c < channels; c++) {
+            assert((offsets[c] + temp + overlapLength) <= (int)inputBuffer.numSamples());
+            pChannel[c] = pInput + channels * offsets[c] + c;
+        }
+
+        // copy the sequence of each channel from its own position to output...
+        pOutput = outputBuffer.ptrEnd((uint)temp);
+        for (i = 0; i < temp; i++) {
+            for (c = 0; c < channels; c++) {
+                pOutput[c] = pChannel[c][0];
+                pChannel[c] += channels;
+            }
+            pOutput += channels;
+        }
+        outputBuffer.putSamples((uint)temp);
+
+        // ... and the end of the sequence to 'midBuffer' for the next overlap
+        pOutput = pMidBuffer;
+        for (i = 0; i < overlapLength; i++) {
+            for (c = 0; c < channels; c++) {
+                pOutput[c] = pChannel[c][0];
+                pChannel[c] += channels;
+            }
+            pOutput += channels;
+        }
+
+        // Remove the processed samples from the input buffer
+        skipFract += nominalSkip;
+        ovlSkip = (int)skipFract;
+        skipFract -= ovlSkip;
+        inputBuffer.receiveSamples((uint)ovlSkip);
+    }
+}
+
 // Adds 'numsamples' pcs of samples from the 'samples' memory position into
 // the input of the object.
 void TDStretch::putSamples(const SAMPLETYPE *samples, uint nSamples) {
@@ -620,6 +831,31 @@ void TDStretch::putSamples(const SAMPLETYPE *samples, uint nSamples) {
     processSamples();
 }
 
+// Adds 'numsamples' pcs of samples from the per-channel 'planes' buffers into
+// the input of the object.
+void TDStretch::putSamplesPlanar(const SAMPLETYPE *const *planes, uint nSamples) {
+    // Interleave the samples straight into the input buffer
+    inputBuffer.putSamplesPlanar(planes, nSamples);
+    // Process the samples in input buffer
+    processSamples();
+}
+
+// Adds 'numsamples' pcs of samples in external 'format' into the input of the object.
+void TDStretch::putSamplesFormat(const void *samples, const void *const *planes, int format, uint nSamples) {
+    // Convert the samples straight into the input buffer
+    inputBuffer.putSamplesFormat(samples, planes, format, nSamples);
+    // Process the samples in input buffer
+    processSamples();
+}
+
+// Adds 'nSamples' pcs of silent samples into the input of the object.
+void TDStretch::addSilent(uint nSamples) {
+    // Zero the samples straight in the input buffer
+    inputBuffer.addSilent(nSamples);
+    // Process the samples in input buffer
+    processSamples();
+}
+
 /// Set new overlap length parameter & reallocate RefMidBuffer if necessary.
 void TDStretch::acceptNewOverlapLength(int newOverlapLength) {
     int prevOvl;
@@ -631,14 +867,37 @@ void TDStretch::acceptNewOverlapLength(int newOverlapLength) {
     if (overlapLength > prevOvl) {
         delete[] pMidBufferUnaligned;
 
-        pMidBufferUnaligned = new SAMPLETYPE[overlapLength * channels + 16 / sizeof(SAMPLETYPE)];
-        // ensure that 'pMidBuffer' is aligned to 16 byte boundary for efficiency
-        pMidBuffer = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(pMidBufferUnaligned);
+        // round the size up to whole cache lines so that no other data shares the
+        // last cache line of the buffer
+        uint sizeInBytes = (overlapLength * channels * sizeof(SAMPLETYPE) + SOUNDTOUCH_ALIGNMENT - 1) &
+                           ~(uint)(SOUNDTOUCH_ALIGNMENT - 1);
+        pMidBufferUnaligned = new SAMPLETYPE[(sizeInBytes + SOUNDTOUCH_ALIGNMENT) / sizeof(SAMPLETYPE)];
+        midBufferBytes = sizeInBytes + SOUNDTOUCH_ALIGNMENT;
+        // ensure that 'pMidBuffer' is aligned to cache line boundary for efficiency
+        pMidBuffer = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER(pMidBufferUnaligned);
 
         clearMidBuffer();
     }
 }
 
+/// Return heap memory used by the sample buffers
+uint TDStretch::getBufferMemoryUsage() const {
+    return inputBuffer.getAllocatedBytes() + outputBuffer.getAllocatedBytes() + midBufferBytes;
+}
+
+/// Release excess sample buffer memory. The input buffer keeps room for a full
+/// processing batch in any case.
+void TDStretch::shrinkBuffers(uint capacityLimit) {
+    inputBuffer.shrink(capacityLimit + (uint)sampleReq);
+    outputBuffer.shrink(capacityLimit);
+}
+
+/// Park sample buffers into compact storage
+void TDStretch::parkBuffers(int format) {
+    inputBuffer.park(format);
+    outputBuffer.park(format);
+}
+
 // Operator 'new' is overloaded so that it automatically creates a suitable instance
 // depending on if we've a MMX/SSE/etc-capable CPU available or not.
 void *TDStretch::operator new(size_t s) {
@@ -123,12 +123,14 @@ class TDStretch : public FIFOProcessor {
     double skipFract;
 
     bool bQuickSeek;
+    bool bSeparateChannels;
     bool bAutoSeqSetting;
     bool bAutoSeekSetting;
     bool isBeginning;
 
     SAMPLETYPE *pMidBuffer;
     SAMPLETYPE *pMidBufferUnaligned;
+    uint midBufferBytes;
 
     FIFOSampleBuffer outputBuffer;
     FIFOSampleBuffer inputBuffer;
@@ -141,17 +143,24 @@ class TDStretch : public FIFOProcessor {
     virtual double calcCrossCorr(const SAMPLETYPE *mixingPos, const SAMPLETYPE *compare, double &norm);
     virtual double calcCrossCorrAccumulate(const SAMPLETYPE *mixingPos, const SAMPLETYPE *compare, double &norm);
 
-    virtual int seekBestOverlapPositionFull(const SAMPLETYPE *refPos);
-    virtual int seekBestOverlapPositionQuick(const SAMPLETYPE *refPos);
-    virtual int seekBestOverlapPosition(const SAMPLETYPE *refPos);
+    // The SIMD subclasses override only the correlation kernels and 'overlapStereo',
+    // so the seek loops and the other overlap routines bind statically.
+    int seekBestOverlapPositionFull(const SAMPLETYPE *refPos);
+    int seekBestOverlapPositionQuick(const SAMPLETYPE *refPos);
+    int seekBestOverlapPosition(const SAMPLETYPE *refPos);
 
     virtual void overlapStereo(SAMPLETYPE *output, const SAMPLETYPE *input) const;
-    virtual void overlapMono(SAMPLETYPE *output, const SAMPLETYPE *input) const;
-    virtual void overlapMulti(SAMPLETYPE *output, const SAMPLETYPE *input) const;
+    void overlapMono(SAMPLETYPE *output, const SAMPLETYPE *input) const;
+    void overlapMulti(SAMPLETYPE *output, const SAMPLETYPE *input) const;
 
     void clearMidBuffer();
     void overlap(SAMPLETYPE *output, const SAMPLETYPE *input, uint ovlPos) const;
 
+    virtual void calcCrossCorrSeparate(const SAMPLETYPE *mixingPos, const SAMPLETYPE *compare, float *corr) const;
+    void seekBestOverlapPositionSeparate(const SAMPLETYPE *refPos, int *offsets);
+    void overlapSeparate(SAMPLETYPE *output, const SAMPLETYPE *input, const int *offsets) const;
+    void processSamplesSeparate();
+
     void calcSeqParameters();
     void adaptNormalizer();
 
@@ -175,10 +184,10 @@ class TDStretch : public FIFOProcessor {
     static TDStretch *newInstance();
 
     /// Returns the output buffer object
-    FIFOSamplePipe *getOutput() { return &outputBuffer; };
+    FIFOSampleBuffer *getOutput() { return &outputBuffer; };
 
     /// Returns the input buffer object
-    FIFOSamplePipe *getInput() { return &inputBuffer; };
+    FIFOSampleBuffer *getInput() { return &inputBuffer; };
 
     /// Sets new target tempo. Normal tempo = 'SCALE', smaller values represent slower
     /// tempo, larger faster tempo.
@@ -200,6 +209,16 @@ class TDStretch : public FIFOProcessor {
     /// Returns nonzero if the quick seeking algorithm is enabled.
     bool isQuickSeekEnabled() const;
 
+    /// Enables/disables processing the channels as separate mono streams that share
+    /// the same settings: each channel then seeks its own overlap position, instead
+    /// of one position common to all channels. Used for processing a batch of
+    /// unrelated mono streams side by side, one stream per channel. The quick seek
+    /// algorithm isn't used in this mode.
+    void enableSeparateChannels(bool enable);
+
+    /// Returns nonzero if the channels are processed as separate streams.
+    bool isSeparateChannelsEnabled() const;
+
     /// Sets routine control parameters. These control are certain time constants
     /// defining how the sound is stretched to the desired duration.
     //
@@ -220,12 +239,30 @@ class TDStretch : public FIFOProcessor {
     void getParameters(int *pSampleRate, int *pSequenceMs, int *pSeekWindowMs, int *pOverlapMs) const;
 
     /// Adds 'numsamples' pcs of samples from the 'samples' memory position into
-    /// the input of the object.
+    /// the input of the object. Final, so that calls through a 'TDStretch' pointer
+    /// bind statically.
     virtual void putSamples(const SAMPLETYPE *samples,  ///< Input sample data
                             uint numSamples             ///< Number of samples in 'samples' so that one sample
                                                         ///< contains both channels if stereo
+                            ) final;
+
+    /// Adds 'numsamples' pcs of samples from separate per-channel buffers into
+    /// the input of the object.
+    void putSamplesPlanar(const SAMPLETYPE *const *planes,  ///< One sample buffer per channel
+                          uint numSamples                   ///< Number of samples in each buffer
     );
 
+    /// Adds 'numsamples' pcs of samples in an external sample format into the input
+    /// of the object, see 'FIFOSampleBuffer::putSamplesFormat'.
+    void putSamplesFormat(const void *samples,        ///< Interleaved samples, or NULL
+                          const void *const *planes,  ///< One sample buffer per channel if 'samples' is NULL
+                          int format,                 ///< Sample format, see SampleConvert.h
+                          uint numSamples             ///< Number of samples
+    );
+
+    /// Adds 'numSamples' pcs of silent samples into the input of the object.
+    void addSilent(uint numSamples);
+
     /// return nominal input sample requirement for triggering a processing batch
     int getInputSampleReq() const { return (int)(nominalSkip + 0.5); }
 
@@ -234,13 +271,27 @@ class TDStretch : public FIFOProcessor {
 
     /// return approximate initial input-output latency
     int getLatency() const { return sampleReq; }
+
+    /// Returns the amount of heap memory used by the sample buffers, in bytes.
+    virtual uint getBufferMemoryUsage() const;
+
+    /// Releases sample buffer memory exceeding 'capacityLimit' samples per buffer,
+    /// see 'FIFOSampleBuffer::shrink'.
+    virtual void shrinkBuffers(uint capacityLimit);
+
+    /// Converts the sample buffers into compact storage, see 'FIFOSampleBuffer::park'.
+    void parkBuffers(int format);
+
+   private:
+    // Keeps the per-batch state off the cache line of the next heap object
+    SOUNDTOUCH_CACHE_LINE_PAD;
 };
 
 // Implementation-specific class declarations:
 
 #ifdef SOUNDTOUCH_ALLOW_MMX
 /// Class that implements MMX optimized routines for 16bit integer samples type.
-class TDStretchMMX : public TDStretch {
+class TDStretchMMX final : public TDStretch {
    protected:
     double calcCrossCorr(const short *mixingPos, const short *compare, double &norm);
     double calcCrossCorrAccumulate(const short *mixingPos, const short *compare, double &norm);
@@ -251,10 +302,11 @@ class TDStretchMMX : public TDStretch {
 
 #ifdef SOUNDTOUCH_ALLOW_SSE
 /// Class that implements SSE optimized routines for floating point samples type.
-class TDStretchSSE : public TDStretch {
+class TDStretchSSE final : public TDStretch {
    protected:
     double calcCrossCorr(const float *mixingPos, const float *compare, double &norm);
     double calcCrossCorrAccumulate(const float *mixingPos, const float *compare, double &norm);
+    virtual void calcCrossCorrSeparate(const float *mixingPos, const float *compare, float *corr) const;
 };
 
 #endif  /// SOUNDTOUCH_ALLOW_SSE
@@ -44,6 +44,11 @@
 #define SUPPORT_SSE 0x0008
 #define SUPPORT_SSE2 0x0010
 
+#ifdef __cplusplus
+// C linkage for the SIMD paths of the C sources, e.g. the WAV file conversions
+extern "C" {
+#endif
+
 /// Checks which instruction set extensions are supported by the CPU.
 ///
 /// \return A bitmask of supported extensions, see SUPPORT_... defines.
@@ -52,4 +57,8 @@ uint detectCPUextensions(void);
 /// Disables given set of instruction extensions. See SUPPORT_... defines.
 void disableExtensions(uint wDisableMask);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif  // _CPU_DETECT_H_
@@ -62,20 +62,16 @@ static uint _dwDisabledISA = 0x00;  // 0xffffffff; //<- use this to disable all
 // Disables given set of instruction extensions. See SUPPORT_... defines.
 void disableExtensions(uint dwDisableMask) { _dwDisabledISA = dwDisableMask; }
 
-/// Checks which instruction set extensions are supported by the CPU.
-uint detectCPUextensions(void) {
+/// Queries the instruction set extensions supported by the CPU.
+static uint queryCPUextensions(void) {
 /// If building for a 64bit system (no Itanium) and the user wants optimizations.
 /// Return the OR of SUPPORT_{MMX,SSE,SSE2}. 11001 or 0x19.
-/// Keep the _dwDisabledISA test (2 more operations, could be eliminated).
 #if ((defined(__GNUC__) && defined(__x86_64__)) || defined(_M_X64)) && defined(SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS)
-    return 0x19 & ~_dwDisabledISA;
+    return 0x19;
 
 /// If building for a 32bit system and the user wants optimizations.
-/// Keep the _dwDisabledISA test (2 more operations, could be eliminated).
 #elif ((defined(__GNUC__) && defined(__i386__)) || defined(_M_IX86)) && defined(SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS)
 
-    if (_dwDisabledISA == 0xffffffff) return 0;
-
     uint res = 0;
 
 #if defined(__GNUC__)
@@ -106,7 +102,7 @@ uint detectCPUextensions(void) {
 
 #endif
 
-    return res & ~_dwDisabledISA;
+    return res;
 
 #else
 
@@ -118,3 +114,10 @@ uint detectCPUextensions(void) {
 
 #endif
 }
+
+/// Checks which instruction set extensions are supported by the CPU. The CPU is
+/// queried on the first call only, as every new SoundTouch instance checks this.
+uint detectCPUextensions(void) {
+    static const uint supported = queryCPUextensions();
+    return supported & ~_dwDisabledISA;
+}
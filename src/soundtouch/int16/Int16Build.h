@@ -0,0 +1,21 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Settings for compiling the engine sources a second time into the int16
+/// engine, see 'SoundTouchInt16.h'. Each source file in this directory includes
+/// this file and then one source file of the float engine.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef Int16Build_H
+#define Int16Build_H
+
+// 16bit integer samples, see soundtouch_config.h
+#define SOUNDTOUCH_INTEGER_SAMPLES 1
+
+// keep the classes apart from those of the float build
+#define soundtouch soundtouch_int16
+
+// leave the C functions to the float build
+#define SOUNDTOUCH_INT16_ENGINE 1
+
+#endif  // Int16Build_H
@@ -0,0 +1,3 @@
+// Integer sample build of InterpolateLinear.cpp for the int16 engine
+#include "Int16Build.h"
+#include "../InterpolateLinear.cpp"
@@ -0,0 +1,3 @@
+// Integer sample build of InterpolateShannon.cpp for the int16 engine
+#include "Int16Build.h"
+#include "../InterpolateShannon.cpp"
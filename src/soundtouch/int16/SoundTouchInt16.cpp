@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// 'SoundTouchInt16' : forwards to the SoundTouch instance of the integer sample
+/// build, see 'SoundTouchInt16.h'.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// included before the int16 build settings, so that the class stays in the
+// 'soundtouch' namespace
+#include "../SoundTouchInt16.h"
+
+#include "Int16Build.h"
+
+#include "../SoundTouch.h"
+
+#undef soundtouch
+
+using namespace soundtouch;
+
+SoundTouchInt16::SoundTouchInt16() { instance = new soundtouch_int16::SoundTouch(); }
+
+SoundTouchInt16::~SoundTouchInt16() { delete instance; }
+
+bool SoundTouchInt16::setSetting(int settingId, int value) { return instance->setSetting(settingId, value); }
+
+int SoundTouchInt16::getSetting(int settingId) const { return instance->getSetting(settingId); }
+
+void SoundTouchInt16::setSampleRate(unsigned int srate) { instance->setSampleRate(srate); }
+
+void SoundTouchInt16::setOutputSampleRate(unsigned int srate) { instance->setOutputSampleRate(srate); }
+
+void SoundTouchInt16::setChannels(unsigned int numChannels) { instance->setChannels(numChannels); }
+
+void SoundTouchInt16::setPitchSemiTones(double newPitch) { instance->setPitchSemiTones(newPitch); }
+
+void SoundTouchInt16::postRate(double newRate) { instance->postRate(newRate); }
+
+void SoundTouchInt16::postTempo(double newTempo) { instance->postTempo(newTempo); }
+
+void SoundTouchInt16::postPitchSemiTones(double newPitch) { instance->postPitchSemiTones(newPitch); }
+
+bool SoundTouchInt16::setPitchAutomation(const SoundTouchPitchPoint *points, unsigned int numPoints) {
+    soundtouch_int16::PitchAutomationPoint automation[SOUNDTOUCH_MAX_AUTOMATION_POINTS];
+
+    if (numPoints > SOUNDTOUCH_MAX_AUTOMATION_POINTS) return false;
+    for (unsigned int i = 0; i < numPoints; i++) {
+        automation[i].frameOffset = points[i].frameOffset;
+        automation[i].semiTones = points[i].semiTones;
+    }
+    return instance->setPitchAutomation(automation, numPoints);
+}
+
+void SoundTouchInt16::putSamples(const short *samples, unsigned int numSamples) {
+    instance->putSamples(samples, numSamples);
+}
+
+unsigned int SoundTouchInt16::receiveSamples(short *output, unsigned int maxSamples) {
+    return instance->receiveSamples(output, maxSamples);
+}
+
+void SoundTouchInt16::putSamplesPlanar(const short *const *planes, unsigned int numSamples) {
+    instance->putSamplesPlanar(planes, numSamples);
+}
+
+unsigned int SoundTouchInt16::receiveSamplesPlanar(short *const *planes, unsigned int maxSamples) {
+    return instance->receiveSamplesPlanar(planes, maxSamples);
+}
+
+void SoundTouchInt16::putSamplesFormat(const void *samples, const void *const *planes, int format,
+                                       unsigned int numSamples) {
+    instance->putSamplesFormat(samples, planes, format, numSamples);
+}
+
+unsigned int SoundTouchInt16::receiveSamplesFormat(void *samples, void *const *planes, int format,
+                                                   unsigned int maxSamples) {
+    return instance->receiveSamplesFormat(samples, planes, format, maxSamples);
+}
+
+unsigned int SoundTouchInt16::process(const short *input, unsigned int numSamples, short *output,
+                                      unsigned int maxSamples) {
+    return instance->process(input, numSamples, output, maxSamples);
+}
+
+unsigned int SoundTouchInt16::getMaxOutput(unsigned int numSamples) const { return instance->getMaxOutput(numSamples); }
+
+double SoundTouchInt16::getInputOutputSampleRatio() { return instance->getInputOutputSampleRatio(); }
+
+unsigned int SoundTouchInt16::numSamples() const { return instance->numSamples(); }
+
+void SoundTouchInt16::flush() { instance->flush(); }
+
+void SoundTouchInt16::setMemoryBudget(unsigned int bytes) { instance->setMemoryBudget(bytes); }
+
+void SoundTouchInt16::getMemoryUsage(SoundTouchMemoryUsage *usage) const {
+    soundtouch_int16::MemoryUsage mem = instance->getMemoryUsage();
+
+    usage->rateTransposer = mem.rateTransposer;
+    usage->tdStretch = mem.tdStretch;
+    usage->instance = mem.instance;
+    usage->total = mem.total;
+}
+
+bool SoundTouchInt16::compactIdle() { return instance->compactIdle(); }
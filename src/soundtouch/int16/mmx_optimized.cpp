@@ -0,0 +1,3 @@
+// Integer sample build of mmx_optimized.cpp for the int16 engine
+#include "Int16Build.h"
+#include "../mmx_optimized.cpp"
@@ -46,8 +46,6 @@
 #ifdef SOUNDTOUCH_ALLOW_MMX
 // MMX routines available only with integer sample type
 
-using namespace soundtouch;
-
 //////////////////////////////////////////////////////////////////////////////
 //
 // implementation of MMX optimized functions of class 'TDStretchMMX'
@@ -60,6 +58,8 @@ using namespace soundtouch;
 
 #include "TDStretch.h"
 
+using namespace soundtouch;
+
 // Calculates cross correlation of two buffers
 double TDStretchMMX::calcCrossCorr(const short *pV1, const short *pV2, double &dnorm) {
     const __m64 *pVec1, *pVec2;
@@ -278,6 +278,8 @@ void TDStretchMMX::overlapStereo(short *output, const short *input) const {
 FIRFilterMMX::FIRFilterMMX() : FIRFilter() {
     filterCoeffsAlign = NULL;
     filterCoeffsUnalign = NULL;
+    // the stereo routine uses own coefficient layout
+    bUseStereoCoeffs = false;
 }
 
 FIRFilterMMX::~FIRFilterMMX() { delete[] filterCoeffsUnalign; }
@@ -285,12 +287,16 @@ FIRFilterMMX::~FIRFilterMMX() { delete[] filterCoeffsUnalign; }
 // (overloaded) Calculates filter coefficients for MMX routine
 void FIRFilterMMX::setCoefficients(const short *coeffs, uint newLength, uint uResultDivFactor) {
     uint i;
+    uint oldLength = length;
+
     FIRFilter::setCoefficients(coeffs, newLength, uResultDivFactor);
 
-    // Ensure that filter coeffs array is aligned to 16-byte boundary
-    delete[] filterCoeffsUnalign;
-    filterCoeffsUnalign = new short[2 * newLength + 8];
-    filterCoeffsAlign = (short *)SOUNDTOUCH_ALIGN_POINTER_16(filterCoeffsUnalign);
+    // Ensure that filter coeffs array is aligned to SOUNDTOUCH_ALIGNMENT boundary
+    if ((newLength != oldLength) || (filterCoeffsUnalign == NULL)) {
+        delete[] filterCoeffsUnalign;
+        filterCoeffsUnalign = new short[2 * newLength + SOUNDTOUCH_ALIGNMENT / sizeof(short)];
+        filterCoeffsAlign = (short *)SOUNDTOUCH_ALIGN_POINTER(filterCoeffsUnalign);
+    }
 
     // rearrange the filter coefficients for mmx routines
     for (i = 0; i < length; i += 4) {
@@ -306,6 +312,14 @@ void FIRFilterMMX::setCoefficients(const short *coeffs, uint newLength, uint uRe
     }
 }
 
+// Returns the amount of heap memory allocated for the filter coefficients
+uint FIRFilterMMX::getAllocatedBytes() const {
+    uint bytes = FIRFilter::getAllocatedBytes();
+
+    if (filterCoeffsUnalign) bytes += 2 * length * sizeof(short) + SOUNDTOUCH_ALIGNMENT;
+    return bytes;
+}
+
 // mmx-optimized version of the filter routine for stereo sound
 uint FIRFilterMMX::evaluateFilterStereo(short *dest, const short *src, uint numSamples) const {
     // Create stack copies of the needed member variables for asm routines :
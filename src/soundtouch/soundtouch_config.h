@@ -1,5 +1,5 @@
-/* Use Float as Sample type */
+/* Use Float as Sample type, unless integer samples are selected before including
+   this file, as the int16 engine build in the int16 directory does */
+#ifndef SOUNDTOUCH_INTEGER_SAMPLES
 #define SOUNDTOUCH_FLOAT_SAMPLES 1
-
-/* Use Integer as Sample type */
-#undef SOUNDTOUCH_INTEGER_SAMPLES
\ No newline at end of file
+#endif
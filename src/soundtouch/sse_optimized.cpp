@@ -181,6 +181,63 @@ double TDStretchSSE::calcCrossCorrAccumulate(const float *pV1, const float *pV2,
     return calcCrossCorr(pV1, pV2, norm);
 }
 
+// Calculates cross correlation separately for each channel, four channels per
+// SSE register. Even and odd samples are summed into separate accumulators to
+// shorten the dependency chains; the result of a channel doesn't depend on the
+// number of channels.
+void TDStretchSSE::calcCrossCorrSeparate(const float *pV1, const float *pV2, float *corr) const {
+    int c, i;
+
+    // ensure overlapLength is divisible by 8
+    assert((overlapLength % 8) == 0);
+
+    // eight channels at a time, so that each pass reads whole cache lines
+    for (c = 0; c + 8 <= channels; c += 8) {
+        const float *pVec1 = pV1 + c;
+        const float *pVec2 = pV2 + c;
+        __m128 vSum1, vSum2, vSum3, vSum4;
+
+        vSum1 = vSum2 = vSum3 = vSum4 = _mm_setzero_ps();
+        for (i = 0; i < overlapLength; i += 2) {
+            vSum1 = _mm_add_ps(vSum1, _mm_mul_ps(_mm_loadu_ps(pVec1), _mm_loadu_ps(pVec2)));
+            vSum2 = _mm_add_ps(vSum2, _mm_mul_ps(_mm_loadu_ps(pVec1 + channels), _mm_loadu_ps(pVec2 + channels)));
+            vSum3 = _mm_add_ps(vSum3, _mm_mul_ps(_mm_loadu_ps(pVec1 + 4), _mm_loadu_ps(pVec2 + 4)));
+            vSum4 = _mm_add_ps(vSum4,
+                               _mm_mul_ps(_mm_loadu_ps(pVec1 + channels + 4), _mm_loadu_ps(pVec2 + channels + 4)));
+            pVec1 += 2 * channels;
+            pVec2 += 2 * channels;
+        }
+        _mm_storeu_ps(corr + c, _mm_add_ps(vSum1, vSum2));
+        _mm_storeu_ps(corr + c + 4, _mm_add_ps(vSum3, vSum4));
+    }
+
+    for (; c + 4 <= channels; c += 4) {
+        const float *pVec1 = pV1 + c;
+        const float *pVec2 = pV2 + c;
+        __m128 vSum1, vSum2;
+
+        vSum1 = vSum2 = _mm_setzero_ps();
+        for (i = 0; i < overlapLength; i += 2) {
+            vSum1 = _mm_add_ps(vSum1, _mm_mul_ps(_mm_loadu_ps(pVec1), _mm_loadu_ps(pVec2)));
+            vSum2 = _mm_add_ps(vSum2, _mm_mul_ps(_mm_loadu_ps(pVec1 + channels), _mm_loadu_ps(pVec2 + channels)));
+            pVec1 += 2 * channels;
+            pVec2 += 2 * channels;
+        }
+        _mm_storeu_ps(corr + c, _mm_add_ps(vSum1, vSum2));
+    }
+
+    // remaining channels one by one
+    for (; c < channels; c++) {
+        float sum1 = 0;
+        float sum2 = 0;
+        for (i = 0; i < overlapLength; i += 2) {
+            sum1 += pV1[channels * i + c] * pV2[channels * i + c];
+            sum2 += pV1[channels * (i + 1) + c] * pV2[channels * (i + 1) + c];
+        }
+        corr[c] = sum1 + sum2;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // implementation of SSE optimized functions of class 'FIRFilter'
@@ -192,6 +249,8 @@ double TDStretchSSE::calcCrossCorrAccumulate(const float *pV1, const float *pV2,
 FIRFilterSSE::FIRFilterSSE() : FIRFilter() {
     filterCoeffsAlign = NULL;
     filterCoeffsUnalign = NULL;
+    // the stereo routine uses own coefficient layout
+    bUseStereoCoeffs = false;
 }
 
 FIRFilterSSE::~FIRFilterSSE() {
@@ -204,15 +263,18 @@ FIRFilterSSE::~FIRFilterSSE() {
 void FIRFilterSSE::setCoefficients(const float *coeffs, uint newLength, uint uResultDivFactor) {
     uint i;
     float fDivider;
+    uint oldLength = length;
 
     FIRFilter::setCoefficients(coeffs, newLength, uResultDivFactor);
 
     // Scale the filter coefficients so that it won't be necessary to scale the filtering result
     // also rearrange coefficients suitably for SSE
-    // Ensure that filter coeffs array is aligned to 16-byte boundary
-    delete[] filterCoeffsUnalign;
-    filterCoeffsUnalign = new float[2 * newLength + 4];
-    filterCoeffsAlign = (float *)SOUNDTOUCH_ALIGN_POINTER_16(filterCoeffsUnalign);
+    // Ensure that filter coeffs array is aligned to SOUNDTOUCH_ALIGNMENT boundary
+    if ((newLength != oldLength) || (filterCoeffsUnalign == NULL)) {
+        delete[] filterCoeffsUnalign;
+        filterCoeffsUnalign = new float[2 * newLength + SOUNDTOUCH_ALIGNMENT / sizeof(float)];
+        filterCoeffsAlign = (float *)SOUNDTOUCH_ALIGN_POINTER(filterCoeffsUnalign);
+    }
 
     fDivider = (float)resultDivider;
 
@@ -222,6 +284,113 @@ void FIRFilterSSE::setCoefficients(const float *coeffs, uint newLength, uint uRe
     }
 }
 
+// Returns the amount of heap memory allocated for the filter coefficients
+uint FIRFilterSSE::getAllocatedBytes() const {
+    uint bytes = FIRFilter::getAllocatedBytes();
+
+    if (filterCoeffsUnalign) bytes += 2 * length * sizeof(float) + SOUNDTOUCH_ALIGNMENT;
+    return bytes;
+}
+
+// SSE-optimized version of the filter routine for multichannel sound, evaluates
+// four channels per SSE register. Even and odd taps are summed into separate
+// accumulators, same for every channel count. Falls back to the C routine unless
+// the number of channels is divisible by four.
+uint FIRFilterSSE::evaluateFilterMulti(float *dest, const float *source, uint numSamples, uint numChannels) {
+    int count;
+    int j;
+
+    if (numChannels % 4) return FIRFilter::evaluateFilterMulti(dest, source, numSamples, numChannels);
+
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert((length % 8) == 0);
+    assert(filterCoeffs != NULL);
+
+    count = (int)(numSamples - length);
+    if (count < 1) return 0;
+
+#pragma omp parallel for
+    for (j = 0; j < count; j++) {
+        uint c = 0;
+
+        // eight channels at a time, so that each pass reads whole cache lines
+        for (; c + 8 <= numChannels; c += 8) {
+            const float *pSrc = source + j * numChannels + c;
+            const float *pFil = filterCoeffs;
+            __m128 sum1, sum2, sum3, sum4;
+            uint i;
+
+            sum1 = sum2 = sum3 = sum4 = _mm_setzero_ps();
+            for (i = 0; i < length; i += 2) {
+                __m128 coef1 = _mm_load1_ps(pFil);
+                __m128 coef2 = _mm_load1_ps(pFil + 1);
+                sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc), coef1));
+                sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + numChannels), coef2));
+                sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(pSrc + 4), coef1));
+                sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(pSrc + numChannels + 4), coef2));
+                pSrc += 2 * numChannels;
+                pFil += 2;
+            }
+            _mm_storeu_ps(dest + j * numChannels + c, _mm_add_ps(sum1, sum2));
+            _mm_storeu_ps(dest + j * numChannels + c + 4, _mm_add_ps(sum3, sum4));
+        }
+
+        for (; c < numChannels; c += 4) {
+            const float *pSrc = source + j * numChannels + c;
+            const float *pFil = filterCoeffs;
+            __m128 sum1, sum2;
+            uint i;
+
+            sum1 = sum2 = _mm_setzero_ps();
+            for (i = 0; i < length; i += 2) {
+                sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc), _mm_load1_ps(pFil)));
+                sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + numChannels), _mm_load1_ps(pFil + 1)));
+                pSrc += 2 * numChannels;
+                pFil += 2;
+            }
+            _mm_storeu_ps(dest + j * numChannels + c, _mm_add_ps(sum1, sum2));
+        }
+    }
+
+    return (uint)count;
+}
+
+// SSE-optimized version of the filter routine for mono sound: evaluates the filter
+// for four consecutive samples at a time, in the same way as 'evaluateFilterMulti'
+// does for four channels.
+uint FIRFilterSSE::evaluateFilterMono(float *dest, const float *source, uint numSamples) const {
+    int count;
+    int j;
+
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert((length % 8) == 0);
+    assert(filterCoeffs != NULL);
+
+    if (numSamples < length + 4) return 0;
+    count = (int)((numSamples - length) & (uint)-4);
+
+#pragma omp parallel for
+    for (j = 0; j < count; j += 4) {
+        const float *pSrc = source + j;
+        const float *pFil = filterCoeffs;
+        __m128 sum1, sum2;
+        uint i;
+
+        sum1 = sum2 = _mm_setzero_ps();
+        for (i = 0; i < length; i += 2) {
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSrc), _mm_load1_ps(pFil)));
+            sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(pSrc + 1), _mm_load1_ps(pFil + 1)));
+            pSrc += 2;
+            pFil += 2;
+        }
+        _mm_storeu_ps(dest + j, _mm_add_ps(sum1, sum2));
+    }
+
+    return (uint)count;
+}
+
 // SSE-optimized version of the filter routine for stereo sound
 uint FIRFilterSSE::evaluateFilterStereo(float *dest, const float *source, uint numSamples) const {
     int count = (int)((numSamples - length) & (uint)-2);
@@ -235,7 +404,7 @@ uint FIRFilterSSE::evaluateFilterStereo(float *dest, const float *source, uint n
     assert(dest != NULL);
     assert((length % 8) == 0);
     assert(filterCoeffsAlign != NULL);
-    assert(((ulongptr)filterCoeffsAlign) % 16 == 0);
+    assert(((ulongptr)filterCoeffsAlign) % SOUNDTOUCH_ALIGNMENT == 0);
 
 // filter is evaluated for two stereo samples with each iteration, thus use of 'j += 2'
 #pragma omp parallel for
@@ -345,4 +514,246 @@ uint FIRFilterSSE::evaluateFilterStereo(float *dest, const float *source, uint n
     */
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of SSE2 optimized functions of class 'SampleConvert'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <emmintrin.h>
+
+#include "SampleConvert.h"
+
+// Loads four samples of 'format' from 'src' and converts them to float
+static inline __m128 loadSamples4(const void *src, int format) {
+    __m128i v;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16:
+            // widen to 32 bits with the sample in the high half, then sign-extend
+            v = _mm_loadl_epi64((const __m128i *)src);
+            v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 32768.0f));
+
+        case SAMPLE_FORMAT_S24:
+            // move to the top of the word, which also sign-extends
+            v = _mm_slli_epi32(_mm_loadu_si128((const __m128i *)src), 8);
+            return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 2147483648.0f));
+
+        case SAMPLE_FORMAT_S32:
+            v = _mm_loadu_si128((const __m128i *)src);
+            return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 2147483648.0f));
+
+        default:
+            return _mm_loadu_ps((const float *)src);
+    }
+}
+
+// Clips four float samples to the range of 'format', converts and stores them to
+// 'dest'. The clipping is done before the conversion, as out-of-range values
+// would otherwise convert to the most negative integer.
+static inline void storeSamples4(void *dest, __m128 value, int format) {
+    __m128i v;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16:
+            value = _mm_mul_ps(value, _mm_set1_ps(32768.0f));
+            value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+            v = _mm_cvtps_epi32(value);
+            _mm_storel_epi64((__m128i *)dest, _mm_packs_epi32(v, v));
+            break;
+
+        case SAMPLE_FORMAT_S24:
+            value = _mm_mul_ps(value, _mm_set1_ps(8388608.0f));
+            value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-8388608.0f)), _mm_set1_ps(8388607.0f));
+            _mm_storeu_si128((__m128i *)dest, _mm_cvtps_epi32(value));
+            break;
+
+        case SAMPLE_FORMAT_S32:
+            // 2147483520 is the largest float below 2^31
+            value = _mm_mul_ps(value, _mm_set1_ps(2147483648.0f));
+            value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-2147483648.0f)), _mm_set1_ps(2147483520.0f));
+            _mm_storeu_si128((__m128i *)dest, _mm_cvtps_epi32(value));
+            break;
+
+        default:
+            _mm_storeu_ps((float *)dest, value);
+            break;
+    }
+}
+
+// The conversion loops below are inlined into a 'switch' over the formats, so that
+// each format gets a loop of its own without per-sample format checks.
+
+static inline void loadLoop(float *dest, const char *src, uint bytes, uint count, int format) {
+    uint i = 0;
+
+    // eight samples per round, as 16bit samples fill a register with eight
+    for (; i + 8 <= count; i += 8) {
+        __m128 v1 = loadSamples4(src + i * bytes, format);
+        __m128 v2 = loadSamples4(src + (i + 4) * bytes, format);
+
+        _mm_storeu_ps(dest + i, v1);
+        _mm_storeu_ps(dest + i + 4, v2);
+    }
+    if (i < count) _mm_storeu_ps(dest + i, loadSamples4(src + i * bytes, format));
+}
+
+static inline void storeLoop(char *dest, const float *src, uint bytes, uint count, int format) {
+    for (uint i = 0; i < count; i += 4) {
+        storeSamples4(dest + i * bytes, _mm_loadu_ps(src + i), format);
+    }
+}
+
+// Converts four samples of both channels and interleaves them with unpack
+static inline void loadStereoLoop(float *dest, const char *left, const char *right, uint bytes, uint count,
+                                  int format) {
+    for (uint i = 0; i < count; i += 4) {
+        __m128 vl = loadSamples4(left + i * bytes, format);
+        __m128 vr = loadSamples4(right + i * bytes, format);
+
+        _mm_storeu_ps(dest + 2 * i, _mm_unpacklo_ps(vl, vr));
+        _mm_storeu_ps(dest + 2 * i + 4, _mm_unpackhi_ps(vl, vr));
+    }
+}
+
+// Splits four interleaved stereo samples into the channels with shuffles
+static inline void storeStereoLoop(char *left, char *right, const float *src, uint bytes, uint count, int format) {
+    for (uint i = 0; i < count; i += 4) {
+        __m128 v1 = _mm_loadu_ps(src + 2 * i);
+        __m128 v2 = _mm_loadu_ps(src + 2 * i + 4);
+
+        storeSamples4(left + i * bytes, _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 0, 2, 0)), format);
+        storeSamples4(right + i * bytes, _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(3, 1, 3, 1)), format);
+    }
+}
+
+uint SampleConvert::toSamplesSSE2(float *dest, const void *src, int format, uint numValues) {
+    const char *pSrc = (const char *)src;
+    uint count = numValues & ~3u;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16:
+            loadLoop(dest, pSrc, 2, count, SAMPLE_FORMAT_S16);
+            break;
+        case SAMPLE_FORMAT_S24:
+            loadLoop(dest, pSrc, 4, count, SAMPLE_FORMAT_S24);
+            break;
+        case SAMPLE_FORMAT_S32:
+            loadLoop(dest, pSrc, 4, count, SAMPLE_FORMAT_S32);
+            break;
+        default:
+            loadLoop(dest, pSrc, 4, count, SAMPLE_FORMAT_F32);
+            break;
+    }
+    return count;
+}
+
+uint SampleConvert::fromSamplesSSE2(void *dest, const float *src, int format, uint numValues) {
+    char *pDest = (char *)dest;
+    uint count = numValues & ~3u;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16:
+            storeLoop(pDest, src, 2, count, SAMPLE_FORMAT_S16);
+            break;
+        case SAMPLE_FORMAT_S24:
+            storeLoop(pDest, src, 4, count, SAMPLE_FORMAT_S24);
+            break;
+        case SAMPLE_FORMAT_S32:
+            storeLoop(pDest, src, 4, count, SAMPLE_FORMAT_S32);
+            break;
+        default:
+            storeLoop(pDest, src, 4, count, SAMPLE_FORMAT_F32);
+            break;
+    }
+    return count;
+}
+
+uint SampleConvert::toSamplesStereoSSE2(float *dest, const void *left, const void *right, int format,
+                                        uint numSamples) {
+    const char *pLeft = (const char *)left;
+    const char *pRight = (const char *)right;
+    uint count = numSamples & ~3u;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16:
+            loadStereoLoop(dest, pLeft, pRight, 2, count, SAMPLE_FORMAT_S16);
+            break;
+        case SAMPLE_FORMAT_S24:
+            loadStereoLoop(dest, pLeft, pRight, 4, count, SAMPLE_FORMAT_S24);
+            break;
+        case SAMPLE_FORMAT_S32:
+            loadStereoLoop(dest, pLeft, pRight, 4, count, SAMPLE_FORMAT_S32);
+            break;
+        default:
+            loadStereoLoop(dest, pLeft, pRight, 4, count, SAMPLE_FORMAT_F32);
+            break;
+    }
+    return count;
+}
+
+uint SampleConvert::fromSamplesStereoSSE2(void *left, void *right, const float *src, int format, uint numSamples) {
+    char *pLeft = (char *)left;
+    char *pRight = (char *)right;
+    uint count = numSamples & ~3u;
+
+    switch (format) {
+        case SAMPLE_FORMAT_S16:
+            storeStereoLoop(pLeft, pRight, src, 2, count, SAMPLE_FORMAT_S16);
+            break;
+        case SAMPLE_FORMAT_S24:
+            storeStereoLoop(pLeft, pRight, src, 4, count, SAMPLE_FORMAT_S24);
+            break;
+        case SAMPLE_FORMAT_S32:
+            storeStereoLoop(pLeft, pRight, src, 4, count, SAMPLE_FORMAT_S32);
+            break;
+        default:
+            storeStereoLoop(pLeft, pRight, src, 4, count, SAMPLE_FORMAT_F32);
+            break;
+    }
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of SSE2 optimized functions of class 'FIFOSampleBuffer'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "FIFOSampleBuffer.h"
+
+// float to bfloat16, i.e. upper 16 bits of the float with round-to-nearest-even
+uint FIFOSampleBuffer::floatToBf16SSE2(short *dest, const float *src, uint count) {
+    const __m128i bias = _mm_set1_epi32(0x7fff);
+    const __m128i one = _mm_set1_epi32(1);
+    uint i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_castps_si128(_mm_loadu_ps(src + i));
+        __m128i hi = _mm_castps_si128(_mm_loadu_ps(src + i + 4));
+        lo = _mm_add_epi32(lo, _mm_add_epi32(bias, _mm_and_si128(_mm_srli_epi32(lo, 16), one)));
+        hi = _mm_add_epi32(hi, _mm_add_epi32(bias, _mm_and_si128(_mm_srli_epi32(hi, 16), one)));
+        // arithmetic shift keeps the upper halves within int16 range, so that
+        // the saturating pack copies them as such
+        lo = _mm_srai_epi32(lo, 16);
+        hi = _mm_srai_epi32(hi, 16);
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_packs_epi32(lo, hi));
+    }
+    return i;
+}
+
+// bfloat16 to float by placing the values to the upper halves of the words
+uint FIFOSampleBuffer::bf16ToFloatSSE2(float *dest, const short *src, uint count) {
+    const __m128i zero = _mm_setzero_si128();
+    uint i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_ps(dest + i, _mm_castsi128_ps(_mm_unpacklo_epi16(zero, v)));
+        _mm_storeu_ps(dest + i + 4, _mm_castsi128_ps(_mm_unpackhi_epi16(zero, v)));
+    }
+    return i;
+}
+
 #endif  // SOUNDTOUCH_ALLOW_SSE
@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Asynchronous handle flush test: puts an utterance, flushes and puts the next
+/// utterance right away, and checks that the flush takes effect where it was
+/// requested. The first utterance must come out whole while the tail of the
+/// second one stays in the pipeline until the next flush.
+///
+/// Usage: async_test
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "STTypes.h"
+#include "SoundTouch_Wrapper.h"
+
+#define SAMPLE_RATE 16000
+#define UTTERANCE (SAMPLE_RATE / 2)
+#define RING_FRAMES SAMPLE_RATE
+
+// Receives output until none has arrived for 200 ms, returns the number received
+static uint receiveAll(void *st, SAMPLETYPE *output) {
+    uint total = 0;
+    int idle = 0;
+
+    while (idle < 20) {
+        uint n = SoundTouch_receiveSamplesAsync(st, output, RING_FRAMES);
+        total += n;
+        if (n == 0) {
+            usleep(10000);
+            idle++;
+        } else {
+            idle = 0;
+        }
+    }
+    return total;
+}
+
+int main(void) {
+    SAMPLETYPE *input = (SAMPLETYPE *)malloc(2 * UTTERANCE * sizeof(SAMPLETYPE));
+    SAMPLETYPE *output = (SAMPLETYPE *)malloc(RING_FRAMES * sizeof(SAMPLETYPE));
+    void *st = SoundTouch_initAsync(SAMPLE_RATE, 1, RING_FRAMES);
+    uint first, second;
+    int i, failed;
+
+    for (i = 0; i < 2 * UTTERANCE; i++) {
+        input[i] = (SAMPLETYPE)(0.5 * sin(i * 0.05));
+    }
+    SoundTouch_postPitchSemiTonesAsync(st, 5.0f);
+
+    // no waiting between the calls, so the worker sees both utterances at once
+    SoundTouch_putSamplesAsync(st, input, UTTERANCE);
+    SoundTouch_flushAsync(st);
+    SoundTouch_putSamplesAsync(st, input + UTTERANCE, UTTERANCE);
+    first = receiveAll(st, output);
+
+    SoundTouch_flushAsync(st);
+    second = receiveAll(st, output);
+    SoundTouch_freeAsync(st);
+    free(input);
+    free(output);
+
+    // before the second flush, the first utterance is out and the second one isn't
+    failed = (first < UTTERANCE) || (first >= 2 * UTTERANCE) || (first + second != 2 * UTTERANCE);
+    printf("%u samples out after put/flush/put, %u after the second flush, of %d + %d in%s\n", first, second,
+           UTTERANCE, UTTERANCE, failed ? " FAILED" : "");
+    return failed;
+}
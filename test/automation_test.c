@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Pitch automation timing test: processes a tone with a silent gap in it once at
+/// a constant pitch and once gliding to the same pitch, and checks that the gap
+/// comes out at the same position. A glide changes the pitch only, so it mustn't
+/// shift the timeline of the output.
+///
+/// Usage: automation_test
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "STTypes.h"
+#include "SoundTouch_Wrapper.h"
+
+#define SAMPLE_RATE 48000
+#define INPUT_SAMPLES (5 * SAMPLE_RATE)
+#define GAP_START 144000
+#define GAP_LENGTH 4800
+#define BLOCK 4800
+
+// Gap positions may differ by the overlap-add granularity, 20 ms
+#define TOLERANCE (SAMPLE_RATE / 50)
+
+// Processes the input at 'semiTones', gliding to it from the original pitch during
+// the first second if 'glide' is set. Returns the position of the gap in the output,
+// or -1 if not found.
+static long findGap(const SAMPLETYPE *input, float semiTones, int glide) {
+    void *st = SoundTouch_init();
+    SAMPLETYPE output[4 * BLOCK];
+    long pos = 0, silentRun = 0, gap = -1;
+    int i;
+    uint n;
+
+    SoundTouch_setSampleRate(st, SAMPLE_RATE);
+    SoundTouch_setChannels(st, 1);
+    if (!glide) SoundTouch_setPitchSemiTones(st, semiTones);
+
+    for (i = 0; i < INPUT_SAMPLES; i += BLOCK) {
+        if (glide && (i < SAMPLE_RATE)) {
+            SoundTouchPitchPoint point;
+
+            point.frameOffset = SAMPLE_RATE;
+            point.semiTones = semiTones;
+            SoundTouch_setPitchAutomation(st, &point, 1);
+            SoundTouch_putSamples(st, (void *)input, SAMPLE_RATE);
+            i = SAMPLE_RATE - BLOCK;
+        } else {
+            SoundTouch_putSamples(st, (void *)(input + i), BLOCK);
+        }
+        while ((n = SoundTouch_receiveSamples(st, output, 4 * BLOCK)) > 0) {
+            uint k;
+            for (k = 0; (k < n) && (gap < 0); k++) {
+                silentRun = (fabs((double)output[k]) < 1e-3) ? silentRun + 1 : 0;
+                // the gap is the first silence longer than half of its input length
+                if (silentRun == GAP_LENGTH / 2) gap = pos + k - silentRun + 1;
+            }
+            pos += n;
+        }
+    }
+    SoundTouch_free(st);
+    return gap;
+}
+
+int main(void) {
+    static const float endPitches[] = {12.0f, -12.0f, 7.0f};
+    SAMPLETYPE *input = (SAMPLETYPE *)malloc(INPUT_SAMPLES * sizeof(SAMPLETYPE));
+    int failed = 0;
+    int i;
+
+    for (i = 0; i < INPUT_SAMPLES; i++) {
+        int inGap = (i >= GAP_START) && (i < GAP_START + GAP_LENGTH);
+        input[i] = inGap ? 0 : (SAMPLETYPE)(0.5 * sin(i * 2 * M_PI * 220.0 / SAMPLE_RATE));
+    }
+
+    for (i = 0; i < (int)(sizeof(endPitches) / sizeof(endPitches[0])); i++) {
+        long constant = findGap(input, endPitches[i], 0);
+        long glided = findGap(input, endPitches[i], 1);
+        int ok = (constant >= 0) && (glided >= 0) && (labs(glided - constant) <= TOLERANCE);
+
+        printf("%+5.1f semitones: gap at %d in, %ld out at constant pitch, %ld out after a glide%s\n",
+               endPitches[i], GAP_START, constant, glided, ok ? "" : " FAILED");
+        if (!ok) failed = 1;
+    }
+    free(input);
+    return failed;
+}
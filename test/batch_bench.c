@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Density benchmark for batch handles: processes a set of mono streams with
+/// the voice presets of run_test.sh, first with one handle per stream and then
+/// with batch handles of 4, 8 and 16 streams, and prints the throughput of a
+/// single core for each.
+///
+/// Usage: batch_bench [streams] [seconds of audio per stream]
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "STTypes.h"
+#include "SoundTouch_Wrapper.h"
+
+#define SAMPLE_RATE 16000
+#define BLOCK 320
+#define MAX_BATCH 16
+
+static const float presets[] = {-4.0f, 5.0f, 6.5f};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Processes 'numStreams' streams in handles of 'batch' streams each (0 = one
+// plain handle per stream), returns the seconds taken
+static double runStreams(int numStreams, int batch, float semiTones, SAMPLETYPE **input, int inputSamples) {
+    SAMPLETYPE output[MAX_BATCH][4 * BLOCK];
+    SAMPLETYPE *outPlanes[MAX_BATCH];
+    const SAMPLETYPE *inPlanes[MAX_BATCH];
+    int perHandle = (batch > 0) ? batch : 1;
+    int numHandles = numStreams / perHandle;
+    void **handles = (void **)malloc(numHandles * sizeof(void *));
+    double start;
+    int h, k, pos;
+
+    for (h = 0; h < numHandles; h++) {
+        if (batch > 0) {
+            handles[h] = SoundTouch_initBatch(SAMPLE_RATE, batch);
+        } else {
+            handles[h] = SoundTouch_init();
+            SoundTouch_setSampleRate(handles[h], SAMPLE_RATE);
+            SoundTouch_setChannels(handles[h], 1);
+        }
+        SoundTouch_setPitchSemiTones(handles[h], semiTones);
+    }
+    for (k = 0; k < MAX_BATCH; k++) {
+        outPlanes[k] = output[k];
+    }
+
+    start = now();
+    for (pos = 0; pos + BLOCK <= inputSamples; pos += BLOCK) {
+        for (h = 0; h < numHandles; h++) {
+            for (k = 0; k < perHandle; k++) {
+                inPlanes[k] = input[h * perHandle + k] + pos;
+            }
+            if (batch > 0) {
+                SoundTouch_putSamplesPlanar(handles[h], (const void *const *)inPlanes, BLOCK);
+                while (SoundTouch_receiveSamplesPlanar(handles[h], (void *const *)outPlanes, 4 * BLOCK) > 0) {
+                }
+            } else {
+                SoundTouch_putSamples(handles[h], (void *)inPlanes[0], BLOCK);
+                while (SoundTouch_receiveSamples(handles[h], output[0], 4 * BLOCK) > 0) {
+                }
+            }
+        }
+    }
+    start = now() - start;
+
+    for (h = 0; h < numHandles; h++) {
+        SoundTouch_free(handles[h]);
+    }
+    free(handles);
+    return start;
+}
+
+int main(int argc, char *argv[]) {
+    int numStreams = (argc > 1) ? atoi(argv[1]) : 64;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 10;
+    int inputSamples = seconds * SAMPLE_RATE;
+    SAMPLETYPE **input;
+    unsigned int p;
+    int i, k;
+
+    // whole batches only
+    numStreams -= numStreams % MAX_BATCH;
+    if (numStreams < MAX_BATCH) numStreams = MAX_BATCH;
+
+    input = (SAMPLETYPE **)malloc(numStreams * sizeof(SAMPLETYPE *));
+    for (k = 0; k < numStreams; k++) {
+        // a different voice-like tone for every stream
+        double f0 = 0.03 + 0.002 * (k % 17);
+        input[k] = (SAMPLETYPE *)malloc(inputSamples * sizeof(SAMPLETYPE));
+        for (i = 0; i < inputSamples; i++) {
+            input[k][i] = (SAMPLETYPE)(8000.0 * sin(i * f0) * sin(i * 0.0007 * (1 + k % 5)) + 500.0 * sin(i * 1.3));
+        }
+    }
+
+    printf("%d mono streams x %d s at %d Hz, single core\n", numStreams, seconds, SAMPLE_RATE);
+    for (p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+        double base = runStreams(numStreams, 0, presets[p], input, inputSamples);
+        int batch;
+
+        printf("pitch %+.1f: separate   %7.1fx realtime\n", presets[p], numStreams * seconds / base);
+        for (batch = 4; batch <= MAX_BATCH; batch *= 2) {
+            double t = runStreams(numStreams, batch, presets[p], input, inputSamples);
+            printf("            batch of %2d %7.1fx realtime, density %.2fx\n", batch, numStreams * seconds / t,
+                   base / t);
+        }
+    }
+
+    for (k = 0; k < numStreams; k++) {
+        free(input[k]);
+    }
+    free(input);
+    return 0;
+}
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Block size benchmark: processes a voice-like mono stream in blocks of 1 to
+/// 4096 frames, putting each block and receiving the output as a real-time
+/// caller does, and prints the CPU time per frame and per block. The growth of
+/// the time per frame at small blocks is the fixed per-block cost of the
+/// pipeline; at one frame per block it is mostly that cost.
+///
+/// Usage: block_bench [seconds of audio] [semitones]
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "STTypes.h"
+#include "SoundTouch_Wrapper.h"
+
+#define SAMPLE_RATE 16000
+#define MAX_BLOCK 4096
+#define ROUNDS 5
+
+static const unsigned int blockSizes[] = {1, 16, 64, 128, 256, 4096};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Processes the input in blocks of 'blockSize' frames, returns the seconds taken
+static double runBlocks(unsigned int blockSize, float semiTones, const SAMPLETYPE *input, int inputSamples) {
+    static SAMPLETYPE output[4 * MAX_BLOCK];
+    void *handle = SoundTouch_initWithProfile(SOUNDTOUCH_PROFILE_SPEECH);
+    double start;
+    int pos;
+
+    SoundTouch_setSampleRate(handle, SAMPLE_RATE);
+    SoundTouch_setChannels(handle, 1);
+    SoundTouch_setPitchSemiTones(handle, semiTones);
+
+    start = now();
+    for (pos = 0; pos + (int)blockSize <= inputSamples; pos += blockSize) {
+        SoundTouch_putSamples(handle, (void *)(input + pos), blockSize);
+        while (SoundTouch_receiveSamples(handle, output, 4 * MAX_BLOCK) > 0) {
+        }
+    }
+    start = now() - start;
+
+    SoundTouch_free(handle);
+    return start;
+}
+
+int main(int argc, char *argv[]) {
+    int seconds = (argc > 1) ? atoi(argv[1]) : 30;
+    float semiTones = (argc > 2) ? (float)atof(argv[2]) : 5.0f;
+    int inputSamples = seconds * SAMPLE_RATE;
+    SAMPLETYPE *input;
+    double phase = 0;
+    unsigned int b;
+    int i, k;
+
+    // harmonics of a gliding 140 Hz voice, amplitude modulated at a syllable rate
+    input = (SAMPLETYPE *)malloc(inputSamples * sizeof(SAMPLETYPE));
+    for (i = 0; i < inputSamples; i++) {
+        double t = (double)i / SAMPLE_RATE;
+        double sum = 0;
+
+        phase += 2 * M_PI * (140.0 + 30.0 * sin(2 * M_PI * 0.7 * t)) / SAMPLE_RATE;
+        for (k = 1; k <= 20; k++) {
+            sum += sin(k * phase) / k;
+        }
+        input[i] = (SAMPLETYPE)(0.2 * sum * (0.6 + 0.4 * sin(2 * M_PI * 3.0 * t)));
+    }
+
+    printf("mono %d s at %d Hz, pitch %+.1f, speech profile, best of %d\n", seconds, SAMPLE_RATE, semiTones, ROUNDS);
+    printf("block  ns/frame  us/block\n");
+    for (b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+        int blocks = inputSamples / blockSizes[b];
+        double best = 0;
+
+        for (k = 0; k < ROUNDS; k++) {
+            double t = runBlocks(blockSizes[b], semiTones, input, inputSamples);
+            if ((k == 0) || (t < best)) best = t;
+        }
+        printf("%5u  %8.1f  %8.2f\n", blockSizes[b], best * 1e9 / (blocks * blockSizes[b]), best * 1e6 / blocks);
+    }
+
+    free(input);
+    return 0;
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Scaling benchmark for the stream engine: processes a set of streams with
+/// uneven block sizes and pitch settings on 1, 2, 4, ... worker threads and
+/// prints the throughput relative to a single thread.
+///
+/// Usage: engine_bench [streams] [seconds of audio per stream] [max threads]
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "STTypes.h"
+#include "SoundTouch_Wrapper.h"
+
+#define SAMPLE_RATE 16000
+#define CHANNELS 1
+#define MAX_BLOCK 1024
+
+typedef struct {
+    void *stream;
+    uint blockSize;
+    SAMPLETYPE output[4 * MAX_BLOCK * CHANNELS];
+} BenchStream;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Processes all streams on an engine with 'numThreads' workers, returns the seconds taken
+static double runEngine(unsigned int numThreads, BenchStream *streams, int numStreams, const SAMPLETYPE *input,
+                        int inputSamples) {
+    void *engine = SoundTouch_engineInit(numThreads);
+    double start;
+    int i, pos;
+
+    for (i = 0; i < numStreams; i++) {
+        streams[i].stream = SoundTouch_engineCreateStream(engine, SAMPLE_RATE, CHANNELS);
+        SoundTouch_engineSetPitchSemiTones(streams[i].stream, (float)(i % 13) - 6.0f);
+    }
+
+    start = now();
+    for (pos = 0; pos < inputSamples; pos += MAX_BLOCK) {
+        for (i = 0; i < numStreams; i++) {
+            // uneven block sizes: each stream feeds its own block size until it
+            // has consumed the same amount of input as the others
+            uint done;
+            for (done = 0; done < MAX_BLOCK; done += streams[i].blockSize) {
+                uint n = streams[i].blockSize;
+                if (done + n > MAX_BLOCK) n = MAX_BLOCK - done;
+                SoundTouch_engineSubmit(engine, streams[i].stream, input + (pos + done) * CHANNELS, n,
+                                        streams[i].output, 4 * MAX_BLOCK, NULL, NULL);
+            }
+        }
+        // pace the rounds like a server receiving the audio of its call legs
+        SoundTouch_engineWaitAll(engine);
+    }
+    SoundTouch_engineWaitAll(engine);
+    start = now() - start;
+
+    SoundTouch_engineFree(engine);
+    return start;
+}
+
+int main(int argc, char *argv[]) {
+    int numStreams = (argc > 1) ? atoi(argv[1]) : 64;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 10;
+    int inputSamples = seconds * SAMPLE_RATE;
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int maxThreads = (argc > 3) ? (unsigned int)atoi(argv[3]) : (unsigned int)numCores;
+    SAMPLETYPE *input;
+    BenchStream *streams;
+    double base = 0;
+    int i;
+    unsigned int threads;
+
+    input = (SAMPLETYPE *)malloc((inputSamples + MAX_BLOCK) * CHANNELS * sizeof(SAMPLETYPE));
+    for (i = 0; i < (inputSamples + MAX_BLOCK) * CHANNELS; i++) {
+        input[i] = (SAMPLETYPE)(8000.0 * sin(i * 0.05) * sin(i * 0.0007));
+    }
+    streams = (BenchStream *)malloc(numStreams * sizeof(BenchStream));
+    for (i = 0; i < numStreams; i++) {
+        // block sizes from 10 ms to 64 ms
+        streams[i].blockSize = 160 + (uint)(i * 97) % (MAX_BLOCK - 160);
+    }
+
+    printf("%d streams x %d s, %ld cores\n", numStreams, seconds, numCores);
+    for (threads = 1; threads <= maxThreads; threads *= 2) {
+        double t = runEngine(threads, streams, numStreams, input, inputSamples);
+
+        if (threads == 1) base = t;
+        printf("threads %2u : %7.3f s, %6.1fx realtime, speed-up %.2f\n", threads, t, numStreams * seconds / t,
+               base / t);
+    }
+
+    free(streams);
+    free(input);
+    return 0;
+}
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Idle storage benchmark: processes a set of streams in 20 ms frames, compacting
+/// the buffers of every stream after each frame as a server would between the
+/// packets of its call legs, once for each storage format. Prints the idle
+/// memory per stream, the time per stream-second and the signal-to-noise ratio
+/// of the first stream's output against the float storage. That SNR also depends
+/// on the overlap positions the time-stretch picks, see park_test.
+///
+/// Usage: park_bench [streams] [seconds of audio per stream]
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "STTypes.h"
+#include "SoundTouch_Wrapper.h"
+
+#define SAMPLE_RATE 16000
+#define FRAME 320
+#define MAX_OUTPUT (4 * FRAME)
+
+static const char *formatNames[] = {"float", "int16", "bf16"};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Processes all streams with idle storage 'format', writes the output of the first
+// stream to 'output' and the idle memory per stream to 'idleBytes'. Returns the
+// seconds taken, or a negative value if the format isn't supported.
+static double runStreams(int format, int numStreams, const SAMPLETYPE *input, int inputSamples, SAMPLETYPE *output,
+                         int *outputSamples, double *idleBytes) {
+    void **streams = (void **)malloc(numStreams * sizeof(void *));
+    SAMPLETYPE frameOut[MAX_OUTPUT];
+    SoundTouchMemoryUsage usage;
+    double start, total = 0;
+    int i, pos, supported = 1;
+
+    for (i = 0; i < numStreams; i++) {
+        streams[i] = SoundTouch_init();
+        SoundTouch_setSampleRate(streams[i], SAMPLE_RATE);
+        SoundTouch_setChannels(streams[i], 1);
+        SoundTouch_setPitchSemiTones(streams[i], (float)(i % 13) - 6.0f);
+        if (!SoundTouch_setIdleStorage(streams[i], format)) supported = 0;
+    }
+
+    *outputSamples = 0;
+    start = now();
+    for (pos = 0; supported && (pos + FRAME <= inputSamples); pos += FRAME) {
+        for (i = 0; i < numStreams; i++) {
+            uint n;
+
+            SoundTouch_putSamples(streams[i], (void *)(input + pos), FRAME);
+            while ((n = SoundTouch_receiveSamples(streams[i], frameOut, MAX_OUTPUT)) > 0) {
+                if (i == 0) {
+                    uint k;
+                    for (k = 0; k < n; k++) output[(*outputSamples)++] = frameOut[k];
+                }
+            }
+            if ((format != SOUNDTOUCH_STORAGE_FLOAT) && !SoundTouch_compactIdle(streams[i])) supported = 0;
+        }
+    }
+    start = now() - start;
+
+    for (i = 0; i < numStreams; i++) {
+        SoundTouch_getMemoryUsage(streams[i], &usage);
+        total += usage.total;
+        SoundTouch_free(streams[i]);
+    }
+    free(streams);
+    *idleBytes = total / numStreams;
+    return supported ? start : -1.0;
+}
+
+int main(int argc, char *argv[]) {
+    int numStreams = (argc > 1) ? atoi(argv[1]) : 500;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 5;
+    int inputSamples = seconds * SAMPLE_RATE;
+    int maxOutput = 2 * inputSamples + MAX_OUTPUT;
+    SAMPLETYPE *input, *reference, *output;
+    unsigned int seed = 1;
+    double lowPass = 0;
+    int refSamples = 0;
+    int format, i;
+
+    input = (SAMPLETYPE *)malloc(inputSamples * sizeof(SAMPLETYPE));
+    reference = (SAMPLETYPE *)malloc(maxOutput * sizeof(SAMPLETYPE));
+    output = (SAMPLETYPE *)malloc(maxOutput * sizeof(SAMPLETYPE));
+    for (i = 0; i < inputSamples; i++) {
+        seed = seed * 1103515245u + 12345u;
+        lowPass = 0.9 * lowPass + 0.1 * ((double)(seed >> 8) / (1 << 23) - 1.0);
+        input[i] = (SAMPLETYPE)(2.0 * lowPass * sin(i * 0.0007));
+    }
+
+    printf("%d mono streams, %d s each, compacted after every %d-frame block\n", numStreams, seconds, FRAME);
+    for (format = SOUNDTOUCH_STORAGE_FLOAT; format <= SOUNDTOUCH_STORAGE_BF16; format++) {
+        double idleBytes, noise = 0, signal = 0;
+        int outSamples;
+        double t = runStreams(format, numStreams, input, inputSamples,
+                              (format == SOUNDTOUCH_STORAGE_FLOAT) ? reference : output, &outSamples, &idleBytes);
+
+        if (t < 0) {
+            printf("%-6s not supported\n", formatNames[format]);
+            continue;
+        }
+        if (format == SOUNDTOUCH_STORAGE_FLOAT) {
+            refSamples = outSamples;
+            printf("%-6s %6.1f KB idle per stream, %6.3f ms per stream-second\n", formatNames[format],
+                   idleBytes / 1024, t / numStreams / seconds * 1e3);
+            continue;
+        }
+        for (i = 0; (i < outSamples) && (i < refSamples); i++) {
+            double diff = (double)output[i] - (double)reference[i];
+            signal += (double)reference[i] * reference[i];
+            noise += diff * diff;
+        }
+        printf("%-6s %6.1f KB idle per stream, %6.3f ms per stream-second, %5.1f dB SNR against float\n",
+               formatNames[format], idleBytes / 1024, t / numStreams / seconds * 1e3,
+               (noise > 0) ? 10 * log10(signal / noise) : INFINITY);
+    }
+
+    free(input);
+    free(reference);
+    free(output);
+    return 0;
+}
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Construction cost benchmark: sets up a handle for a short utterance, runs a
+/// first block through it and disposes of it, first with SoundTouch_init and
+/// SoundTouch_free and then with a handle pool, and prints the time per
+/// utterance for each.
+///
+/// Usage: pool_bench [utterances]
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "STTypes.h"
+#include "SoundTouch_Wrapper.h"
+
+#define SAMPLE_RATE 16000
+#define BLOCK 320
+
+static const float presets[] = {-4.0f, 5.0f, 6.5f};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Runs 'count' utterances with handles built on demand ('pool' = NULL) or taken
+// from 'pool', returns the seconds taken
+static double runUtterances(void *pool, int count, const SAMPLETYPE *input) {
+    SAMPLETYPE output[4 * BLOCK];
+    double start = now();
+    int i;
+
+    for (i = 0; i < count; i++) {
+        void *handle;
+
+        if (pool) {
+            handle = SoundTouch_poolAcquire(pool);
+        } else {
+            handle = SoundTouch_init();
+            SoundTouch_setSampleRate(handle, SAMPLE_RATE);
+            SoundTouch_setChannels(handle, 1);
+        }
+        SoundTouch_setPitchSemiTones(handle, presets[i % 3]);
+        SoundTouch_putSamples(handle, (void *)input, BLOCK);
+        while (SoundTouch_receiveSamples(handle, output, 4 * BLOCK) > 0) {
+        }
+        if (pool) {
+            SoundTouch_poolRelease(pool, handle);
+        } else {
+            SoundTouch_free(handle);
+        }
+    }
+    return now() - start;
+}
+
+int main(int argc, char *argv[]) {
+    int count = (argc > 1) ? atoi(argv[1]) : 20000;
+    SAMPLETYPE input[BLOCK];
+    void *pool;
+    double plain, pooled;
+    int i;
+
+    for (i = 0; i < BLOCK; i++) {
+        input[i] = (SAMPLETYPE)(8000.0 * sin(i * 0.03));
+    }
+
+    pool = SoundTouch_poolInit(SAMPLE_RATE, 1, 1);
+    // warm up the allocator and the caches
+    runUtterances(NULL, count / 10 + 1, input);
+    runUtterances(pool, count / 10 + 1, input);
+
+    plain = runUtterances(NULL, count, input);
+    pooled = runUtterances(pool, count, input);
+    SoundTouch_poolFree(pool);
+
+    printf("%d utterances, one %d-frame block each\n", count, BLOCK);
+    printf("init/free       %7.2f us per utterance\n", plain / count * 1e6);
+    printf("pool            %7.2f us per utterance, %.2fx faster\n", pooled / count * 1e6, plain / pooled);
+    return 0;
+}
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Profile benchmark: processes a voice-like mono stream with each performance
+/// profile at the voice presets of run_test.sh, on the float and the int16
+/// engine, and prints the CPU cost as the throughput of a single core together
+/// with the initial latency.
+///
+/// Usage: profile_bench [sample rate] [seconds of audio]
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SoundTouch_Wrapper.h"
+
+#define BLOCK 512
+
+static const char *const profileNames[] = {"low latency", "speech", "music quality", "max throughput"};
+
+static const float presets[] = {-4.0f, 5.0f, 6.5f};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Processes the input with one handle of 'profile' on 'engine', returns the seconds
+// taken and stores the initial latency in samples into 'latency'. 'input' holds
+// floats for the float engine and shorts for the int16 engine.
+static double runProfile(int profile, int engine, int sampleRate, float semiTones, const void *input,
+                         int inputSamples, int *latency) {
+    float output[4 * BLOCK];
+    void *handle = SoundTouch_initWithEngine(profile, engine);
+    int sampleSize = (engine == SOUNDTOUCH_ENGINE_INT16) ? sizeof(short) : sizeof(float);
+    double start;
+    int pos;
+
+    SoundTouch_setSampleRate(handle, sampleRate);
+    SoundTouch_setChannels(handle, 1);
+    SoundTouch_setPitchSemiTones(handle, semiTones);
+    *latency = SoundTouch_getSetting(handle, SOUNDTOUCH_SETTING_INITIAL_LATENCY);
+
+    start = now();
+    for (pos = 0; pos + BLOCK <= inputSamples; pos += BLOCK) {
+        SoundTouch_putSamples(handle, (void *)((const char *)input + pos * sampleSize), BLOCK);
+        while (SoundTouch_receiveSamples(handle, output, 4 * BLOCK) > 0) {
+        }
+    }
+    start = now() - start;
+
+    SoundTouch_free(handle);
+    return start;
+}
+
+int main(int argc, char *argv[]) {
+    int sampleRate = (argc > 1) ? atoi(argv[1]) : 16000;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 60;
+    int inputSamples = seconds * sampleRate;
+    float *input;
+    short *input16;
+    double phase = 0;
+    int profile, i, k;
+    unsigned int p;
+
+    // harmonics of a gliding 140 Hz voice, amplitude modulated at a syllable rate
+    input = (float *)malloc(inputSamples * sizeof(float));
+    input16 = (short *)malloc(inputSamples * sizeof(short));
+    for (i = 0; i < inputSamples; i++) {
+        double t = (double)i / sampleRate;
+        double sum = 0;
+
+        phase += 2 * M_PI * (140.0 + 30.0 * sin(2 * M_PI * 0.7 * t)) / sampleRate;
+        for (k = 1; k <= 20; k++) {
+            sum += sin(k * phase) / k;
+        }
+        sum *= 6000.0 * (0.6 + 0.4 * sin(2 * M_PI * 3.0 * t));
+        input[i] = (float)(sum / 32768.0);
+        input16[i] = (short)sum;
+    }
+
+    printf("mono %d s at %d Hz, single core\n", seconds, sampleRate);
+    printf("profile          pitch     float     int16  latency\n");
+    for (profile = SOUNDTOUCH_PROFILE_LOW_LATENCY; profile <= SOUNDTOUCH_PROFILE_MAX_THROUGHPUT; profile++) {
+        for (p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+            int latency;
+            double t = runProfile(profile, SOUNDTOUCH_ENGINE_FLOAT, sampleRate, presets[p], input, inputSamples,
+                                  &latency);
+            double t16 = runProfile(profile, SOUNDTOUCH_ENGINE_INT16, sampleRate, presets[p], input16, inputSamples,
+                                    &latency);
+
+            printf("%-15s  %+5.1f  %7.1fx  %7.1fx  %5.1f ms\n", (p == 0) ? profileNames[profile] : "", presets[p],
+                   seconds / t, seconds / t16, 1000.0 * latency / sampleRate);
+        }
+    }
+
+    free(input);
+    free(input16);
+    return 0;
+}
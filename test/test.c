@@ -23,7 +23,16 @@ int main(const int nParams, const char *const paramStr[]) {
 
     // clock_t cs = clock();    // for benchmarking processing duration
     // Process the sound
-    process(soundTouch, inFile, outFile);
+    if ((params->startTime > 0) || (params->endTime > 0)) {
+        uint sampleRate = WavInFile_getSampleRate(inFile);
+        uint endSample = (params->endTime > 0) ? (uint)(params->endTime * sampleRate) : UINT_MAX;
+
+        processRegion(soundTouch, inFile, outFile, (uint)(params->startTime * sampleRate), endSample);
+    } else if (params->jobs > 1) {
+        processOffline(params, inFile, outFile);
+    } else {
+        process(soundTouch, inFile, outFile);
+    }
     // clock_t ce = clock();    // for benchmarking processing duration
     // printf("duration: %lf\n", (double)(ce-cs)/CLOCKS_PER_SEC);
 
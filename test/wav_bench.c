@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// WAV conversion benchmark: writes and reads back a voice-like mono stream in
+/// 8, 16, 24 and 32bit WAV files with the plain C and the SSE2 conversions, and
+/// prints the CPU time per sample value next to the processing time of the same
+/// stream with the speech profile, i.e. the share of the conversions in a CLI
+/// run. Writing goes to the null device and reading comes from a file already
+/// in the page cache, so that the times are mostly those of the conversions.
+///
+/// Usage: wav_bench [seconds of audio] [temporary file]
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SoundTouch_Wrapper.h"
+#include "WavFile.h"
+#include "cpu_detect.h"
+
+#define SAMPLE_RATE 16000
+#define BLOCK 4096
+#define ROUNDS 5
+
+static const int bitDepths[] = {8, 16, 24, 32};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Writes the input to 'fileName' in blocks, returns the seconds taken
+static double runWrite(const char *fileName, int bits, const float *input, int inputSamples) {
+    WavOutFile *outFile = WavOutFile_create(fileName, SAMPLE_RATE, bits, 1);
+    double start = now();
+    int pos;
+
+    for (pos = 0; pos < inputSamples; pos += BLOCK) {
+        WavOutFile_writeFloat(outFile, input + pos, (inputSamples - pos < BLOCK) ? inputSamples - pos : BLOCK);
+    }
+    WavOutFile_destroy(outFile);
+    return now() - start;
+}
+
+// Reads 'fileName' in blocks, returns the seconds taken
+static double runRead(const char *fileName) {
+    static float buffer[BLOCK];
+    WavInFile *inFile = WavInFile_create(fileName);
+    double start = now();
+
+    while ((WavInFile_eof(inFile) == 0) && (WavInFile_readFloat(inFile, buffer, BLOCK) > 0)) {
+    }
+    start = now() - start;
+    WavInFile_destroy(inFile);
+    return start;
+}
+
+// Processes the input as the CLI does, returns the seconds taken
+static double runProcess(const float *input, int inputSamples) {
+    static float output[4 * BLOCK];
+    void *handle = SoundTouch_initWithProfile(SOUNDTOUCH_PROFILE_SPEECH);
+    unsigned int nOutput;
+    double start;
+    int pos;
+
+    SoundTouch_setSampleRate(handle, SAMPLE_RATE);
+    SoundTouch_setChannels(handle, 1);
+    SoundTouch_setPitchSemiTones(handle, 5.0f);
+
+    start = now();
+    for (pos = 0; pos + BLOCK <= inputSamples; pos += BLOCK) {
+        SoundTouch_process(handle, input + pos, BLOCK, output, 4 * BLOCK, &nOutput);
+    }
+    start = now() - start;
+
+    SoundTouch_free(handle);
+    return start;
+}
+
+int main(int argc, char *argv[]) {
+    int seconds = (argc > 1) ? atoi(argv[1]) : 60;
+    const char *fileName = (argc > 2) ? argv[2] : "wav_bench.tmp.wav";
+    int inputSamples = seconds * SAMPLE_RATE;
+    float *input;
+    double phase = 0;
+    double process = 0;
+    unsigned int b;
+    int i, k;
+
+    // harmonics of a gliding 140 Hz voice, amplitude modulated at a syllable rate
+    input = (float *)malloc(inputSamples * sizeof(float));
+    for (i = 0; i < inputSamples; i++) {
+        double t = (double)i / SAMPLE_RATE;
+        double sum = 0;
+
+        phase += 2 * M_PI * (140.0 + 30.0 * sin(2 * M_PI * 0.7 * t)) / SAMPLE_RATE;
+        for (k = 1; k <= 20; k++) {
+            sum += sin(k * phase) / k;
+        }
+        input[i] = (float)(0.2 * sum * (0.6 + 0.4 * sin(2 * M_PI * 3.0 * t)));
+    }
+
+    for (k = 0; k < ROUNDS; k++) {
+        double t = runProcess(input, inputSamples);
+        if ((k == 0) || (t < process)) process = t;
+    }
+
+    printf("mono %d s at %d Hz, best of %d, ns per sample value\n", seconds, SAMPLE_RATE, ROUNDS);
+    printf("processing at pitch +5.0, speech profile: %.1f\n", process * 1e9 / inputSamples);
+    printf("bits  write C  write SSE2  read C  read SSE2  share\n");
+    for (b = 0; b < sizeof(bitDepths) / sizeof(bitDepths[0]); b++) {
+        double best[4] = {0, 0, 0, 0};
+        int simd;
+
+        runWrite(fileName, bitDepths[b], input, inputSamples);
+        for (k = 0; k < ROUNDS; k++) {
+            for (simd = 0; simd <= 1; simd++) {
+                double t;
+
+                disableExtensions(simd ? 0 : SUPPORT_SSE2);
+                t = runWrite("/dev/null", bitDepths[b], input, inputSamples);
+                if ((k == 0) || (t < best[simd])) best[simd] = t;
+                t = runRead(fileName);
+                if ((k == 0) || (t < best[2 + simd])) best[2 + simd] = t;
+            }
+        }
+        disableExtensions(0);
+        printf("%4d  %7.2f  %10.2f  %6.2f  %9.2f  %4.1f%%\n", bitDepths[b], best[0] * 1e9 / inputSamples,
+               best[1] * 1e9 / inputSamples, best[2] * 1e9 / inputSamples, best[3] * 1e9 / inputSamples,
+               100.0 * (best[1] + best[3]) / (best[1] + best[3] + process));
+    }
+
+    remove(fileName);
+    free(input);
+    return 0;
+}